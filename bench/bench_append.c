@@ -0,0 +1,67 @@
+#include "btree.h"
+#include "table.h"
+
+#include <time.h>
+#include <sys/stat.h>
+
+/* Append benchmark: inserts rows with sequential ids and then the same number of rows in random
+ * key order (into a new file), and reports the insert throughput and the size of the file,
+ * sequential ids should fill the leaves (and the file) almost completely.
+ * usage: ./bench_append [rows] [database file] */
+
+/* current time in microseconds [double] */
+double now_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/* inserts `rows` rows into a new database file and prints the results [void] */
+void bench_run(const char* order, const char* filename, uint32_t rows, bool sequential) {
+    char wal_filename[512];
+    snprintf(wal_filename, sizeof(wal_filename), "%s-wal", filename);
+    unlink(filename);
+    unlink(wal_filename);
+
+    DbOptions options = { .pager_mode = PAGER_BUFFERED, .cache_pages = PAGER_DEFAULT_MAX_FRAMES, .sync_level = SYNC_OFF };
+    Table* table = db_open(filename, &options);
+
+    Row row;
+    double start = now_us();
+    for (uint32_t i = 1; i <= rows; i++) {
+        /* multiplying by an odd constant is a permutation of uint32_t, so keys never repeat */
+        row.id = sequential ? i : i * 2654435761u;
+        snprintf(row.username, sizeof(row.username), "user%u", row.id);
+        snprintf(row.email, sizeof(row.email), "user%u@example.com", row.id);
+
+        Cursor cursor;
+        table_find(table, row.id, &cursor);
+        leaf_node_insert(&cursor, row.id, &row);
+        table->row_count++;
+        cursor_close(&cursor);
+        db_commit(table);
+        pager_release(table->pager);
+    }
+    double elapsed = now_us() - start;
+
+    uint32_t depth = table->internal_node_layers;
+    db_close(table);
+
+    struct stat file_stat;
+    stat(filename, &file_stat);
+    unlink(filename);
+
+    printf("%-12s %10u %6u %10.2f %14.0f %10lld %10.1f\n", order, rows, depth, elapsed / 1e6,
+           rows / (elapsed / 1e6), (long long)(file_stat.st_size / PAGE_SIZE), file_stat.st_size / (1024.0 * 1024.0));
+}
+
+int main(int argc, char* argv[]) {
+    uint32_t rows = argc > 1 ? (uint32_t)atol(argv[1]) : 2000000;
+    const char* filename = argc > 2 ? argv[2] : "bench.db";
+
+    printf("%-12s %10s %6s %10s %14s %10s %10s\n", "order", "rows", "depth", "seconds", "inserts/s", "pages", "file MB");
+    bench_run("sequential", filename, rows, true);
+    bench_run("random", filename, rows, false);
+
+    return 0;
+}
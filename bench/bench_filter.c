@@ -0,0 +1,180 @@
+#include "btree.h"
+#include "table.h"
+#include "filter.h"
+
+#include <time.h>
+
+/* Filter benchmark: fills a new table with `rows` rows (sequential ids, the email domain changes
+ * every 10000 rows and every 10th row has an email at another domain), then filters the whole table
+ * by an equality, a prefix, a suffix and a substring predicate: row by row with the libc string
+ * functions (`cursor_read_row()`, then `strcmp()`, `strncmp()` or `strstr()`), a leaf at a time
+ * with every filter variant, and a leaf at a time passing over leaves by their zone maps (after a
+ * first scan recorded them). Reports the rows filtered per second and the pages read from the file
+ * per scan (and checks the filters agree), a buffer pool of `cache pages` smaller than the table
+ * makes every scan read pages.
+ * usage: ./bench_filter [rows] [database file] [cache pages] */
+
+#define BENCH_ROUNDS 5
+
+typedef struct {
+    const char* name;
+    FilterFunction function;
+} BenchVariant;
+
+static BenchVariant variants[] = {
+    { "scalar", filter_values_scalar },
+    { "sse2", filter_values_sse2 },
+    { "avx2", filter_values_avx2 },
+};
+static const uint32_t variant_count = sizeof(variants) / sizeof(variants[0]);
+
+typedef struct {
+    const char* name;
+    IndexColumn column;
+    MatchKind match;
+    const char* value;
+} BenchPredicate;
+
+static BenchPredicate predicates[] = {
+    { "equal", INDEX_USERNAME, MATCH_EQUAL, "user777" },
+    { "prefix", INDEX_EMAIL, MATCH_PREFIX, "user12" },
+    { "suffix", INDEX_EMAIL, MATCH_SUFFIX, "@mail.example.org" },
+    { "domain", INDEX_EMAIL, MATCH_SUFFIX, "@tenant42.com" },
+    { "contains", INDEX_EMAIL, MATCH_CONTAINS, "example.org" },
+};
+static const uint32_t predicate_count = sizeof(predicates) / sizeof(predicates[0]);
+
+/* current time in microseconds [double] */
+double now_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/* filters the table row by row with the libc string functions, returns the number of matching rows [uint64_t] */
+uint64_t bench_filter_rows(Table* table, BenchPredicate* predicate) {
+    uint64_t result = 0;
+    size_t length = strlen(predicate->value);
+    Row row;
+    Cursor cursor;
+    table_start(table, &cursor);
+    while (!cursor.end_of_table) {
+        cursor_read_row(&cursor, &row);
+        const char* value = predicate->column == INDEX_USERNAME ? row.username : row.email;
+        size_t value_length = strlen(value);
+        switch (predicate->match) {
+            case (MATCH_EQUAL):
+                result += strcmp(value, predicate->value) == 0;
+                break;
+            case (MATCH_PREFIX):
+                result += strncmp(value, predicate->value, length) == 0;
+                break;
+            case (MATCH_SUFFIX):
+                result += value_length >= length && strcmp(value + value_length - length, predicate->value) == 0;
+                break;
+            case (MATCH_CONTAINS):
+                result += strstr(value, predicate->value) != NULL;
+                break;
+        }
+        cursor_advance(&cursor);
+        pager_release(table->pager);
+    }
+    cursor_close(&cursor);
+
+    return result;
+}
+
+/* filters the table a leaf at a time with the current variant (passing over leaves by their zone
+ * maps if `zoned`), returns the number of matching rows [uint64_t] */
+uint64_t bench_filter_batches(Table* table, Predicate* predicate, bool zoned) {
+    uint64_t result = 0;
+    RowBatch batch;
+    uint16_t selection[ROW_BATCH_MAX_ROWS];
+    Cursor cursor;
+    table_start(table, &cursor);
+    while (cursor_read_batch_filtered(&cursor, &batch, zoned ? &predicate->zone : NULL, UINT32_MAX) > 0) {
+        result += filter_batch(predicate, &batch, selection);
+        pager_release(table->pager);
+    }
+    cursor_close(&cursor);
+
+    return result;
+}
+
+int main(int argc, char* argv[]) {
+    uint32_t rows = argc > 1 ? (uint32_t)atol(argv[1]) : 1000000;
+    const char* filename = argc > 2 ? argv[2] : "bench.db";
+
+    char wal_filename[512];
+    snprintf(wal_filename, sizeof(wal_filename), "%s-wal", filename);
+    unlink(filename);
+    unlink(wal_filename);
+
+    DbOptions options = { .pager_mode = PAGER_BUFFERED, .sync_level = SYNC_OFF,
+                          .cache_pages = argc > 3 ? (uint32_t)atol(argv[3]) : PAGER_DEFAULT_MAX_FRAMES };
+    Table* table = db_open(filename, &options);
+
+    Row row;
+    for (uint32_t i = 1; i <= rows; i++) {
+        row.id = i;
+        snprintf(row.username, sizeof(row.username), "user%u", row.id);
+        if (i % 10 == 0)
+            snprintf(row.email, sizeof(row.email), "user%u@mail.example.org", row.id);
+        else
+            snprintf(row.email, sizeof(row.email), "user%u@tenant%u.com", row.id, i / 10000);
+
+        Cursor cursor;
+        table_find(table, row.id, &cursor);
+        leaf_node_insert(&cursor, row.id, &row);
+        table->row_count++;
+        cursor_close(&cursor);
+        if (i % 1024 == 0) {
+            db_commit(table);
+            pager_release(table->pager);
+        }
+    }
+    db_commit(table);
+    pager_release(table->pager);
+
+    printf("rows: %u, selected variant: %s\n", rows, filter_name(filter_values));
+    printf("%-10s %-8s %10s %14s %10s\n", "predicate", "variant", "matches", "rows/s", "reads");
+
+    for (uint32_t p = 0; p < predicate_count; p++) {
+        Predicate predicate;
+        predicate_init(&predicate, predicates[p].column, predicates[p].match, predicates[p].value);
+
+        uint64_t row_result = 0;
+        uint64_t reads = table->pager->page_reads;
+        double start = now_us();
+        for (uint32_t round = 0; round < BENCH_ROUNDS; round++)
+            row_result = bench_filter_rows(table, &predicates[p]);
+        double elapsed = now_us() - start;
+        printf("%-10s %-8s %10lu %14.0f %10lu\n", predicates[p].name, "row", row_result,
+               BENCH_ROUNDS * (double)rows / (elapsed / 1e6), (table->pager->page_reads - reads) / BENCH_ROUNDS);
+
+        FilterFunction selected = filter_values;
+        for (uint32_t v = 0; v <= variant_count; v++) {
+            /* the last round is the selected variant with zone maps */
+            bool zoned = v == variant_count;
+            filter_values = zoned ? selected : variants[v].function;
+            if (zoned)
+                bench_filter_batches(table, &predicate, true);
+
+            uint64_t result = 0;
+            reads = table->pager->page_reads;
+            start = now_us();
+            for (uint32_t round = 0; round < BENCH_ROUNDS; round++)
+                result = bench_filter_batches(table, &predicate, zoned);
+            elapsed = now_us() - start;
+            printf("%-10s %-8s %10lu %14.0f %10lu %s\n", predicates[p].name, zoned ? "zone" : variants[v].name, result,
+                   BENCH_ROUNDS * (double)rows / (elapsed / 1e6), (table->pager->page_reads - reads) / BENCH_ROUNDS,
+                   result == row_result ? "" : "MISMATCH");
+        }
+        filter_values = selected;
+    }
+
+    db_close(table);
+    unlink(filename);
+
+    return 0;
+}
@@ -0,0 +1,120 @@
+#include "btree.h"
+#include "table.h"
+#include "hash.h"
+
+#include <time.h>
+
+/* Hash index benchmark: fills a new table with `rows` rows (sequential ids), builds the hash index
+ * on the id, and then looks up the same random ids through the tree and through the hash index,
+ * and reports the inserts and lookups per second, the pages read by a lookup (the levels of the
+ * tree, the directory and bucket pages of the hash index) and checks both find the same rows.
+ * usage: ./bench_hash [rows] [database file] (run it with 1000000, 10000000 and 100000000 rows) */
+
+#define BENCH_LOOKUPS 2000000
+
+/* current time in microseconds [double] */
+double now_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/* average number of pages in a bucket's chain [double] */
+double bench_chain_length(Table* table) {
+    void* meta = get_page(table->pager, table->hash_root_page_number);
+    uint32_t bucket_count = *hash_meta_bucket_count(meta);
+
+    uint64_t pages = 0;
+    for (uint32_t b = 0; b < bucket_count; b++) {
+        for (uint32_t page = hash_bucket_page(table->pager, table->hash_root_page_number, b); page != 0; page = *leaf_node_next_leaf(get_page(table->pager, page)))
+            pages++;
+        if (b % 1024 == 0)
+            pager_release(table->pager);
+    }
+
+    return (double)pages / bucket_count;
+}
+
+int main(int argc, char* argv[]) {
+    uint32_t rows = argc > 1 ? (uint32_t)atol(argv[1]) : 1000000;
+    const char* filename = argc > 2 ? argv[2] : "bench.db";
+
+    char wal_filename[512];
+    snprintf(wal_filename, sizeof(wal_filename), "%s-wal", filename);
+    unlink(filename);
+    unlink(wal_filename);
+
+    DbOptions options = { .pager_mode = PAGER_BUFFERED, .cache_pages = PAGER_DEFAULT_MAX_FRAMES, .sync_level = SYNC_OFF };
+    Table* table = db_open(filename, &options);
+
+    Row row;
+    double start = now_us();
+    for (uint32_t i = 1; i <= rows; i++) {
+        row.id = i;
+        snprintf(row.username, sizeof(row.username), "user%u", row.id);
+        snprintf(row.email, sizeof(row.email), "user%u@example.com", row.id);
+
+        Cursor cursor;
+        table_find(table, row.id, &cursor);
+        leaf_node_insert(&cursor, row.id, &row);
+        table->row_count++;
+        cursor_close(&cursor);
+        if (i % 1024 == 0) {
+            db_commit(table);
+            pager_release(table->pager);
+        }
+    }
+    db_commit(table);
+    pager_release(table->pager);
+    double tree_insert = now_us() - start;
+
+    start = now_us();
+    hash_create(table);
+    db_commit(table);
+    pager_release(table->pager);
+    double hash_insert = now_us() - start;
+
+    uint32_t* targets = malloc(BENCH_LOOKUPS * sizeof(uint32_t));
+    srand(rows);
+    for (uint32_t i = 0; i < BENCH_LOOKUPS; i++)
+        targets[i] = 1 + ((uint32_t)rand() * 2654435761u) % rows;
+
+    uint64_t tree_sum = 0;
+    start = now_us();
+    for (uint32_t i = 0; i < BENCH_LOOKUPS; i++) {
+        Cursor cursor;
+        table_find(table, targets[i], &cursor);
+        cursor_read_row(&cursor, &row);
+        tree_sum += row.id + strlen(row.email);
+        cursor_close(&cursor);
+        if (i % 1024 == 0)
+            pager_release(table->pager);
+    }
+    double tree_lookup = now_us() - start;
+
+    uint64_t hash_sum = 0;
+    start = now_us();
+    for (uint32_t i = 0; i < BENCH_LOOKUPS; i++) {
+        if (hash_read_row(table, targets[i], &row))
+            hash_sum += row.id + strlen(row.email);
+        if (i % 1024 == 0)
+            pager_release(table->pager);
+    }
+    double hash_lookup = now_us() - start;
+
+    void* meta = get_page(table->pager, table->hash_root_page_number);
+    printf("rows: %u\n", rows);
+    printf("%-6s %14s %14s %14s\n", "method", "inserts/s", "lookups/s", "pages/lookup");
+    printf("%-6s %14.0f %14.0f %14u\n", "btree", rows / (tree_insert / 1e6), BENCH_LOOKUPS / (tree_lookup / 1e6),
+           table->internal_node_layers + 1);
+    printf("%-6s %14.0f %14.0f %14.2f\n", "hash", rows / (hash_insert / 1e6), BENCH_LOOKUPS / (hash_lookup / 1e6),
+           1 + bench_chain_length(table)); // the directory page and the bucket's chain
+    printf("hash buckets: %u, directory pages: %u %s\n", *hash_meta_bucket_count(meta), *hash_meta_directory_count(meta),
+           tree_sum == hash_sum ? "" : "MISMATCH");
+
+    free(targets);
+    db_close(table);
+    unlink(filename);
+
+    return 0;
+}
@@ -0,0 +1,123 @@
+#include "btree.h"
+#include "table.h"
+
+#include <time.h>
+
+/* Multi-get benchmark: fills a new table with `rows` rows (ids 1, 3, 5.. so half of the looked up
+ * ids don't exist), then looks up the same random ids one at a time with `table_find()` and in
+ * batches of growing size with `table_find_batch()`, and reports the lookups per second of every
+ * batch size (and checks they find the same rows).
+ * usage: ./bench_multiget [rows] [database file] */
+
+#define BENCH_LOOKUPS 4000000
+
+static const uint32_t batch_sizes[] = { 1, 4, 16, 64, 256, 1024, 4096, 16384 };
+static const uint32_t batch_size_count = sizeof(batch_sizes) / sizeof(batch_sizes[0]);
+
+/* current time in microseconds [double] */
+double now_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+int main(int argc, char* argv[]) {
+    uint32_t rows = argc > 1 ? (uint32_t)atol(argv[1]) : 1000000;
+    const char* filename = argc > 2 ? argv[2] : "bench.db";
+
+    char wal_filename[512];
+    snprintf(wal_filename, sizeof(wal_filename), "%s-wal", filename);
+    unlink(filename);
+    unlink(wal_filename);
+
+    DbOptions options = { .pager_mode = PAGER_BUFFERED, .cache_pages = PAGER_DEFAULT_MAX_FRAMES, .sync_level = SYNC_OFF };
+    Table* table = db_open(filename, &options);
+
+    Row row;
+    for (uint32_t i = 1; i <= rows; i++) {
+        row.id = 2 * i - 1;
+        snprintf(row.username, sizeof(row.username), "user%u", row.id);
+        snprintf(row.email, sizeof(row.email), "user%u@example.com", row.id);
+
+        Cursor cursor;
+        table_find(table, row.id, &cursor);
+        leaf_node_insert(&cursor, row.id, &row);
+        table->row_count++;
+        cursor_close(&cursor);
+        if (i % 1024 == 0) {
+            db_commit(table);
+            pager_release(table->pager);
+        }
+    }
+    db_commit(table);
+    pager_release(table->pager);
+
+    uint32_t* targets = malloc(BENCH_LOOKUPS * sizeof(uint32_t));
+    uint32_t* keys = malloc(BENCH_LOOKUPS * sizeof(uint32_t));
+    Row* found_rows = malloc(batch_sizes[batch_size_count - 1] * sizeof(Row));
+    srand(rows);
+    for (uint32_t i = 0; i < BENCH_LOOKUPS; i++)
+        targets[i] = 1 + ((uint32_t)rand() * 2654435761u) % (2 * rows);
+
+    printf("rows: %u, lookups: %u\n", rows, BENCH_LOOKUPS);
+    printf("%-10s %14s\n", "batch", "lookups/s");
+
+    /* one `table_find()` (and cursor) per id */
+    uint64_t expected = 0;
+    double start = now_us();
+    for (uint32_t i = 0; i < BENCH_LOOKUPS; i++) {
+        Cursor cursor;
+        table_find(table, targets[i], &cursor);
+        void* node = get_page(table->pager, cursor.page_number);
+        if (cursor.cell_number < *leaf_node_num_cells(node) && *leaf_node_key(node, cursor.cell_number) == targets[i]) {
+            cursor_read_row(&cursor, &row);
+            expected += row.id;
+        }
+        cursor_close(&cursor);
+        if (i % 1024 == 0)
+            pager_release(table->pager);
+    }
+    double elapsed = now_us() - start;
+    printf("%-10s %14.0f\n", "single", BENCH_LOOKUPS / (elapsed / 1e6));
+
+    for (uint32_t b = 0; b < batch_size_count; b++) {
+        uint32_t batch_size = batch_sizes[b];
+        memcpy(keys, targets, BENCH_LOOKUPS * sizeof(uint32_t));
+
+        /* a batch can hold an id more than once, its row is found once, so the sums are compared per distinct id */
+        uint64_t sum = 0;
+        uint64_t distinct_sum = 0;
+        start = now_us();
+        for (uint32_t first = 0; first < BENCH_LOOKUPS; first += batch_size) {
+            uint32_t count = BENCH_LOOKUPS - first < batch_size ? BENCH_LOOKUPS - first : batch_size;
+            uint32_t found = table_find_batch(table, keys + first, count, found_rows);
+            for (uint32_t i = 0; i < found; i++)
+                sum += found_rows[i].id;
+            pager_release(table->pager);
+        }
+        elapsed = now_us() - start;
+
+        /* the batch sorted and deduplicated its ids, the duplicates' rows are added back */
+        for (uint32_t first = 0; first < BENCH_LOOKUPS; first += batch_size) {
+            uint32_t count = BENCH_LOOKUPS - first < batch_size ? BENCH_LOOKUPS - first : batch_size;
+            memcpy(keys + first, targets + first, count * sizeof(uint32_t));
+            uint32_t distinct = table_sort_keys(keys + first, count);
+            for (uint32_t i = 0; i < distinct; i++)
+                distinct_sum += keys[first + i] % 2 == 1 && keys[first + i] < 2 * rows ? keys[first + i] : 0;
+        }
+        uint64_t duplicate_sum = 0;
+        for (uint32_t i = 0; i < BENCH_LOOKUPS; i++)
+            duplicate_sum += targets[i] % 2 == 1 && targets[i] < 2 * rows ? targets[i] : 0;
+
+        printf("%-10u %14.0f %s\n", batch_size, BENCH_LOOKUPS / (elapsed / 1e6),
+               sum == distinct_sum && duplicate_sum == expected ? "" : "MISMATCH");
+    }
+
+    free(found_rows);
+    free(keys);
+    free(targets);
+    db_close(table);
+    unlink(filename);
+
+    return 0;
+}
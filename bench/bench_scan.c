@@ -0,0 +1,171 @@
+#include "btree.h"
+#include "table.h"
+
+#include <time.h>
+
+/* Scan benchmark: fills a new table with `rows` rows (sequential ids), then scans the whole table
+ * row by row (`cursor_read_row()` and `cursor_advance()`) and a leaf at a time (`cursor_read_batch()`),
+ * once summing the ids and once comparing every email with a value that doesn't exist, and reports
+ * the rows scanned per second (and checks both scans agree). The batches are also scanned on the
+ * table's threads (`table_scan_parallel()`), with one thread per processor unless `threads` is given.
+ * usage: ./bench_scan [rows] [database file] [threads] */
+
+#define BENCH_ROUNDS 5
+
+/* current time in microseconds [double] */
+double now_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/* scans the table row by row, returns the sum of the ids (or the number of rows with the email) [uint64_t] */
+uint64_t bench_scan_rows(Table* table, const char* email) {
+    uint64_t result = 0;
+    Row row;
+    Cursor cursor;
+    table_start(table, &cursor);
+    while (!cursor.end_of_table) {
+        cursor_read_row(&cursor, &row);
+        if (email == NULL)
+            result += row.id;
+        else if (strcmp(row.email, email) == 0)
+            result++;
+        cursor_advance(&cursor);
+        pager_release(table->pager);
+    }
+    cursor_close(&cursor);
+
+    return result;
+}
+
+/* scans the table a leaf at a time, returns the same as `bench_scan_rows()` [uint64_t] */
+uint64_t bench_scan_batches(Table* table, const char* email) {
+    uint64_t result = 0;
+    size_t length = email == NULL ? 0 : strlen(email);
+    RowBatch batch;
+    Cursor cursor;
+    table_start(table, &cursor);
+    while (cursor_read_batch(&cursor, &batch) > 0) {
+        for (uint32_t i = 0; i < batch.count; i++) {
+            if (email == NULL)
+                result += batch.ids[i];
+            else if (batch.email_lengths[i] == length && memcmp(batch.emails[i], email, length) == 0)
+                result++;
+        }
+        pager_release(table->pager);
+    }
+    cursor_close(&cursor);
+
+    return result;
+}
+
+/* State of a part of the parallel scan */
+typedef struct {
+    const char* email;
+    size_t length;
+    uint64_t result;
+} BenchScanState;
+
+/* adds a batch of a part to the part's result, the same as `bench_scan_batches()` [bool] */
+bool bench_scan_part_batch(RowBatch* batch, void* state) {
+    BenchScanState* scan = state;
+    for (uint32_t i = 0; i < batch->count; i++) {
+        if (scan->email == NULL)
+            scan->result += batch->ids[i];
+        else if (batch->email_lengths[i] == scan->length && memcmp(batch->emails[i], scan->email, scan->length) == 0)
+            scan->result++;
+    }
+
+    return true;
+}
+
+/* scans the table on its threads, returns the same as `bench_scan_rows()` [uint64_t] */
+uint64_t bench_scan_parallel(Table* table, const char* email) {
+    BenchScanState* states = malloc(PARALLEL_SCAN_MAX_PARTS * sizeof(BenchScanState));
+    for (uint32_t p = 0; p < PARALLEL_SCAN_MAX_PARTS; p++) {
+        states[p].email = email;
+        states[p].length = email == NULL ? 0 : strlen(email);
+        states[p].result = 0;
+    }
+
+    uint32_t part_count = table_scan_parallel(table, bench_scan_part_batch, states, sizeof(BenchScanState), NULL);
+    uint64_t result = part_count == 0 ? bench_scan_batches(table, email) : 0;
+    for (uint32_t p = 0; p < part_count; p++)
+        result += states[p].result;
+
+    free(states);
+    return result;
+}
+
+int main(int argc, char* argv[]) {
+    uint32_t rows = argc > 1 ? (uint32_t)atol(argv[1]) : 1000000;
+    const char* filename = argc > 2 ? argv[2] : "bench.db";
+
+    char wal_filename[512];
+    snprintf(wal_filename, sizeof(wal_filename), "%s-wal", filename);
+    unlink(filename);
+    unlink(wal_filename);
+
+    DbOptions options = { .pager_mode = PAGER_BUFFERED, .cache_pages = PAGER_DEFAULT_MAX_FRAMES, .sync_level = SYNC_OFF,
+                          .threads = argc > 3 ? (uint32_t)atol(argv[3]) : 0 };
+    Table* table = db_open(filename, &options);
+
+    Row row;
+    for (uint32_t i = 1; i <= rows; i++) {
+        row.id = i;
+        snprintf(row.username, sizeof(row.username), "user%u", row.id);
+        snprintf(row.email, sizeof(row.email), "user%u@example.com", row.id);
+
+        Cursor cursor;
+        table_find(table, row.id, &cursor);
+        leaf_node_insert(&cursor, row.id, &row);
+        table->row_count++;
+        cursor_close(&cursor);
+        if (i % 1024 == 0) {
+            db_commit(table);
+            pager_release(table->pager);
+        }
+    }
+    db_commit(table);
+    pager_release(table->pager);
+
+    printf("rows: %u, threads: %u\n", rows, table->thread_count);
+    printf("%-8s %-6s %14s\n", "scan", "filter", "rows/s");
+
+    const char* filters[] = { NULL, "nobody@example.com" };
+    for (uint32_t f = 0; f < 2; f++) {
+        double row_time = 0;
+        double batch_time = 0;
+        double parallel_time = 0;
+        uint64_t row_result = 0;
+        uint64_t batch_result = 0;
+        uint64_t parallel_result = 0;
+        for (uint32_t round = 0; round < BENCH_ROUNDS; round++) {
+            double start = now_us();
+            row_result = bench_scan_rows(table, filters[f]);
+            row_time += now_us() - start;
+
+            start = now_us();
+            batch_result = bench_scan_batches(table, filters[f]);
+            batch_time += now_us() - start;
+
+            start = now_us();
+            parallel_result = bench_scan_parallel(table, filters[f]);
+            parallel_time += now_us() - start;
+            pager_release(table->pager);
+        }
+
+        const char* filter = filters[f] == NULL ? "none" : "email";
+        printf("%-8s %-6s %14.0f\n", "row", filter, BENCH_ROUNDS * (double)rows / (row_time / 1e6));
+        printf("%-8s %-6s %14.0f %s\n", "batch", filter, BENCH_ROUNDS * (double)rows / (batch_time / 1e6),
+               row_result == batch_result ? "" : "MISMATCH");
+        printf("%-8s %-6s %14.0f %s\n", "parallel", filter, BENCH_ROUNDS * (double)rows / (parallel_time / 1e6),
+               row_result == parallel_result ? "" : "MISMATCH");
+    }
+
+    db_close(table);
+    unlink(filename);
+
+    return 0;
+}
@@ -0,0 +1,135 @@
+#include "btree.h"
+#include "table.h"
+#include "search.h"
+
+#include <time.h>
+
+/* Key search benchmark: searches random keys in sorted arrays as big as a full leaf and a full
+ * internal node with every key search variant, and then looks up random rows of a table with
+ * every variant, and reports the lookups per second (and checks the variants agree).
+ * usage: ./bench_search [rows] [database file] */
+
+#define BENCH_LOOKUPS 10000000
+#define BENCH_TABLE_LOOKUPS 2000000
+
+typedef struct {
+    const char* name;
+    KeySearchFunction function;
+} BenchVariant;
+
+static BenchVariant variants[] = {
+    { "scalar", key_search_scalar },
+    { "sse4", key_search_sse4 },
+    { "avx2", key_search_avx2 },
+};
+static const uint32_t variant_count = sizeof(variants) / sizeof(variants[0]);
+
+/* current time in microseconds [double] */
+double now_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/* searches random keys in a sorted array of `count` keys with every variant [void] */
+void bench_array(uint32_t count) {
+    uint32_t keys[INTERNAL_NODE_MAX_CELLS];
+    /* sorted keys with gaps, so half of the searched keys aren't in the array */
+    for (uint32_t i = 0; i < count; i++)
+        keys[i] = 2 * i + 1;
+
+    uint32_t* targets = malloc(BENCH_LOOKUPS * sizeof(uint32_t));
+    srand(count);
+    for (uint32_t i = 0; i < BENCH_LOOKUPS; i++)
+        targets[i] = rand() % (2 * count + 2);
+
+    uint64_t expected = 0;
+    for (uint32_t v = 0; v < variant_count; v++) {
+        uint64_t sum = 0;
+        double start = now_us();
+        for (uint32_t i = 0; i < BENCH_LOOKUPS; i++)
+            sum += variants[v].function(keys, count, targets[i]);
+        double elapsed = now_us() - start;
+
+        if (v == 0)
+            expected = sum;
+        printf("%-8s %-8s %8u %16.0f %s\n", "array", variants[v].name, count, BENCH_LOOKUPS / (elapsed / 1e6),
+               sum == expected ? "" : "MISMATCH");
+    }
+
+    free(targets);
+}
+
+/* looks up random rows of a table with every variant [void] */
+void bench_table(const char* filename, uint32_t rows) {
+    char wal_filename[512];
+    snprintf(wal_filename, sizeof(wal_filename), "%s-wal", filename);
+    unlink(filename);
+    unlink(wal_filename);
+
+    DbOptions options = { .pager_mode = PAGER_BUFFERED, .cache_pages = PAGER_DEFAULT_MAX_FRAMES, .sync_level = SYNC_OFF };
+    Table* table = db_open(filename, &options);
+
+    Row row;
+    for (uint32_t i = 1; i <= rows; i++) {
+        row.id = i;
+        snprintf(row.username, sizeof(row.username), "user%u", row.id);
+        snprintf(row.email, sizeof(row.email), "user%u@example.com", row.id);
+
+        Cursor cursor;
+        table_find(table, row.id, &cursor);
+        leaf_node_insert(&cursor, row.id, &row);
+        table->row_count++;
+        cursor_close(&cursor);
+        if (i % 1024 == 0) {
+            db_commit(table);
+            pager_release(table->pager);
+        }
+    }
+    db_commit(table);
+    pager_release(table->pager);
+
+    uint32_t* targets = malloc(BENCH_TABLE_LOOKUPS * sizeof(uint32_t));
+    srand(rows);
+    for (uint32_t i = 0; i < BENCH_TABLE_LOOKUPS; i++)
+        targets[i] = 1 + rand() % rows;
+
+    KeySearchFunction selected = key_search;
+    uint64_t expected = 0;
+    for (uint32_t v = 0; v < variant_count; v++) {
+        key_search = variants[v].function;
+        uint64_t sum = 0;
+        double start = now_us();
+        for (uint32_t i = 0; i < BENCH_TABLE_LOOKUPS; i++) {
+            Cursor cursor;
+            table_find(table, targets[i], &cursor);
+            sum += cursor.page_number + cursor.cell_number;
+            cursor_close(&cursor);
+            if (i % 1024 == 0)
+                pager_release(table->pager);
+        }
+        double elapsed = now_us() - start;
+
+        if (v == 0)
+            expected = sum;
+        printf("%-8s %-8s %8u %16.0f %s\n", "table", variants[v].name, rows, BENCH_TABLE_LOOKUPS / (elapsed / 1e6),
+               sum == expected ? "" : "MISMATCH");
+    }
+    key_search = selected;
+
+    db_close(table);
+    unlink(filename);
+}
+
+int main(int argc, char* argv[]) {
+    uint32_t rows = argc > 1 ? (uint32_t)atol(argv[1]) : 1000000;
+    const char* filename = argc > 2 ? argv[2] : "bench.db";
+
+    printf("selected variant: %s\n", key_search_name(key_search));
+    printf("%-8s %-8s %8s %16s\n", "search", "variant", "keys", "lookups/s");
+    bench_array(LEAF_NODE_MAX_CELLS);
+    bench_array(INTERNAL_NODE_MAX_CELLS);
+    bench_table(filename, rows);
+
+    return 0;
+}
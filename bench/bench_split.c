@@ -0,0 +1,77 @@
+#include "btree.h"
+#include "table.h"
+
+#include <time.h>
+
+/* Split benchmark: inserts rows in random key order and reports the latency of inserts that
+ * split internal nodes, for every tenth of the table, the cost should stay flat as the table grows.
+ * usage: ./bench_split [rows] [database file] */
+
+#define BENCH_BUCKETS 10
+
+/* current time in microseconds [double] */
+double now_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+int main(int argc, char* argv[]) {
+    uint32_t rows = argc > 1 ? (uint32_t)atol(argv[1]) : 2000000;
+    const char* filename = argc > 2 ? argv[2] : "bench.db";
+
+    char wal_filename[512];
+    snprintf(wal_filename, sizeof(wal_filename), "%s-wal", filename);
+    unlink(filename);
+    unlink(wal_filename);
+
+    DbOptions options = { .pager_mode = PAGER_BUFFERED, .cache_pages = PAGER_DEFAULT_MAX_FRAMES, .sync_level = SYNC_OFF };
+    Table* table = db_open(filename, &options);
+
+    printf("%10s %6s %10s %14s %14s %14s\n", "rows", "depth", "splits", "split avg us", "split max us", "insert avg us");
+
+    uint32_t bucket_size = rows / BENCH_BUCKETS;
+    uint32_t splits = 0;
+    double split_total = 0, split_max = 0, insert_total = 0;
+
+    Row row;
+    for (uint32_t i = 1; i <= rows; i++) {
+        /* multiplying by an odd constant is a permutation of uint32_t, so keys never repeat */
+        row.id = i * 2654435761u;
+        snprintf(row.username, sizeof(row.username), "user%u", row.id);
+        snprintf(row.email, sizeof(row.email), "user%u@example.com", row.id);
+
+        uint32_t page_count = table->pager->page_count;
+        double start = now_us();
+
+        Cursor cursor;
+        table_find(table, row.id, &cursor);
+        leaf_node_insert(&cursor, row.id, &row);
+        table->row_count++;
+        cursor_close(&cursor);
+        db_commit(table);
+        pager_release(table->pager);
+
+        double elapsed = now_us() - start;
+        insert_total += elapsed;
+
+        /* a leaf split allocates one page, every internal split (or new root) one more */
+        if (table->pager->page_count - page_count > 1) {
+            splits++;
+            split_total += elapsed;
+            if (elapsed > split_max)
+                split_max = elapsed;
+        }
+
+        if (i % bucket_size == 0) {
+            printf("%10u %6u %10u %14.1f %14.1f %14.2f\n", i, table->internal_node_layers, splits,
+                   splits ? split_total / splits : 0, split_max, insert_total / bucket_size);
+            splits = 0;
+            split_total = split_max = insert_total = 0;
+        }
+    }
+
+    db_close(table);
+    unlink(filename);
+    return 0;
+}
@@ -0,0 +1,22 @@
+#ifndef ALLOC_H
+#define ALLOC_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Heap allocation counter: the program is linked with `-Wl,--wrap=malloc` (and `calloc`,
+ * `realloc`), so the allocations made by its own code go through the wrappers in alloc.c and are
+ * counted (the C library's own allocations, like `getline()`'s, aren't). The insert and lookup
+ * statements don't allocate once the buffer pool and the log's buffers have grown, `.allocations`
+ * prints the allocations of the last statement */
+extern uint64_t allocation_count;
+extern uint64_t statement_allocations; // allocations of the last statement (set by `execute_statement()`)
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* pointer, size_t size);
+void* __wrap_malloc(size_t size);
+void* __wrap_calloc(size_t count, size_t size);
+void* __wrap_realloc(void* pointer, size_t size);
+
+#endif
@@ -5,7 +5,8 @@
 #include <stdint.h>
 #include "table.h"
 
-typedef enum {NODE_INTERNAL, NODE_LEAF} NodeType;
+/* the index nodes are handled by index.c and the hash index pages by hash.c */
+typedef enum {NODE_INTERNAL, NODE_LEAF, NODE_INDEX_INTERNAL, NODE_INDEX_LEAF, NODE_HASH_META, NODE_HASH_DIRECTORY, NODE_HASH_BUCKET} NodeType;
 
 
 /* Node header layout */
@@ -13,6 +14,8 @@ static const uint32_t NODE_TYPE_SIZE = sizeof(uint8_t);
 static const uint32_t NODE_TYPE_OFFSET = 0;
 static const uint32_t IS_ROOT_SIZE = sizeof(uint8_t);
 static const uint32_t IS_ROOT_OFFSET = NODE_TYPE_SIZE;
+/* the parent pointer isn't maintained anymore (splits use the cursor's path),
+ * the field is kept so the node layout stays the same */
 static const uint32_t PARENT_POINTER_SIZE = sizeof(uint32_t);
 static const uint32_t PARENT_POINTER_OFFSET = IS_ROOT_OFFSET + IS_ROOT_SIZE;
 static const uint32_t COMMON_NODE_HEADER_SIZE =  NODE_TYPE_SIZE + IS_ROOT_SIZE + PARENT_POINTER_SIZE;
@@ -22,21 +25,26 @@ static const uint32_t LEAF_NODE_NUM_CELLS_SIZE = sizeof(uint32_t);
 static const uint32_t LEAF_NODE_NUM_CELLS_OFFSET = COMMON_NODE_HEADER_SIZE;
 static const uint32_t LEAF_NODE_NEXT_LEAF_SIZE = sizeof(uint32_t);
 static const uint32_t LEAF_NODE_NEXT_LEAF_OFFSET = LEAF_NODE_NUM_CELLS_OFFSET + LEAF_NODE_NUM_CELLS_SIZE;
-static const uint32_t LEAF_NODE_HEADER_SIZE = COMMON_NODE_HEADER_SIZE + LEAF_NODE_NUM_CELLS_SIZE + LEAF_NODE_NEXT_LEAF_SIZE;
-
-/* Leaf node body layout */
+static const uint32_t LEAF_NODE_CONTENT_START_SIZE = sizeof(uint16_t); // records are stored from here to the end of the page
+static const uint32_t LEAF_NODE_CONTENT_START_OFFSET = LEAF_NODE_NEXT_LEAF_OFFSET + LEAF_NODE_NEXT_LEAF_SIZE;
+static const uint32_t LEAF_NODE_FRAGMENTED_SIZE = sizeof(uint16_t); // bytes of unused records in the record area
+static const uint32_t LEAF_NODE_FRAGMENTED_OFFSET = LEAF_NODE_CONTENT_START_OFFSET + LEAF_NODE_CONTENT_START_SIZE;
+static const uint32_t LEAF_NODE_HEADER_SIZE = LEAF_NODE_FRAGMENTED_OFFSET + LEAF_NODE_FRAGMENTED_SIZE;
+
+/* Leaf node body layout (slotted page): the keys of all cells are one array after the header
+ * (so a search only reads the keys), the record directory (offset and length of each record)
+ * follows the keys, and variable length records grow from the end of the page towards them */
 static const uint32_t LEAF_NODE_KEY_SIZE = sizeof(uint32_t);
-static const uint32_t LEAF_NODE_KEY_OFFSET = 0;
-static const uint32_t LEAF_NODE_VALUE_SIZE = ROW_SIZE;
-static const uint32_t LEAF_NODE_VALUE_OFFSET = LEAF_NODE_KEY_OFFSET + LEAF_NODE_KEY_SIZE;
-static const uint32_t LEAF_NODE_CELL_SIZE = LEAF_NODE_KEY_SIZE + LEAF_NODE_VALUE_SIZE;
+static const uint32_t LEAF_NODE_KEYS_OFFSET = LEAF_NODE_HEADER_SIZE;
+static const uint32_t LEAF_NODE_RECORD_OFFSET_SIZE = sizeof(uint16_t);
+static const uint32_t LEAF_NODE_RECORD_OFFSET_OFFSET = 0;
+static const uint32_t LEAF_NODE_RECORD_LENGTH_SIZE = sizeof(uint16_t);
+static const uint32_t LEAF_NODE_RECORD_LENGTH_OFFSET = LEAF_NODE_RECORD_OFFSET_OFFSET + LEAF_NODE_RECORD_OFFSET_SIZE;
+static const uint32_t LEAF_NODE_RECORD_ENTRY_SIZE = LEAF_NODE_RECORD_OFFSET_SIZE + LEAF_NODE_RECORD_LENGTH_SIZE;
+static const uint32_t LEAF_NODE_SLOT_SIZE = LEAF_NODE_KEY_SIZE + LEAF_NODE_RECORD_ENTRY_SIZE; // per cell, without the record
 static const uint32_t LEAF_NODE_SPACE_FOR_CELLS = PAGE_SIZE - LEAF_NODE_HEADER_SIZE;
-static const uint32_t LEAF_NODE_MAX_CELLS = LEAF_NODE_SPACE_FOR_CELLS / LEAF_NODE_CELL_SIZE;
-
-/* LEAF NODE SPLIT */
-static const uint32_t LEAF_NODE_RIGHT_SPLIT_COUNT = (LEAF_NODE_MAX_CELLS + 1) / 2;
-static const uint32_t LEAF_NODE_LEFT_SPLIT_COUNT = (LEAF_NODE_MAX_CELLS + 1) - LEAF_NODE_RIGHT_SPLIT_COUNT;
-
+/* upper bound, with the shortest possible records */
+static const uint32_t LEAF_NODE_MAX_CELLS = LEAF_NODE_SPACE_FOR_CELLS / (LEAF_NODE_SLOT_SIZE + ROW_MIN_SIZE);
 
 /* Internal node header layout */ 
 static const uint32_t INTERNAL_NODE_NUM_KEYS_SIZE = sizeof(uint32_t);
@@ -45,19 +53,25 @@ static const uint32_t INTERNAL_NODE_RIGHT_CHILD_SIZE = sizeof(uint32_t);
 static const uint32_t INTERNAL_NODE_RIGHT_CHILD_OFFSET = COMMON_NODE_HEADER_SIZE + INTERNAL_NODE_NUM_KEYS_SIZE; /* ? */
 static const uint32_t INTERNAL_NODE_HEADER_SIZE = COMMON_NODE_HEADER_SIZE + INTERNAL_NODE_NUM_KEYS_SIZE + INTERNAL_NODE_RIGHT_CHILD_SIZE;
 
-/* Internal node body layout */
+/* the `INTERNAL_NODE_MAX_CELLS` is the number of keys, children and row counts
+ * (plus the right child's row count) that 4096bytes can hold */
+static const uint32_t INTERNAL_NODE_MAX_CELLS = 339;
+
+/* Internal node body layout, the keys are one array after the header (so a search only reads
+ * the keys), the children (except the right child) are another array after the keys and the
+ * number of rows under every child is a third array after the children (the right child's
+ * count is its last entry), the arrays have room for `INTERNAL_NODE_MAX_CELLS` children */
 static const uint32_t INTERNAL_NODE_KEY_SIZE = sizeof(uint32_t);
 static const uint32_t INTERNAL_NODE_CHILD_SIZE = sizeof(uint32_t);
-static const uint32_t INTERNAL_NODE_CELL_SIZE = INTERNAL_NODE_KEY_SIZE + INTERNAL_NODE_CHILD_SIZE;
-
-/* the `INTERNAL_NODE_MAX_CELLS` should be 511/512 (thats the maximum number
- * of child pointers that 4096bytes can hold */
-static const uint32_t INTERNAL_NODE_MAX_CELLS = 510;
+static const uint32_t INTERNAL_NODE_ROWS_SIZE = sizeof(uint32_t);
+static const uint32_t INTERNAL_NODE_KEYS_OFFSET = INTERNAL_NODE_HEADER_SIZE;
+static const uint32_t INTERNAL_NODE_CHILDREN_OFFSET = INTERNAL_NODE_KEYS_OFFSET + INTERNAL_NODE_MAX_CELLS * INTERNAL_NODE_KEY_SIZE;
+static const uint32_t INTERNAL_NODE_ROWS_OFFSET = INTERNAL_NODE_CHILDREN_OFFSET + INTERNAL_NODE_MAX_CELLS * INTERNAL_NODE_CHILD_SIZE;
 
-/* INTERNAL NODE SPLIT */
-static const uint32_t INTERNAL_NODE_SPLIT_KEY_INDEX = (INTERNAL_NODE_MAX_CELLS+1)/2;
-static const uint32_t INTERNAL_NODE_RIGHT_SPLIT_KEY_COUNT = INTERNAL_NODE_MAX_CELLS/2;
-static const uint32_t INTERNAL_NODE_LEFT_SPLIT_KEY_COUNT = INTERNAL_NODE_MAX_CELLS - INTERNAL_NODE_RIGHT_SPLIT_KEY_COUNT;
+/* Underflow limits, a node below them is merged with (or borrows from) a sibling after a delete,
+ * they're a quarter of the node, so a node that was just split doesn't merge again after a few deletes */
+static const uint32_t LEAF_NODE_MIN_SPACE = LEAF_NODE_SPACE_FOR_CELLS / 4;
+static const uint32_t INTERNAL_NODE_MIN_KEYS = INTERNAL_NODE_MAX_CELLS / 4 > 0 ? INTERNAL_NODE_MAX_CELLS / 4 : 1;
 
 
 void print_page_information(Table* table, uint32_t page_number);
@@ -72,39 +86,64 @@ bool is_node_root(void* node);
 void set_node_root(void* node, bool is_root);
 
 NodeType get_node_type(void* node);
-uint32_t get_node_max_key(void* node);
+uint32_t get_node_max_key(Pager* pager, void* node);
 void set_node_type(void* node, NodeType type);
 
 // leaf node
 uint32_t* leaf_node_num_cells(void* node);
-void* leaf_node_cell(void* node, uint32_t cell_num);
+uint32_t* leaf_node_keys(void* node);
+void* leaf_node_record_entry(void* node, uint32_t cell_num);
 uint32_t* leaf_node_next_leaf(void* node);
+uint16_t* leaf_node_content_start(void* node);
+uint16_t* leaf_node_fragmented_bytes(void* node);
 uint32_t* leaf_node_key(void* node, uint32_t cell_num);
+uint16_t* leaf_node_record_offset(void* node, uint32_t cell_num);
+uint16_t* leaf_node_record_length(void* node, uint32_t cell_num);
 void* leaf_node_value(void* node, uint32_t cell_num);
+uint32_t leaf_node_free_space(void* node);
+uint32_t leaf_node_used_space(void* node);
 void initialize_leaf_node(void* node);
+void leaf_node_place_cell(void* node, uint32_t cell_num, uint32_t key, const void* record, uint32_t length);
+void leaf_node_defragment(void* node);
 
 void leaf_node_insert(Cursor* cursor, uint32_t key, Row* value);
 void leaf_node_split_and_insert(Cursor* cursor, uint32_t key, Row* value);
-Cursor* leaf_node_find(Table* table, uint32_t page_num, uint32_t key);
+void leaf_node_update(Cursor* cursor, Row* value);
+void leaf_node_zone_map(Pager* pager, uint32_t page_number, void* node);
+void zone_map_add_row(ZoneMap* zone, Row* row);
+void leaf_node_find(Table* table, uint32_t page_num, uint32_t key, Cursor* cursor);
+
+void leaf_node_remove_cells(void* node, uint32_t cell_num, uint32_t count);
+void leaf_node_delete(Cursor* cursor, uint32_t count);
+void leaf_node_rebalance(Table* table, uint32_t* path, uint32_t depth, uint32_t page_number);
+void leaf_node_merge(void* left, void* right);
+void leaf_node_redistribute(void* left, void* right);
 
 
 // internal node
-uint32_t* node_parent(void* node);
 uint32_t* internal_node_num_keys(void* node);
 uint32_t* internal_node_right_child(void* node);
-uint32_t* internal_node_cell(void* node, uint32_t cell_number);
+uint32_t* internal_node_keys(void* node);
+uint32_t* internal_node_children(void* node);
 uint32_t* internal_node_child(void* node, uint32_t child_number);
 uint32_t* internal_node_key(void* node, uint32_t key_number);
-uint32_t get_node_max_key(void* node);
-uint32_t leaf_node_get_smallest(Table* table, void* root);
+uint32_t* internal_node_rows(void* node);
+uint32_t* internal_node_child_rows(void* node, uint32_t child_number);
+uint32_t* internal_node_right_child_rows(void* node);
+uint32_t node_row_count(void* node);
+void internal_node_set_child_rows(void* node, uint32_t child_page_number, void* child);
+void internal_node_add_rows(Table* table, uint32_t* path, uint32_t depth, uint32_t page_number, uint32_t key, int32_t delta);
 void update_internal_node_key(void* node, uint32_t old_key, uint32_t new_key);
 void initialize_internal_node(void* node);
 
-void internal_node_insert(Table* table, uint32_t parent_page_number, uint32_t child_page_number);
-void internal_node_split_and_insert(Table* table, uint32_t node_page_number);
-void create_new_internal_root(Table* table, void* root, uint32_t key, uint32_t left_split_pn, uint32_t right_split_pn);
-Cursor* internal_node_find(Table* table, uint32_t page_number, uint32_t key);
+void internal_node_insert(Table* table, uint32_t* path, uint32_t level, uint32_t child_page_number);
+void internal_node_split_and_insert(Table* table, uint32_t* path, uint32_t level, uint32_t child_page_number);
+bool internal_node_is_rightmost(Table* table, uint32_t* path, uint32_t level);
+void internal_node_find(Table* table, uint32_t page_number, uint32_t key, Cursor* cursor);
 uint32_t internal_node_find_child(void* node, uint32_t key);
+uint32_t internal_node_child_index(void* node, uint32_t child_page_number);
+void internal_node_remove_child(void* node, uint32_t child_number);
+void internal_node_rebalance(Table* table, uint32_t* path, uint32_t level);
 
 
 void create_new_root(Table* table, uint32_t right_child_page_number);
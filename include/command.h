@@ -16,5 +16,7 @@ typedef enum {
 MetaCommandResult do_meta_command(InputBuffer* input_buffer, Table* table);
 
 MetaCommandResult page_info_command(InputBuffer* input_buffer, Table* table);
+MetaCommandResult import_command(InputBuffer* input_buffer, Table* table);
+MetaCommandResult mode_command(InputBuffer* input_buffer);
 
 #endif
@@ -0,0 +1,56 @@
+#ifndef FILTER_H
+#define FILTER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "table.h"
+
+/* Column predicates on the username or email, evaluated over the rows of a batch (the values in the
+ * leaf, see `RowBatch`) into a selection vector, the indexes of the matching rows in the batch.
+ * `username = x` is an equality, `like` patterns can have a `%` at the start and/or end: `x%` is
+ * a prefix, `%x` a suffix and `%x%` a substring (other characters, `_` too, match themselves).
+ * The lengths of the batch are compared first (a length byte per row, 16 or 32 at once), so only
+ * the rows that are long enough are compared byte by byte */
+typedef enum {MATCH_EQUAL, MATCH_PREFIX, MATCH_SUFFIX, MATCH_CONTAINS} MatchKind;
+
+typedef struct {
+    IndexColumn column;
+    MatchKind match;
+    uint32_t length;
+    char value[COLUMN_EMAIL_SIZE + 1];
+    char tail[16]; // the value's last (up to) 16 bytes at the end of the block, zeros before them
+    ZoneFilter zone; // the leaves a scan can pass over, see zone.h
+} Predicate;
+
+/* Filter variants, every one writes the indexes of the values that match the predicate into the
+ * selection vector and returns their number */
+typedef uint32_t (*FilterFunction)(const Predicate* predicate, const char** values, const uint8_t* lengths,
+                                   uint32_t count, uint16_t* selection);
+
+/* the variant used by the scans, it's selected on the first call by the features of the CPU */
+extern FilterFunction filter_values;
+
+void predicate_init(Predicate* predicate, IndexColumn column, MatchKind match, const char* value);
+uint32_t filter_batch(const Predicate* predicate, RowBatch* batch, uint16_t* selection);
+
+uint32_t filter_values_scalar(const Predicate* predicate, const char** values, const uint8_t* lengths,
+                              uint32_t count, uint16_t* selection);
+uint32_t filter_values_sse2(const Predicate* predicate, const char** values, const uint8_t* lengths,
+                            uint32_t count, uint16_t* selection);
+uint32_t filter_values_avx2(const Predicate* predicate, const char** values, const uint8_t* lengths,
+                            uint32_t count, uint16_t* selection);
+
+bool filter_match_scalar(const Predicate* predicate, const char* value, uint32_t length);
+bool filter_tail_sse2(const Predicate* predicate, const char* end);
+bool filter_equal_sse2(const char* a, const char* b, uint32_t length);
+bool filter_find_sse2(const char* haystack, uint32_t length, const char* needle, uint32_t needle_length);
+bool filter_match_sse2(const Predicate* predicate, const char* value, uint32_t length);
+bool filter_equal_avx2(const char* a, const char* b, uint32_t length);
+bool filter_find_avx2(const char* haystack, uint32_t length, const char* needle, uint32_t needle_length);
+bool filter_match_avx2(const Predicate* predicate, const char* value, uint32_t length);
+
+FilterFunction filter_select();
+const char* filter_name(FilterFunction function);
+
+#endif
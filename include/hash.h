@@ -0,0 +1,77 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "table.h"
+#include "btree.h"
+
+/* Hash index on the id (`create hash index on id`), an access method for exact lookups next to
+ * the tree: linear hashing over bucket pages that hold whole rows (the same slotted layout as the
+ * table's leaves, the sibling pointer links a bucket's overflow pages), so a lookup reads the
+ * bucket's directory page (cached, one per `HASH_DIRECTORY_ENTRIES` buckets) and one bucket page
+ * instead of every level of the tree. The tree still holds the rows for range scans, counts and
+ * offsets, the hash index is kept up to date by every statement that changes rows.
+ *
+ * Linear hashing: the buckets below the split pointer were split in this round and use one more
+ * bit of the hash. Whenever the buckets are fuller than `HASH_LOAD_FACTOR` on average, the bucket
+ * at the split pointer is split into itself and a new last bucket */
+
+/* percentage of the bucket space used before the next bucket is split */
+#define HASH_LOAD_FACTOR 75
+
+/* the buckets of a new hash index are created with `pager_commit()` every this many buckets, and
+ * the rows of at least this many buckets are added at once (a quarter of the buffer pool's frames
+ * if that's more, see `hash_create()`) */
+#define HASH_BUILD_COMMIT_INTERVAL 1024
+
+/* Hash meta page layout (the page stored in the database header): the common header,
+ * the round (level), the split pointer, the number of buckets and of directory pages,
+ * the bytes used by the cells of all buckets, then the page numbers of the directory pages */
+static const uint32_t HASH_META_LEVEL_OFFSET = COMMON_NODE_HEADER_SIZE;
+static const uint32_t HASH_META_SPLIT_OFFSET = HASH_META_LEVEL_OFFSET + sizeof(uint32_t);
+static const uint32_t HASH_META_BUCKET_COUNT_OFFSET = HASH_META_SPLIT_OFFSET + sizeof(uint32_t);
+static const uint32_t HASH_META_DIRECTORY_COUNT_OFFSET = HASH_META_BUCKET_COUNT_OFFSET + sizeof(uint32_t);
+static const uint32_t HASH_META_USED_BYTES_OFFSET = HASH_META_DIRECTORY_COUNT_OFFSET + sizeof(uint32_t); // uint64_t
+static const uint32_t HASH_META_HEADER_SIZE = HASH_META_USED_BYTES_OFFSET + sizeof(uint64_t);
+static const uint32_t HASH_META_MAX_DIRECTORY_PAGES = (PAGE_SIZE - HASH_META_HEADER_SIZE) / sizeof(uint32_t);
+
+/* Hash directory page layout: the common header, then the page numbers of the buckets */
+static const uint32_t HASH_DIRECTORY_HEADER_SIZE = COMMON_NODE_HEADER_SIZE;
+static const uint32_t HASH_DIRECTORY_ENTRIES = (PAGE_SIZE - HASH_DIRECTORY_HEADER_SIZE) / sizeof(uint32_t);
+
+/* buckets aren't split anymore when the directory is full (they get longer overflow chains),
+ * that's about a million buckets of 4KB */
+static const uint32_t HASH_MAX_BUCKETS = HASH_META_MAX_DIRECTORY_PAGES * HASH_DIRECTORY_ENTRIES;
+
+
+uint32_t hash_key(uint32_t key);
+
+/* Hash pages */
+uint32_t* hash_meta_level(void* meta);
+uint32_t* hash_meta_split(void* meta);
+uint32_t* hash_meta_bucket_count(void* meta);
+uint32_t* hash_meta_directory_count(void* meta);
+uint64_t* hash_meta_used_bytes(void* meta);
+uint32_t* hash_meta_directory(void* meta, uint32_t directory_number);
+uint32_t* hash_directory_entry(void* directory, uint32_t entry_number);
+void initialize_hash_bucket(void* node);
+uint32_t hash_bucket_number(void* meta, uint32_t key);
+uint32_t hash_bucket_page(Pager* pager, uint32_t meta_page_number, uint32_t bucket_number);
+
+/* Lookups and changes */
+bool hash_find(Table* table, uint32_t key, uint32_t* page_number, uint32_t* cell_number);
+bool hash_read_row(Table* table, uint32_t key, Row* row);
+void hash_bucket_place(Table* table, uint32_t page_number, uint32_t key, const void* record, uint32_t length);
+void hash_insert(Table* table, Row* row);
+void hash_delete(Table* table, uint32_t key);
+void hash_update(Table* table, Row* row);
+uint32_t hash_add_bucket(Pager* pager, uint32_t meta_page_number);
+void hash_split(Table* table);
+
+/* Building and dropping */
+uint32_t hash_create(Table* table);
+void hash_free_pages(Table* table, uint32_t meta_page_number);
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef IMPORT_H
+#define IMPORT_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "table.h"
+#include "btree.h"
+
+/* memory used for sorting one run of the external merge sort (64MB) */
+#define IMPORT_SORT_MEMORY (size_t)(64 * 1024 * 1024)
+
+/* rows read from a run file at once while merging */
+#define IMPORT_RUN_BUFFER_ROWS 256
+
+/* the import is committed (logged) every this many built pages (or rows inserted one by one),
+ * so the before-images kept for the statement don't grow with the size of the import */
+#define IMPORT_COMMIT_INTERVAL 1024
+
+/* rows are sorted as fixed size cells, the key followed by the serialized row (record) */
+#define IMPORT_CELL_SIZE (LEAF_NODE_KEY_SIZE + ROW_MAX_SIZE)
+
+/* default fill factor (percent of the node capacity used by the built nodes) */
+#define IMPORT_DEFAULT_FILL_FACTOR 100
+
+/* Reader of `id,username,email` lines */
+typedef struct {
+    FILE* file;
+    char* line;
+    size_t line_capacity;
+    uint32_t line_number;
+} CsvReader;
+
+/* Sorted run of rows (import cells) in a temporary file, used by the merge */
+typedef struct {
+    FILE* file;
+    void* cells; // buffer of `IMPORT_RUN_BUFFER_ROWS` cells
+    uint32_t count; // cells in the buffer
+    uint32_t position; // next cell in the buffer
+} ImportRun;
+
+/* One level of the tree that's being built, only the rightmost (open) node of every
+ * level is kept in memory until it's full */
+typedef struct {
+    void* node; // the open node (staging page, not a pager page yet)
+    uint32_t count; // cells in the open leaf or children in the open internal node
+    uint32_t max_key; // max key of the open node
+    uint32_t rows; // rows under the open node
+} BuildLevel;
+
+/* Bottom-up tree builder, nodes are written to new pages in the order they are
+ * completed, so the pages are allocated (and written) sequentially */
+typedef struct {
+    Table* table;
+    BuildLevel levels[BTREE_MAX_DEPTH + 1];
+    uint32_t height; // number of levels with an open node
+    uint32_t leaf_fill; // bytes of cells (slots and records) per leaf
+    uint32_t internal_fill; // children per internal node
+    uint32_t previous_leaf; // page of the last written leaf (0 == none), its sibling pointer is set by the next one
+    uint32_t since_commit; // pages built (or rows inserted) since the last commit
+    bool bulk; // false if the table wasn't empty, the rows are then inserted one by one
+    bool has_last_key;
+    uint32_t last_key;
+    uint64_t rows;
+    uint64_t duplicates;
+} TreeBuilder;
+
+
+void import_csv(Table* table, const char* filename, uint32_t fill_factor);
+void import_row(TreeBuilder* builder, void* cell);
+
+/* CSV reading */
+bool csv_open(CsvReader* reader, const char* filename);
+int csv_next_row(CsvReader* reader, Row* row);
+void csv_close(CsvReader* reader);
+
+/* External merge sort */
+int compare_cells(const void* a, const void* b);
+FILE* import_write_run(void* cells, uint32_t count);
+bool import_run_load(ImportRun* run);
+uint32_t import_run_key(ImportRun* run);
+void import_heap_down(ImportRun* runs, uint32_t* heap, uint32_t size, uint32_t index);
+void import_merge_runs(TreeBuilder* builder, FILE** run_files, uint32_t run_count);
+
+/* Bottom-up tree building */
+void builder_init(TreeBuilder* builder, Table* table, uint32_t fill_factor);
+void builder_add_cell(TreeBuilder* builder, void* cell);
+void builder_add_child(TreeBuilder* builder, uint32_t level, uint32_t page_number, uint32_t max_key, uint32_t rows);
+void builder_write_node(TreeBuilder* builder, uint32_t level);
+void builder_finish(TreeBuilder* builder);
+
+/* Row by row loading (table isn't empty) */
+bool import_insert_cell(Table* table, void* cell);
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef INDEX_H
+#define INDEX_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "table.h"
+#include "btree.h"
+
+/* Secondary indexes (`create index on username` / `create index on email`) are B+trees in the
+ * same file as the table, with their own node types. Their entries are the first
+ * `INDEX_PREFIX_SIZE` bytes of the column value (zero padded) followed by the id of the row,
+ * so every entry is unique and the entries of equal values are ordered by id. Values longer
+ * than the prefix can share an entry prefix, so a lookup compares the whole value of the row */
+#define INDEX_PREFIX_SIZE 28
+
+/* Index entry, compared with `index_entry_compare()` */
+typedef struct {
+    char prefix[INDEX_PREFIX_SIZE];
+    uint32_t id;
+} IndexEntry;
+
+/* the index is built with `pager_commit()` every this many pages, like an import */
+#define INDEX_BUILD_COMMIT_INTERVAL 1024
+
+/* Index leaf node layout: the common header, the number of entries and the next leaf,
+ * then the sorted entries */
+static const uint32_t INDEX_ENTRY_SIZE = sizeof(IndexEntry);
+static const uint32_t INDEX_LEAF_NUM_CELLS_OFFSET = COMMON_NODE_HEADER_SIZE;
+static const uint32_t INDEX_LEAF_NEXT_LEAF_OFFSET = INDEX_LEAF_NUM_CELLS_OFFSET + sizeof(uint32_t);
+static const uint32_t INDEX_LEAF_HEADER_SIZE = INDEX_LEAF_NEXT_LEAF_OFFSET + sizeof(uint32_t);
+static const uint32_t INDEX_LEAF_MAX_CELLS = (PAGE_SIZE - INDEX_LEAF_HEADER_SIZE) / INDEX_ENTRY_SIZE;
+
+/* Index internal node layout: the common header, the number of keys and the right child,
+ * then the keys (the max entry of every child but the right one) and the children arrays.
+ * Like in the table's tree, the key of a child is an upper bound of its entries */
+static const uint32_t INDEX_INTERNAL_NUM_KEYS_OFFSET = COMMON_NODE_HEADER_SIZE;
+static const uint32_t INDEX_INTERNAL_RIGHT_CHILD_OFFSET = INDEX_INTERNAL_NUM_KEYS_OFFSET + sizeof(uint32_t);
+static const uint32_t INDEX_INTERNAL_HEADER_SIZE = INDEX_INTERNAL_RIGHT_CHILD_OFFSET + sizeof(uint32_t);
+static const uint32_t INDEX_INTERNAL_MAX_CELLS = (PAGE_SIZE - INDEX_INTERNAL_HEADER_SIZE) / (INDEX_ENTRY_SIZE + sizeof(uint32_t));
+static const uint32_t INDEX_INTERNAL_CHILDREN_OFFSET = INDEX_INTERNAL_HEADER_SIZE + INDEX_INTERNAL_MAX_CELLS * INDEX_ENTRY_SIZE;
+
+/* Cursor over the entries of an index (the caller's, usually on its stack), its leaf stays
+ * pinned until `index_cursor_close()` */
+typedef struct {
+    Table* table;
+    uint32_t page_number;
+    uint32_t cell_number;
+    bool end_of_index;
+} IndexCursor;
+
+/* A node of an index that's being built */
+typedef struct {
+    uint32_t page_number;
+    IndexEntry max_entry;
+} IndexBuildNode;
+
+
+const char* index_column_name(IndexColumn column);
+char* index_row_value(Row* row, IndexColumn column);
+void index_entry_make(IndexEntry* entry, const char* value, uint32_t id);
+int index_entry_compare(const void* a, const void* b);
+bool index_entry_matches(IndexEntry* entry, const char* value);
+
+/* Index nodes */
+uint32_t* index_leaf_num_cells(void* node);
+uint32_t* index_leaf_next_leaf(void* node);
+IndexEntry* index_leaf_entry(void* node, uint32_t cell_number);
+void initialize_index_leaf(void* node);
+uint32_t index_leaf_find(void* node, IndexEntry* entry);
+uint32_t* index_internal_num_keys(void* node);
+uint32_t* index_internal_right_child(void* node);
+IndexEntry* index_internal_key(void* node, uint32_t key_number);
+uint32_t* index_internal_children(void* node);
+uint32_t* index_internal_child(void* node, uint32_t child_number);
+void initialize_index_internal(void* node);
+uint32_t index_internal_find_child(void* node, IndexEntry* entry);
+
+/* Index maintenance */
+uint32_t index_find_leaf(Table* table, IndexColumn column, IndexEntry* entry, uint32_t* path, uint32_t* depth);
+void index_insert(Table* table, IndexColumn column, Row* row);
+void index_internal_insert(Table* table, IndexColumn column, uint32_t* path, uint32_t depth,
+                           uint32_t left_page_number, IndexEntry* separator, uint32_t right_page_number);
+void index_delete(Table* table, IndexColumn column, Row* row);
+void index_insert_row(Table* table, Row* row);
+void index_delete_row(Table* table, Row* row);
+bool index_exists(Table* table);
+
+/* Building and dropping */
+uint32_t index_create(Table* table, IndexColumn column);
+uint32_t index_build(Table* table, IndexEntry* entries, uint32_t count);
+void index_free_pages(Table* table, uint32_t page_number);
+void index_rebuild_all(Table* table);
+
+/* Lookups */
+void index_seek(Table* table, IndexColumn column, IndexEntry* entry, IndexCursor* cursor);
+IndexEntry* index_cursor_entry(IndexCursor* cursor);
+void index_cursor_advance(IndexCursor* cursor);
+void index_cursor_skip_empty(IndexCursor* cursor);
+void index_cursor_close(IndexCursor* cursor);
+
+#endif
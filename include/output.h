@@ -0,0 +1,35 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Result output: the rows (and counts) of a statement are formatted into one large buffer, which is
+ * written to the standard output when it's full and when the statement completes, instead of one
+ * `printf()` per row. `.mode` selects the format:
+ *   text   `(id, username, email)` lines (the default)
+ *   csv    `id,username,email` lines (the format of `.import`), values with a comma or a double
+ *          quote are quoted
+ *   binary every row as its id (4 bytes, little endian) and its record (the username and email, each
+ *          after a length byte, as they are stored in the leaves), counts as 8 bytes (little endian)
+ * The prompt is only printed in text mode, so the output of the other modes holds only the results */
+typedef enum {OUTPUT_TEXT, OUTPUT_CSV, OUTPUT_BINARY} OutputMode;
+
+/* size of the output buffer, it holds thousands of rows */
+#define OUTPUT_BUFFER_SIZE (1 << 20)
+
+/* the longest row in any format: the id, quoted and doubled quotes in csv, separators */
+#define OUTPUT_MAX_ROW_SIZE 1024
+
+extern OutputMode output_mode;
+
+uint32_t output_format_number(uint64_t number, char* destination);
+uint32_t output_format_csv_value(const char* value, uint32_t length, char* destination);
+char* output_reserve();
+void output_row(uint32_t id, const char* username, uint32_t username_length, const char* email, uint32_t email_length);
+void output_count(uint64_t count);
+void output_flush();
+bool output_set_mode(const char* name);
+const char* output_mode_name(OutputMode mode);
+
+#endif
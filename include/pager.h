@@ -0,0 +1,144 @@
+#ifndef PAGER_H
+#define PAGER_H
+
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <pthread.h>
+
+#include "zone.h"
+
+/* maximum size of the database file (2^28 pages * 4096 bytes = 1TB), the tree can grow to
+ * any depth, so this is the only limit on the number of rows */
+#define TABLE_MAX_PAGES ((uint32_t)1 << 28)
+
+/* default frame budget of the buffer pool (131072 frames * 4096 bytes = 512MB) */
+#define PAGER_DEFAULT_MAX_FRAMES (uint32_t)131072
+
+/* maximum number of pages written with a single `pwritev()` call */
+#define PAGER_MAX_IOV 256
+
+/* Page constants */
+static const uint32_t PAGE_SIZE = 4096;
+
+/* Free page layout, a free page only holds the page number of the next free page */
+static const uint32_t FREE_PAGE_NEXT_OFFSET = 0;
+
+/* Pager backends */
+typedef enum {
+    PAGER_BUFFERED, // pages are read into (and written back from) the buffer pool
+    PAGER_MMAP // the database file is mapped into memory (privately), the kernel page cache is the only cache
+} PagerMode;
+
+/* Durability levels of the write-ahead log */
+typedef enum {
+    SYNC_OFF, // the log is written but never synced
+    SYNC_NORMAL, // group commit, one `fdatasync()` for many statements
+    SYNC_FULL // every statement is synced before it completes
+} SyncLevel;
+
+typedef struct Wal Wal;
+
+/* Buffer pool frame structure, one frame holds one cached page */
+typedef struct {
+    void* data;
+    uint32_t page_number;
+    uint32_t pin_count; // pinned frames are never evicted
+    uint32_t last_used; // epoch of the last `get_page()` call for this frame
+    bool referenced; // CLOCK reference bit
+    bool dirty; // page was modified since it was read (or last written)
+    bool spilled; // the page's newest image is in the log (`wal_spill()`), it's dropped when evicted
+} Frame;
+
+/* Pager structure */
+typedef struct {
+    PagerMode mode;
+    int file_descriptor;
+    off_t file_size;
+    uint32_t page_count;
+    uint32_t free_list_head; // first page of the free page list (0 == empty), stored in the database header
+
+    /* memory mapped file (`PAGER_MMAP` mode), the address range for all `TABLE_MAX_PAGES` pages
+     * is reserved up front, so page addresses don't change when the mapping grows.
+     * The mapping is private: modified pages are copies that the kernel never writes into the file,
+     * a checkpoint writes them (`pager_flush_all()`) once the log holds their changes, so a crash
+     * can't leave pages of an uncommitted statement in the file */
+    void* map;
+    uint32_t mapped_pages;
+    bool* map_dirty; // `map_dirty[page_number]`, the page is in `map_dirty_pages`
+    uint32_t* map_dirty_pages;
+    uint32_t map_dirty_count;
+    uint32_t map_dirty_capacity;
+
+    /* write-ahead log */
+    Wal* wal;
+
+    /* buffer pool */
+    Frame* frames;
+    uint32_t frame_count; // number of frames currently allocated
+    uint32_t frame_capacity; // size of the `frames` array
+    uint32_t max_frames; // frame budget
+    uint32_t clock_hand;
+    uint32_t epoch;
+
+    /* page table, `page_frames[page_number]` is the frame index + 1 (0 == page not cached) */
+    uint32_t* page_frames;
+    uint32_t page_frames_capacity;
+
+    /* shared mode (`pager_share()`), while worker threads read pages the buffer pool is only
+     * used under the lock, the pages themselves aren't changed (a thread only reads the pages
+     * it has pinned, other pages can be evicted as soon as it got them) */
+    bool shared;
+    pthread_mutex_t lock;
+
+    /* zone maps of the leaves, `zone_maps[page_number]` (see zone.h), kept in memory only */
+    ZoneMap* zone_maps;
+    uint32_t zone_map_capacity;
+
+    uint64_t page_reads; // pages read from the file (buffer pool misses)
+} Pager;
+
+
+void* get_page(Pager* pager, uint32_t page_number);
+void* pager_get_page(Pager* pager, uint32_t page_number);
+void* get_page_frame(Pager* pager, uint32_t page_number, uint32_t* frame_index);
+uint32_t get_unused_page_number(Pager* pager);
+void pager_free_page(Pager* pager, uint32_t page_number);
+
+/* Pager handling */
+Pager* pager_open(const char* filename, PagerMode mode, uint32_t max_frames, SyncLevel sync_level);
+void pager_flush(Pager* pager, uint32_t page_number);
+void pager_flush_all(Pager* pager);
+void pager_close(Pager* pager);
+void pager_commit(Pager* pager);
+void pager_spill(Pager* pager);
+int compare_page_numbers(const void* a, const void* b);
+
+/* Buffer pool handling */
+void pager_pin(Pager* pager, uint32_t page_number);
+void pager_pin_frame(Pager* pager, uint32_t frame_index);
+void pager_unpin(Pager* pager, uint32_t page_number);
+void pager_release(Pager* pager);
+void pager_share(Pager* pager, bool shared);
+void pager_mark_dirty(Pager* pager, uint32_t page_number);
+ZoneMap* pager_zone_map(Pager* pager, uint32_t page_number);
+ZoneMap* pager_valid_zone_map(Pager* pager, uint32_t page_number);
+void pager_reserve_zone_maps(Pager* pager, uint32_t page_count);
+uint32_t pager_find_victim(Pager* pager);
+uint32_t pager_allocate_frame(Pager* pager);
+void pager_evict(Pager* pager, uint32_t frame_index);
+
+/* Memory mapped pager handling */
+void pager_map_file(Pager* pager);
+void pager_map_grow(Pager* pager, uint32_t page_number);
+void pager_map_reload(Pager* pager, uint32_t page_number, uint32_t page_count);
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+/* Thread pool for parallel scans: the workers are started once and run the tasks of one job at a
+ * time, every task is taken by the next idle thread (the thread that runs the job takes tasks too,
+ * so a pool of `thread_count` threads starts `thread_count - 1` workers) */
+typedef void (*PoolTask)(void* argument, uint32_t task);
+
+typedef struct {
+    pthread_t* workers;
+    uint32_t thread_count;
+
+    pthread_mutex_t lock;
+    pthread_cond_t work; // a job was started (or the pool is stopping)
+    pthread_cond_t done; // the last task of the job finished
+
+    /* the current job */
+    PoolTask task;
+    void* argument;
+    uint32_t task_count;
+    uint32_t next_task;
+    uint32_t finished_tasks;
+    bool stopping;
+} ThreadPool;
+
+
+ThreadPool* pool_create(uint32_t thread_count);
+void pool_run(ThreadPool* pool, PoolTask task, void* argument, uint32_t task_count);
+void pool_take_tasks(ThreadPool* pool);
+void* pool_worker(void* pool);
+void pool_destroy(ThreadPool* pool);
+uint32_t pool_default_threads();
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include <stdint.h>
+
+/* Search of a sorted array of keys (the key arrays of internal and leaf nodes),
+ * every variant returns the index of the first key >= `key` (`count` if there is none) */
+typedef uint32_t (*KeySearchFunction)(const uint32_t* keys, uint32_t count, uint32_t key);
+
+/* the SIMD variants narrow the range with a binary search until it has at most this many keys,
+ * and then compare all of them at once (counting the keys smaller than the searched one) */
+#define KEY_SEARCH_SSE4_WINDOW (uint32_t)16
+#define KEY_SEARCH_AVX2_WINDOW (uint32_t)32
+
+/* the variant used by the tree, it's selected on the first call by the features of the CPU */
+extern KeySearchFunction key_search;
+
+uint32_t key_search_scalar(const uint32_t* keys, uint32_t count, uint32_t key);
+uint32_t key_search_sse4(const uint32_t* keys, uint32_t count, uint32_t key);
+uint32_t key_search_avx2(const uint32_t* keys, uint32_t count, uint32_t key);
+
+KeySearchFunction key_search_select();
+const char* key_search_name(KeySearchFunction function);
+
+#endif
@@ -1,8 +1,11 @@
 #ifndef STATEMENT_H
 #define STATEMENT_H
 
+#include <ctype.h>
+
 #include "buffer.h"
 #include "table.h"
+#include "filter.h"
 
 /* Indicates success/failure of statement preparation */
 typedef enum {
@@ -13,31 +16,89 @@ typedef enum {
     PREPARE_UNRECOGNIZED_STATEMENT
 } PrepareResult;
 
+/* a 'delete' statement spills the pages it modified into the log every this many leaves
+ * (`pager_spill()`), so a large delete doesn't keep every page it touched in the buffer pool
+ * (and their images from before the statement) until it commits at its end */
+#define DELETE_SPILL_INTERVAL 1024
+
+/* the ids of `select where id in (...)` are looked up this many at a time */
+#define SELECT_BATCH_SIZE 1024
+
+/* a part of a parallel scan for a column predicate keeps at most this many matching rows */
+#define COLUMN_SCAN_PART_ROWS 256
+
 /* Statement execution results */
 typedef enum {
     EXECUTE_SUCCESS,
     EXECUTE_DUPLICATE_KEY,
-    EXECUTE_TABLE_FULL
+    EXECUTE_TABLE_FULL,
+    EXECUTE_INDEX_EXISTS
 } ExecuteResult;
 
 /* Types of statement */
 typedef enum {
     STATEMENT_INSERT,
-    STATEMENT_SELECT
+    STATEMENT_SELECT,
+    STATEMENT_DELETE,
+    STATEMENT_UPDATE,
+    STATEMENT_CREATE_INDEX
 } StatementType;
 
 /* Statement structure */
 typedef struct {
     StatementType type;
-    Row row_to_insert;
+    Row row_to_insert; // also the new values of 'update' (its id is the row to update)
+    /* columns set by 'update' */
+    bool update_username;
+    bool update_email;
+    /* ids of the rows to select or delete (`low_id` == `high_id` for a single row) */
+    uint32_t low_id;
+    uint32_t high_id;
+    uint32_t limit; // maximum number of rows to select
+    uint32_t offset; // rows of the range skipped before the selected ones
+    bool count; // `select count(*)`, only the number of rows in the range is printed
+    /* `where username = bob`, `where email = bob@mail.com` or `where email like %@mail.com` instead of a predicate on the id */
+    bool column_predicate;
+    MatchKind match; // kind of the predicate, the value is the pattern without its `%` characters
+    IndexColumn column; // column of the predicate (or of 'create index')
+    bool hash_index; // `create hash index on id`
+    char column_value[COLUMN_EMAIL_SIZE+1];
+    /* `where id in (1, 5, 9)`: the list in the input line (NULL if there is none) and its number of ids */
+    char* id_list;
+    char* id_list_end;
+    uint32_t id_count;
 } Statement;
 
+/* State of a part of a parallel scan for a column predicate: the part's number of matching rows,
+ * and its first `offset + limit` matching rows, but no more than `COLUMN_SCAN_PART_ROWS` (the parts
+ * are merged in key order, the rows after a part that was cut off are scanned again by the merge) */
+typedef struct {
+    Statement* statement;
+    const Predicate* predicate;
+    uint64_t matches;
+    Row* rows;
+    uint32_t row_count;
+    uint32_t row_capacity;
+    bool cut_off; // the part stopped at `COLUMN_SCAN_PART_ROWS` rows, it can have more
+} ColumnScanState;
+
 void print_row(Row* row);
+void print_batch_row(RowBatch* batch, uint32_t index);
 
 PrepareResult prepare_statement(InputBuffer* input_buffer, Statement* statement);
 ExecuteResult execute_statement(Statement* statement, Table* table);
 
 ExecuteResult execute_insert(Statement* prepared_statement, Table* table);
 ExecuteResult execute_select(Statement* prepared_statement, Table* table);
+ExecuteResult execute_delete(Statement* prepared_statement, Table* table);
+ExecuteResult execute_update(Statement* prepared_statement, Table* table);
+ExecuteResult execute_create_index(Statement* prepared_statement, Table* table);
+ExecuteResult execute_select_column(Statement* prepared_statement, Table* table);
+ExecuteResult execute_select_ids(Statement* prepared_statement, Table* table);
+bool select_match(Statement* statement, Row* row, uint64_t* matches, uint32_t* printed);
+bool execute_select_column_parallel(Statement* statement, Table* table, const Predicate* predicate);
+bool column_scan_batch(RowBatch* batch, void* state);
+void select_column_scan(Statement* statement, Table* table, const Predicate* predicate, uint32_t key,
+                        uint64_t* matches, uint32_t* printed);
 
 #endif
@@ -12,15 +12,12 @@
 #include <errno.h>
 #include <stdbool.h>
 
+#include "pager.h"
+#include "pool.h"
 
 #define COLUMN_USERNAME_SIZE 32
 #define COLUMN_EMAIL_SIZE 255
 
-/* 1 page for internal root node
- * 512 child nodes (511 child pointers/key pairs, and 1 for the right child pointer) can fit in
- * the 1 internal node of 4096bytes */
-#define TABLE_MAX_PAGES (uint32_t)300000
-
 /* `(Struct*)0` => struct pointer */
 /* `(((Struct*)0)->Attribute)` => pointer to that specific attribute of a given struct */
 #define size_of_attribute(Struct, Attribute) sizeof(((Struct*)0)->Attribute)
@@ -32,61 +29,199 @@ typedef struct {
     char email[COLUMN_EMAIL_SIZE+1];
 } Row;
 
-/* Pager structure */
+/* Options used when opening the database (`db_open()`) */
 typedef struct {
-    int file_descriptor;
-    uint32_t file_size;
-    uint32_t page_count;
-    void* pages[TABLE_MAX_PAGES];
-} Pager;
-
-/* Table structure */
+    PagerMode pager_mode;
+    uint32_t cache_pages; // buffer pool frame budget (`PAGER_BUFFERED` mode)
+    SyncLevel sync_level; // durability of the write-ahead log
+    uint32_t threads; // threads of parallel scans (0 == one per processor)
+} DbOptions;
+
+/* maximum number of internal node layers (with at least 256 children per internal node
+ * this is far more than `TABLE_MAX_PAGES` needs) */
+#define BTREE_MAX_DEPTH 16
+
+/* a batched lookup (`table_find_batch()`) prefetches this many leaves before it searches them,
+ * and the first bytes of every leaf (its header and the keys of a leaf of short rows) */
+#define BATCH_PREFETCH_LEAVES 16
+#define BATCH_PREFETCH_BYTES 512
+
+/* columns that can have a secondary index (`create index on <column>`) */
+typedef enum {INDEX_USERNAME, INDEX_EMAIL} IndexColumn;
+#define INDEX_COLUMNS 2
+
+/* Table structure, the metadata is stored in the database header (page 0) */
 typedef struct {
     uint32_t root_page_number;
     uint32_t internal_node_layers;
+    uint64_t row_count;
+    uint32_t index_root_page_numbers[INDEX_COLUMNS]; // root of every column's index (0 == no index)
+    uint32_t hash_root_page_number; // meta page of the hash index on the id (0 == no hash index)
     Pager* pager;
+    /* leaf found by the last `table_find()` and the internal nodes above it, so sequential
+     * inserts can skip the descent (cleared when the tree is restructured) */
+    uint32_t hint_page_number; // 0 == no hint (page 0 is the header)
+    uint32_t hint_path[BTREE_MAX_DEPTH];
+    uint32_t hint_depth;
+    uint32_t thread_count; // threads of parallel scans (1 == scans aren't parallel)
+    ThreadPool* pool; // started by the first parallel scan
 } Table;
 
-/* Cursor structure */
+
+/* Cursor structure, cursors are the caller's (usually on its stack), they're positioned by
+ * `table_find()`, `table_seek()` or `table_seek_rank()` and moved by `cursor_advance()` and
+ * `cursor_retreat()`, their leaf stays pinned until `cursor_close()` */
 typedef struct {
     Table* table;
     uint32_t page_number;
     uint32_t cell_number;
     bool end_of_table; // Represents the position one past the last element (useful when we want to insert a new row)
+
+    /* internal nodes from the root down to the leaf's parent, filled by `table_find()` */
+    uint32_t path[BTREE_MAX_DEPTH];
+    uint32_t depth;
 } Cursor;
 
 
-/* Row data sizes */
+/* Row batch, the rows of (the rest of) one leaf as column vectors, filled by `cursor_read_batch()`.
+ * The usernames and emails point into the leaf and aren't NUL terminated, they're only valid until the
+ * cursor reads the next batch (or is closed), the cursor keeps the leaf pinned until then. The leaf's
+ * header and slots come before its records, so at least `ROW_BATCH_VALUE_SLACK` bytes before every
+ * value can be read (the filters load blocks that end at the end of a value, see filter.h) */
+#define ROW_BATCH_MAX_ROWS 512 // more than the cells of a leaf (`LEAF_NODE_MAX_CELLS`)
+#define ROW_BATCH_VALUE_SLACK 16
+
+typedef struct {
+    uint32_t count;
+    uint32_t ids[ROW_BATCH_MAX_ROWS];
+    const char* usernames[ROW_BATCH_MAX_ROWS];
+    const char* emails[ROW_BATCH_MAX_ROWS];
+    uint8_t username_lengths[ROW_BATCH_MAX_ROWS];
+    uint8_t email_lengths[ROW_BATCH_MAX_ROWS];
+} RowBatch;
+
+
+/* Parallel scans: a scan of a table with at least `PARALLEL_SCAN_MIN_ROWS` rows is split into parts
+ * at the separator keys of the root (and of its children if the root has too few children), and the
+ * parts are scanned on the table's thread pool. There are up to `PARALLEL_SCAN_PARTS_PER_THREAD` parts
+ * per thread, so the threads stay busy when some parts take longer */
+#define PARALLEL_SCAN_MIN_ROWS 16384
+#define PARALLEL_SCAN_PARTS_PER_THREAD 4
+#define PARALLEL_SCAN_MAX_PARTS 256
+
+/* called (on a worker thread) for every batch of a part of a parallel scan with the part's own state,
+ * the batch only has rows of the part, returns false to end the part early [bool] */
+typedef bool (*ScanBatchFunction)(RowBatch* batch, void* state);
+
+/* A part of a parallel scan, the rows from the cursor's position up to `high_key` */
+typedef struct {
+    Table* table;
+    Cursor cursor;
+    uint32_t high_key;
+    const ZoneFilter* filter; // leaves are passed over by their zone maps (NULL to read all of them)
+    ScanBatchFunction function;
+    void* state;
+} ScanPart;
+
+
+/* Row record layout (the id is the key, so it's kept in the leaf slot and not in the record):
+ * username length (1 byte), username, email length (1 byte), email */
+static const uint32_t RECORD_LENGTH_SIZE = sizeof(uint8_t);
+static const uint32_t ROW_MIN_SIZE = 2 * RECORD_LENGTH_SIZE + 2; // one character username and email
+static const uint32_t ROW_MAX_SIZE = 2 * RECORD_LENGTH_SIZE + COLUMN_USERNAME_SIZE + COLUMN_EMAIL_SIZE;
+
+/* Fixed size row layout of format version 1 (leaf cells were the key followed by this),
+ * only used to upgrade old files */
 static const uint32_t ID_SIZE  = size_of_attribute(Row, id);
 static const uint32_t USERNAME_SIZE  = size_of_attribute(Row, username);
 static const uint32_t EMAIL_SIZE = size_of_attribute(Row, email);
-
-/* Row data memory offset */
 static const uint32_t ID_OFFSET = 0;
 static const uint32_t USERNAME_OFFSET = offsetof(Row, username);
 static const uint32_t EMAIL_OFFSET = offsetof(Row, email);
 static const uint32_t ROW_SIZE = ID_SIZE+USERNAME_SIZE+EMAIL_SIZE;
-
-/* Page constants */
-static const uint32_t PAGE_SIZE = 4096;
-
-
-
-void serialize_row(Row* source, void* destination);
+static const uint32_t V1_LEAF_NODE_HEADER_SIZE = 14;
+static const uint32_t V1_LEAF_NODE_CELL_SIZE = sizeof(uint32_t) + ROW_SIZE;
+
+/* Node layouts of format versions 1 to 3, only used to upgrade old files: internal cells were
+ * (child, key) pairs after the header and version 2 leaf slots were (key, record offset, record length)
+ * after the header, version 3 internal nodes had the keys and children arrays for 510 children
+ * (without row counts) */
+static const uint32_t V2_INTERNAL_NODE_HEADER_SIZE = 14;
+static const uint32_t V2_INTERNAL_NODE_CELL_SIZE = 2 * sizeof(uint32_t);
+static const uint32_t V2_LEAF_NODE_HEADER_SIZE = 18;
+static const uint32_t V2_LEAF_NODE_SLOT_SIZE = sizeof(uint32_t) + 2 * sizeof(uint16_t);
+static const uint32_t V3_INTERNAL_NODE_CHILDREN_OFFSET = V2_INTERNAL_NODE_HEADER_SIZE + 510 * sizeof(uint32_t);
+
+/* A node of a tree that is rebuilt by an upgrade */
+typedef struct {
+    uint32_t page_number;
+    uint32_t max_key;
+    uint32_t rows; // rows under the node
+} UpgradeNode;
+
+/* Database header (page 0) layout */
+#define DB_HEADER_MAGIC (uint32_t)0x31434244 // "DBC1"
+#define DB_FORMAT_VERSION (uint32_t)6 // 2: slotted leaf pages with variable length records, 3: contiguous key arrays,
+                                     // 4: row counts of the children in internal nodes, 5: secondary indexes,
+                                     // 6: hash index on the id
+static const uint32_t HEADER_MAGIC_OFFSET = 0;
+static const uint32_t HEADER_VERSION_OFFSET = HEADER_MAGIC_OFFSET + sizeof(uint32_t);
+static const uint32_t HEADER_PAGE_SIZE_OFFSET = HEADER_VERSION_OFFSET + sizeof(uint32_t);
+static const uint32_t HEADER_PAGE_COUNT_OFFSET = HEADER_PAGE_SIZE_OFFSET + sizeof(uint32_t);
+static const uint32_t HEADER_ROOT_PAGE_OFFSET = HEADER_PAGE_COUNT_OFFSET + sizeof(uint32_t);
+static const uint32_t HEADER_TREE_DEPTH_OFFSET = HEADER_ROOT_PAGE_OFFSET + sizeof(uint32_t);
+static const uint32_t HEADER_FREE_LIST_OFFSET = HEADER_TREE_DEPTH_OFFSET + sizeof(uint32_t);
+static const uint32_t HEADER_ROW_COUNT_OFFSET = HEADER_FREE_LIST_OFFSET + sizeof(uint32_t); // uint64_t
+static const uint32_t HEADER_INDEX_ROOTS_OFFSET = HEADER_ROW_COUNT_OFFSET + sizeof(uint64_t); // uint32_t per index column
+static const uint32_t HEADER_HASH_ROOT_OFFSET = HEADER_INDEX_ROOTS_OFFSET + INDEX_COLUMNS * sizeof(uint32_t);
+static const uint32_t HEADER_SIZE = HEADER_HASH_ROOT_OFFSET + sizeof(uint32_t);
+
+
+
+uint32_t serialize_row(Row* source, void* destination);
 void deserialize_row(void* source, Row* destination);
-void* get_page(Pager* pager, uint32_t page_number);
-uint32_t get_unused_page_number(Pager* pager);
-Table* db_open(const char* filename);
+uint32_t serialized_row_size(void* source);
+Table* db_open(const char* filename, DbOptions* options);
 void db_close(Table* table);
-
-/* Pager handling */
-Pager* pager_open(const char* filename);
-void pager_flush(Pager* pager, uint32_t page_number);
+void db_commit(Table* table);
+void db_commit_build(Table* table);
+
+/* Database header handling */
+void header_read(Table* table);
+void header_write(Table* table);
+void header_migrate(Table* table);
+uint64_t header_upgrade(Table* table, uint32_t version);
+void header_upgrade_collect(Table* table, uint32_t page_number, uint32_t version, UpgradeNode* leaves, uint32_t* leaf_count);
+uint32_t header_upgrade_child(void* node, uint32_t child_number, uint32_t version);
+void header_upgrade_leaf(void* node, uint32_t version);
+void print_header(Table* table);
 
 /* Cursor handling */
-Cursor* table_start(Table* table);
-Cursor* table_find(Table* table, uint32_t key);
+void table_start(Table* table, Cursor* cursor);
+void table_find(Table* table, uint32_t key, Cursor* cursor);
+void table_seek(Table* table, uint32_t key, Cursor* cursor);
+uint64_t table_rank(Table* table, uint32_t key);
+void table_seek_rank(Table* table, uint64_t rank, Cursor* cursor);
+bool table_find_hint(Table* table, uint32_t key, Cursor* cursor);
+void table_clear_hint(Table* table);
+int compare_keys(const void* a, const void* b);
+uint32_t table_sort_keys(uint32_t* keys, uint32_t count);
+uint32_t table_find_batch(Table* table, uint32_t* keys, uint32_t count, Row* rows);
 void* cursor_position(Cursor* cursor); // this function used to be `row_slot()`
+void cursor_read_row(Cursor* cursor, Row* row);
 void cursor_advance(Cursor* cursor);
+bool cursor_retreat(Cursor* cursor);
+void cursor_close(Cursor* cursor);
+uint32_t cursor_read_batch(Cursor* cursor, RowBatch* batch);
+uint32_t cursor_read_batch_filtered(Cursor* cursor, RowBatch* batch, const ZoneFilter* filter, uint32_t high_key);
+uint32_t table_skip_leaves(Pager* pager, uint32_t page_number, const ZoneFilter* filter);
+void row_batch_read_row(RowBatch* batch, uint32_t index, Row* row);
+
+/* Parallel scans */
+uint32_t table_scan_bounds(Table* table, uint32_t wanted, uint32_t** bounds);
+bool table_scans_in_parallel(Table* table);
+uint32_t table_scan_parallel(Table* table, ScanBatchFunction function, void* states, size_t state_size,
+                             const ZoneFilter* filter);
+void table_scan_part(void* parts, uint32_t part_number);
 
 #endif
@@ -0,0 +1,97 @@
+#ifndef WAL_H
+#define WAL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "pager.h"
+
+/* "WAL1" */
+#define WAL_MAGIC (uint32_t)0x57414c31
+
+/* the log is folded back into the database file (checkpoint) once it's this big (16MB) */
+#define WAL_CHECKPOINT_SIZE (uint64_t)(16 * 1024 * 1024)
+
+/* `SYNC_NORMAL`: one `fdatasync()` for a group of commits, the group ends after this
+ * many commits or when the group's first unsynced commit is this many milliseconds old */
+#define WAL_GROUP_COMMIT_STATEMENTS (uint32_t)256
+#define WAL_GROUP_COMMIT_MS (uint32_t)50
+
+/* a statement's pages are spilled into the log this many at a time */
+#define WAL_SPILL_BATCH_PAGES (uint32_t)64
+
+/* WAL file header layout (magic, page size, salt, reserved) */
+static const uint32_t WAL_HEADER_SIZE = 4 * sizeof(uint32_t);
+
+/* WAL frame header layout, every frame holds the modified byte range of one page (page delta)
+ * after its header */
+static const uint32_t WAL_FRAME_PAGE_NUMBER_OFFSET = 0;
+static const uint32_t WAL_FRAME_COMMIT_OFFSET = sizeof(uint32_t); // page count after commit, 0 if not the last frame of a commit
+static const uint32_t WAL_FRAME_SALT_OFFSET = 2 * sizeof(uint32_t);
+static const uint32_t WAL_FRAME_RANGE_OFFSET = 3 * sizeof(uint32_t); // uint16_t offset and length of the range
+static const uint32_t WAL_FRAME_CHECKSUM_OFFSET = 4 * sizeof(uint32_t); // running checksum of all frames up to this one
+static const uint32_t WAL_FRAME_HEADER_SIZE = 5 * sizeof(uint32_t);
+
+/* WAL structure */
+struct Wal {
+    int file_descriptor;
+    char* filename;
+    SyncLevel sync_level;
+    uint32_t salt; // changes on every checkpoint, frames with an old salt are ignored
+    uint32_t checksum;
+    uint64_t size; // bytes of frames written since the last checkpoint
+
+    /* group commit */
+    uint32_t unsynced_commits;
+    struct timespec group_start;
+
+    /* pages modified by the statement that isn't committed yet, together with their
+     * images from before the statement (the deltas are computed from them on commit) */
+    uint32_t* pending_pages;
+    void* pending_images;
+    uint32_t pending_count;
+    uint32_t pending_capacity;
+
+    /* hash table of the pending pages, `pending_slots[hash]` is the pending index + 1 (0 == empty) */
+    uint32_t* pending_slots;
+    uint32_t pending_slots_size;
+
+    /* the changed range of every pending page and the frames of a commit, they're kept (and only
+     * grow) so a commit doesn't allocate */
+    uint32_t* pending_offsets;
+    uint32_t* pending_lengths;
+    void* commit_buffer;
+    size_t commit_buffer_capacity;
+
+    /* pages that statements spilled into the log (`wal_spill()`) since the last checkpoint, a hash
+     * table (linear probing) of the page numbers and the log offsets of their newest images.
+     * The buffer pool drops spilled pages and reads them from the log again, offset 0 == the
+     * database file has the newest image again */
+    uint32_t* spilled_pages; // UINT32_MAX == empty slot
+    off_t* spilled_offsets;
+    uint32_t spilled_count;
+    uint32_t spilled_slots_size;
+    bool spilling; // the current statement has frames in the log already
+};
+
+
+Wal* wal_open(Pager* pager, const char* db_filename, SyncLevel sync_level);
+void wal_close(Pager* pager);
+void wal_add_page(Wal* wal, uint32_t page_number, void* page);
+void* wal_commit_buffer(Wal* wal, size_t size);
+void wal_fill_frame(Wal* wal, void* frame, uint32_t page_number, uint32_t commit, uint32_t offset, uint32_t length, const void* page);
+void wal_commit(Pager* pager);
+void wal_spill(Pager* pager);
+uint32_t wal_spilled_slot(Wal* wal, uint32_t page_number);
+void wal_add_spilled(Wal* wal, uint32_t page_number, off_t offset);
+bool wal_read_spilled(Wal* wal, uint32_t page_number, void* page);
+void wal_forget_spilled(Wal* wal, uint32_t page_number);
+void wal_write_spilled(Pager* pager);
+void wal_sync(Wal* wal);
+void wal_checkpoint(Pager* pager);
+void wal_recover(Pager* pager);
+void wal_reset(Wal* wal);
+uint32_t wal_checksum(uint32_t checksum, const void* data, uint32_t size);
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef ZONE_H
+#define ZONE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Zone maps: a summary of the rows of a leaf, so a scan for a predicate on the username or email
+ * can pass over the leaves that can't have a matching row without reading them. It holds the
+ * smallest and largest prefix of the usernames and emails (the first `ZONE_PREFIX_SIZE` bytes as
+ * a big endian number, zero padded, so the numbers compare like the strings), a bloom filter of the
+ * email domains (the part after the last '@', two bits of a 64 bit mask per domain) and the next
+ * leaf, so a scan can go on without the page.
+ * The pager keeps one per page in memory (they aren't stored in the file): marking a page dirty
+ * invalidates its zone map, inserts, updates and deletes keep a valid one valid (it may hold more
+ * than the leaf has, never less) and filtered scans record one for every leaf they read whole */
+#define ZONE_PREFIX_SIZE 8
+
+typedef struct {
+    uint64_t username_min;
+    uint64_t username_max;
+    uint64_t email_min;
+    uint64_t email_max;
+    uint64_t email_domains;
+    uint32_t next_leaf;
+    bool valid; // read and set atomically, parallel scans record zone maps of their parts' leaves
+} ZoneMap;
+
+/* What a zone map has to allow for a predicate to match: a prefix in the range `low` to `high` (of
+ * the username or email), and all the `domain_bits` in the email domains (0 if the predicate doesn't
+ * fix the domain) */
+typedef struct {
+    bool email;
+    bool ranged; // false if the predicate doesn't fix a prefix (suffix and substring patterns)
+    uint64_t low;
+    uint64_t high;
+    uint64_t domain_bits;
+} ZoneFilter;
+
+
+void zone_map_clear(ZoneMap* zone);
+void zone_map_add(ZoneMap* zone, const char* username, uint32_t username_length, const char* email, uint32_t email_length);
+void zone_map_publish(ZoneMap* zone);
+bool zone_map_is_valid(ZoneMap* zone);
+bool zone_map_may_match(const ZoneMap* zone, const ZoneFilter* filter);
+uint64_t zone_prefix(const char* value, uint32_t length, uint8_t padding);
+uint64_t zone_domain_bits(const char* email, uint32_t length);
+
+#endif
@@ -0,0 +1,24 @@
+#include "alloc.h"
+
+uint64_t allocation_count = 0;
+uint64_t statement_allocations = 0;
+
+/* the worker threads of parallel scans allocate too, so the counter is incremented atomically */
+
+/* counts the allocation and allocates with the C library's `malloc()` [void*] */
+void* __wrap_malloc(size_t size) {
+    __atomic_add_fetch(&allocation_count, 1, __ATOMIC_RELAXED);
+    return __real_malloc(size);
+}
+
+/* counts the allocation and allocates with the C library's `calloc()` [void*] */
+void* __wrap_calloc(size_t count, size_t size) {
+    __atomic_add_fetch(&allocation_count, 1, __ATOMIC_RELAXED);
+    return __real_calloc(count, size);
+}
+
+/* counts the allocation and resizes with the C library's `realloc()` [void*] */
+void* __wrap_realloc(void* pointer, size_t size) {
+    __atomic_add_fetch(&allocation_count, 1, __ATOMIC_RELAXED);
+    return __real_realloc(pointer, size);
+}
@@ -1,10 +1,19 @@
 #include "btree.h"
+#include "index.h"
+#include "hash.h"
+#include "search.h"
 #include <stdlib.h>
 
 // #define DEBUG_NODE_INFO
 
 /* helper function to quickly print information about a given page [void] */
 void print_page_information(Table* table, uint32_t page_number) {
+    if (page_number == 0) {
+        /* page 0 is the database header */
+        print_header(table);
+        return;
+    }
+
     void* node = get_page(table->pager, page_number);
 
     switch (get_node_type(node)) {
@@ -15,7 +24,7 @@ void print_page_information(Table* table, uint32_t page_number) {
             printf("  - row count: %d\n", *leaf_node_num_cells(node));
             printf("  - max key: %d\n", *leaf_node_key(node, *leaf_node_num_cells(node)-1));
             printf("  - sibling page number: %d\n", *leaf_node_next_leaf(node));
-            printf("  - parent page number: %d\n", *node_parent(node));
+            printf("  - free space: %d\n", leaf_node_free_space(node) + *leaf_node_fragmented_bytes(node));
 #ifdef DEBUG_NODE_INFO
             print_leaf_node(node);
 #endif
@@ -28,20 +37,52 @@ void print_page_information(Table* table, uint32_t page_number) {
             printf("  - child count: %d\n", *internal_node_num_keys(node)+1);
             printf("  - key count: %d\n", *internal_node_num_keys(node));
             printf("  - right child page number: %d\n", *internal_node_right_child(node));
-            printf("  - parent page number: %d\n", *node_parent(node));
 #ifdef DEBUG_NODE_INFO
             print_internal_node(node);
 #endif
             break;
+        case NODE_INDEX_LEAF:
+            printf("index leaf node:\n");
+            printf("  - root: %d\n", is_node_root(node));
+            printf("  - page number: %d\n", page_number);
+            printf("  - entry count: %d\n", *index_leaf_num_cells(node));
+            printf("  - sibling page number: %d\n", *index_leaf_next_leaf(node));
+            break;
+        case NODE_INDEX_INTERNAL:
+            printf("index internal node:\n");
+            printf("  - root: %d\n", is_node_root(node));
+            printf("  - page number: %d\n", page_number);
+            printf("  - child count: %d\n", *index_internal_num_keys(node)+1);
+            printf("  - right child page number: %d\n", *index_internal_right_child(node));
+            break;
+        case NODE_HASH_META:
+            printf("hash index meta page:\n");
+            printf("  - page number: %d\n", page_number);
+            printf("  - level: %d\n", *hash_meta_level(node));
+            printf("  - split pointer: %d\n", *hash_meta_split(node));
+            printf("  - bucket count: %d\n", *hash_meta_bucket_count(node));
+            printf("  - directory page count: %d\n", *hash_meta_directory_count(node));
+            break;
+        case NODE_HASH_DIRECTORY:
+            printf("hash index directory page:\n");
+            printf("  - page number: %d\n", page_number);
+            break;
+        case NODE_HASH_BUCKET:
+            printf("hash index bucket page:\n");
+            printf("  - page number: %d\n", page_number);
+            printf("  - row count: %d\n", *leaf_node_num_cells(node));
+            printf("  - overflow page number: %d\n", *leaf_node_next_leaf(node));
+            printf("  - free space: %d\n", leaf_node_free_space(node) + *leaf_node_fragmented_bytes(node));
+            break;
     }
 }
 
 /* print all constants in the 'btree.h' file [void] */
 void print_constants() {
-    printf("ROW_SIZE: %d\n", ROW_SIZE);
+    printf("ROW_MAX_SIZE: %d\n", ROW_MAX_SIZE);
     printf("COMMON_NODE_HEADER_SIZE: %d\n", COMMON_NODE_HEADER_SIZE);
     printf("LEAF_NODE_HEADER_SIZE: %d\n", LEAF_NODE_HEADER_SIZE);
-    printf("LEAF_NODE_CELL_SIZE: %d\n", LEAF_NODE_CELL_SIZE);
+    printf("LEAF_NODE_SLOT_SIZE: %d\n", LEAF_NODE_SLOT_SIZE);
     printf("LEAF_NODE_SPACE_FOR_CELLS: %d\n", LEAF_NODE_SPACE_FOR_CELLS);
     printf("LEAF_NODE_MAX_CELLS: %d\n", LEAF_NODE_MAX_CELLS);
 }
@@ -110,6 +151,48 @@ void print_btree(Pager* pager, uint32_t page_num, uint32_t indentation_level) {
       child = *internal_node_right_child(node);
       print_btree(pager, child, indentation_level + 1);
       break;
+    case (NODE_INDEX_LEAF):
+      num_keys = *index_leaf_num_cells(node);
+      indent(indentation_level);
+      printf("- index leaf (size %d)\n", num_keys);
+      for (uint32_t i = 0; i < num_keys; i++) {
+        IndexEntry* entry = index_leaf_entry(node, i);
+        indent(indentation_level + 1);
+        printf("- %.*s %d\n", INDEX_PREFIX_SIZE, entry->prefix, entry->id);
+      }
+      break;
+    case (NODE_INDEX_INTERNAL):
+      num_keys = *index_internal_num_keys(node);
+      indent(indentation_level);
+      printf("- index internal (size %d)\n", num_keys);
+      for (uint32_t i = 0; i < num_keys; i++) {
+        child = *index_internal_child(node, i);
+        print_btree(pager, child, indentation_level + 1);
+
+        IndexEntry* entry = index_internal_key(node, i);
+        indent(indentation_level + 1);
+        printf("- key %.*s %d\n", INDEX_PREFIX_SIZE, entry->prefix, entry->id);
+      }
+      child = *index_internal_right_child(node);
+      print_btree(pager, child, indentation_level + 1);
+      break;
+    case (NODE_HASH_META):
+      indent(indentation_level);
+      printf("- hash meta (buckets %d)\n", *hash_meta_bucket_count(node));
+      break;
+    case (NODE_HASH_DIRECTORY):
+      indent(indentation_level);
+      printf("- hash directory (page %d)\n", page_num);
+      break;
+    case (NODE_HASH_BUCKET):
+      num_keys = *leaf_node_num_cells(node);
+      indent(indentation_level);
+      printf("- hash bucket (size %d)\n", num_keys);
+      for (uint32_t i = 0; i < num_keys; i++) {
+        indent(indentation_level + 1);
+        printf("- %d\n", *leaf_node_key(node, i));
+      }
+      break;
   }
 }
 
@@ -134,9 +217,16 @@ uint32_t* leaf_node_num_cells(void* node) {
     return node + LEAF_NODE_NUM_CELLS_OFFSET;
 }
 
-/* returns a pointer to the block of memory where a certain (inputed by argument 'cell_number') cell is stored [void*] */
-void* leaf_node_cell(void* node, uint32_t cell_number) {
-    return node + LEAF_NODE_HEADER_SIZE + cell_number * LEAF_NODE_CELL_SIZE;
+/* returns a pointer to the array of keys of all cells [uint32_t*] */
+uint32_t* leaf_node_keys(void* node) {
+    return node + LEAF_NODE_KEYS_OFFSET;
+}
+
+/* returns a pointer to the record directory entry (record offset and length) of a certain (inputed
+ * by argument 'cell_number') cell, the directory starts right after the keys [void*] */
+void* leaf_node_record_entry(void* node, uint32_t cell_number) {
+    return node + LEAF_NODE_KEYS_OFFSET + *leaf_node_num_cells(node) * LEAF_NODE_KEY_SIZE +
+           cell_number * LEAF_NODE_RECORD_ENTRY_SIZE;
 }
 
 /* returns the page number of the given leaf's sibling node on the right,
@@ -146,14 +236,44 @@ uint32_t* leaf_node_next_leaf(void* node) {
     return node + LEAF_NODE_NEXT_LEAF_OFFSET;
 }
 
+/* returns a pointer to the offset where the record area (the lowest record) starts [uint16_t*] */
+uint16_t* leaf_node_content_start(void* node) {
+    return node + LEAF_NODE_CONTENT_START_OFFSET;
+}
+
+/* returns a pointer to the number of bytes in the record area that aren't used by any record [uint16_t*] */
+uint16_t* leaf_node_fragmented_bytes(void* node) {
+    return node + LEAF_NODE_FRAGMENTED_OFFSET;
+}
+
 /* returns a pointer to inputed cell's key in the memory [uint32_t*] */
 uint32_t* leaf_node_key(void* node, uint32_t cell_number) {
-    return leaf_node_cell(node, cell_number);
+    return leaf_node_keys(node) + cell_number;
+}
+
+/* returns a pointer to the page offset of the cell's record [uint16_t*] */
+uint16_t* leaf_node_record_offset(void* node, uint32_t cell_number) {
+    return leaf_node_record_entry(node, cell_number) + LEAF_NODE_RECORD_OFFSET_OFFSET;
 }
 
-/* returns a pointer to the block of memory where value of a certain cell is stored (inputed by argument 'cell_number') [void*] */
+/* returns a pointer to the length of the cell's record [uint16_t*] */
+uint16_t* leaf_node_record_length(void* node, uint32_t cell_number) {
+    return leaf_node_record_entry(node, cell_number) + LEAF_NODE_RECORD_LENGTH_OFFSET;
+}
+
+/* returns a pointer to the block of memory where value (record) of a certain cell is stored (inputed by argument 'cell_number') [void*] */
 void* leaf_node_value(void* node, uint32_t cell_number) {
-    return leaf_node_cell(node, cell_number) + LEAF_NODE_KEY_SIZE;
+    return node + *leaf_node_record_offset(node, cell_number);
+}
+
+/* returns the number of free bytes between the slot array and the record area [uint32_t] */
+uint32_t leaf_node_free_space(void* node) {
+    return *leaf_node_content_start(node) - LEAF_NODE_HEADER_SIZE - *leaf_node_num_cells(node) * LEAF_NODE_SLOT_SIZE;
+}
+
+/* returns the number of bytes used by the cells (slots and records) [uint32_t] */
+uint32_t leaf_node_used_space(void* node) {
+    return LEAF_NODE_SPACE_FOR_CELLS - leaf_node_free_space(node) - *leaf_node_fragmented_bytes(node);
 }
 
 /* initialize inputed leaf node [void] */
@@ -162,16 +282,55 @@ void initialize_leaf_node(void* node) {
     set_node_root(node, false);
     *leaf_node_num_cells(node) = 0;
     *leaf_node_next_leaf(node) = 0; // 0 == no sibling
+    *leaf_node_content_start(node) = PAGE_SIZE;
+    *leaf_node_fragmented_bytes(node) = 0;
 }
 
+/* inserts the cell (key and record) at the `cell_number` position, the record is stored at the start
+ * of the record area, the caller has to make sure that there is enough free space [void] */
+void leaf_node_place_cell(void* node, uint32_t cell_number, uint32_t key, const void* record, uint32_t length) {
+    uint32_t num_cells = *leaf_node_num_cells(node);
 
-/* FUNCTIONS TO HANDLE INTERNAL NODES */
+    /* Make room for the new key and directory entry, the directory moves up by one key,
+     * the entries after the new one by one more entry (the highest part is moved first) */
+    uint8_t* keys = (uint8_t*)leaf_node_keys(node);
+    uint8_t* directory = keys + num_cells * LEAF_NODE_KEY_SIZE;
+    memmove(directory + (cell_number + 1) * LEAF_NODE_RECORD_ENTRY_SIZE + LEAF_NODE_KEY_SIZE,
+            directory + cell_number * LEAF_NODE_RECORD_ENTRY_SIZE, (num_cells - cell_number) * LEAF_NODE_RECORD_ENTRY_SIZE);
+    memmove(directory + LEAF_NODE_KEY_SIZE, directory, cell_number * LEAF_NODE_RECORD_ENTRY_SIZE);
+    memmove(keys + (cell_number + 1) * LEAF_NODE_KEY_SIZE, keys + cell_number * LEAF_NODE_KEY_SIZE,
+            (num_cells - cell_number) * LEAF_NODE_KEY_SIZE);
+
+    uint16_t offset = *leaf_node_content_start(node) - length;
+    memcpy(node + offset, record, length);
+    *leaf_node_content_start(node) = offset;
+
+    *leaf_node_num_cells(node) = num_cells + 1;
+    *leaf_node_key(node, cell_number) = key;
+    *leaf_node_record_offset(node, cell_number) = offset;
+    *leaf_node_record_length(node, cell_number) = length;
+}
 
-/* returns pointer to the page number of the parent node of a given node [uint32_t*] */
-uint32_t* node_parent(void* node) {
-    return node + PARENT_POINTER_OFFSET;
+/* moves all records to the end of the page, so the unused (fragmented) bytes become free space [void] */
+void leaf_node_defragment(void* node) {
+    uint8_t old_node[PAGE_SIZE];
+    memcpy(old_node, node, PAGE_SIZE);
+
+    uint16_t offset = PAGE_SIZE;
+    for (uint32_t i = 0; i < *leaf_node_num_cells(old_node); i++) {
+        uint16_t length = *leaf_node_record_length(old_node, i);
+        offset -= length;
+        memcpy(node + offset, leaf_node_value(old_node, i), length);
+        *leaf_node_record_offset(node, i) = offset;
+    }
+
+    *leaf_node_content_start(node) = offset;
+    *leaf_node_fragmented_bytes(node) = 0;
 }
 
+
+/* FUNCTIONS TO HANDLE INTERNAL NODES */
+
 /* returns a pointer to the number of keys of a given internal node [uint32_t*] */
 uint32_t* internal_node_num_keys(void* node) {
     // void* node -> pointer to the memory block of the node (where it starts in the memory)
@@ -183,9 +342,14 @@ uint32_t* internal_node_right_child(void* node) {
     return node + INTERNAL_NODE_RIGHT_CHILD_OFFSET;
 }
 
-/* returns a pointer to the cell with a certain cell_number in a given internal node [uint32_t*] */
-uint32_t* internal_node_cell(void* node, uint32_t cell_number) {
-    return node + INTERNAL_NODE_HEADER_SIZE + (cell_number * INTERNAL_NODE_CELL_SIZE);
+/* returns a pointer to the array of keys of a given internal node [uint32_t*] */
+uint32_t* internal_node_keys(void* node) {
+    return node + INTERNAL_NODE_KEYS_OFFSET;
+}
+
+/* returns a pointer to the array of children (without the right child) of a given internal node [uint32_t*] */
+uint32_t* internal_node_children(void* node) {
+    return node + INTERNAL_NODE_CHILDREN_OFFSET;
 }
 
 /* returns a pointer to a certain's child page number in a given internal node [uint32_t*] */
@@ -200,52 +364,87 @@ uint32_t* internal_node_child(void* node, uint32_t child_number) {
         return internal_node_right_child(node);
     } else {
         // pointer to the index (page number) of the n-th child in the internal node
-        return internal_node_cell(node, child_number);
+        return internal_node_children(node) + child_number;
     }
 }
 
 /* returns a pointer to a certain key in a given internal node,
  * key_number is same as child_number [uint32_t*] */
 uint32_t* internal_node_key(void* node, uint32_t key_number) {
-    return (void*)internal_node_cell(node, key_number) + INTERNAL_NODE_CHILD_SIZE;
+    return internal_node_keys(node) + key_number;
 }
 
-/* returns the max key (biggest) of a given node, 
- * the node can be either of type NODE_INTERNAL or NODE_LEAF [uint32_t] */
-uint32_t get_node_max_key(void* node) {
-    switch (get_node_type(node)) {
-        case NODE_INTERNAL:
-            return *internal_node_key(node, *internal_node_num_keys(node)-1);
-        case NODE_LEAF:
-            return *leaf_node_key(node, *leaf_node_num_cells(node)-1);
-    }
+/* returns a pointer to the array of row counts (rows under each child) of a given internal node,
+ * the right child's count is the last entry of the array [uint32_t*] */
+uint32_t* internal_node_rows(void* node) {
+    return node + INTERNAL_NODE_ROWS_OFFSET;
 }
 
-/* returns the page number of an internal node child (leaf node) with the smallest key [uint32_t] */
-uint32_t leaf_node_get_smallest(Table* table, void* root) {
-    /* Since this function can only be called when the root is internal, 
-     * we fetch the first child (since the order is sorted) and check right away the type,
-     * if it's another internal node (means it already split the internal node atleast once)
-     * we just recursively call the function with that first child.
-     * When we finally get to the leaf node, we return it's page number. */
+/* returns a pointer to the number of rows under the right child of a given internal node [uint32_t*] */
+uint32_t* internal_node_right_child_rows(void* node) {
+    return internal_node_rows(node) + INTERNAL_NODE_MAX_CELLS;
+}
 
-    uint32_t first_child_page_num = *internal_node_child(root, 0);
-    void* first_child = get_page(table->pager, first_child_page_num);
+/* returns a pointer to the number of rows under a certain child of a given internal node,
+ * child_number is the same as in `internal_node_child()` [uint32_t*] */
+uint32_t* internal_node_child_rows(void* node, uint32_t child_number) {
+    if (child_number == *internal_node_num_keys(node))
+        return internal_node_right_child_rows(node);
+    return internal_node_rows(node) + child_number;
+}
 
-    switch (get_node_type(first_child)) {
-        case NODE_INTERNAL:
-            leaf_node_get_smallest(table, first_child);
-            break;
-        case NODE_LEAF:
-            return *internal_node_child(root, 0);
+/* returns the number of rows under a given node, the cells of a leaf or the sum of the
+ * row counts of an internal node's children (no other page is read) [uint32_t] */
+uint32_t node_row_count(void* node) {
+    if (get_node_type(node) == NODE_LEAF)
+        return *leaf_node_num_cells(node);
+
+    uint32_t num_keys = *internal_node_num_keys(node);
+    uint32_t rows = *internal_node_right_child_rows(node);
+    for (uint32_t i = 0; i < num_keys; i++)
+        rows += internal_node_rows(node)[i];
+    return rows;
+}
+
+/* sets the row count of a child (after its rows changed by a split, merge or redistribution)
+ * to the number of rows it holds now, the caller marks the node dirty [void] */
+void internal_node_set_child_rows(void* node, uint32_t child_page_number, void* child) {
+    *internal_node_child_rows(node, internal_node_child_index(node, child_page_number)) = node_row_count(child);
+}
+
+/* adds `delta` rows to the counts of every internal node on the `path` above the leaf
+ * `page_number` (rows with the given key were inserted into or deleted from it), the child is
+ * found by the key like in the search, `depth` => length of the path [void] */
+void internal_node_add_rows(Table* table, uint32_t* path, uint32_t depth, uint32_t page_number, uint32_t key, int32_t delta) {
+    for (uint32_t level = depth; level > 0; level--) {
+        uint32_t parent_page_number = path[level - 1];
+        void* parent = get_page(table->pager, parent_page_number);
+        pager_mark_dirty(table->pager, parent_page_number);
+
+        uint32_t child_number = internal_node_find_child(parent, key);
+        if (*internal_node_child(parent, child_number) != page_number)
+            child_number = internal_node_child_index(parent, page_number);
+        *internal_node_child_rows(parent, child_number) += delta;
+        page_number = parent_page_number;
     }
 }
 
+/* returns the max key (biggest) of a given node, 
+ * the node can be either of type NODE_INTERNAL or NODE_LEAF,
+ * for internal nodes it's the max key of the rightmost leaf under it [uint32_t] */
+uint32_t get_node_max_key(Pager* pager, void* node) {
+    while (get_node_type(node) == NODE_INTERNAL)
+        node = get_page(pager, *internal_node_right_child(node));
+
+    return *leaf_node_key(node, *leaf_node_num_cells(node)-1);
+}
+
 /* just initializes a given internal node [void] */
 void initialize_internal_node(void* node) {
     set_node_type(node, NODE_INTERNAL);
     set_node_root(node, false);
     *internal_node_num_keys(node) = 0;
+    *internal_node_right_child_rows(node) = 0;
 }
 
 /* updates the `old_key` with the `new_key` in a given internal node [void] */
@@ -258,11 +457,36 @@ void update_internal_node_key(void* node, uint32_t old_key, uint32_t new_key) {
     /* prints the `old_child_index` */
     /*printf("OLD CHILD INDEX: %d\n", old_child_index);*/
 
-    /* we change the key of that child to the new key */
-    *internal_node_key(node, old_child_index) = new_key;
+    /* we change the key of that child to the new key,
+     * the right child doesn't have a key (its max key is the node's max key) */
+    if (old_child_index < *internal_node_num_keys(node))
+        *internal_node_key(node, old_child_index) = new_key;
 }
 
 
+/* records the zone map of a leaf from its rows (see zone.h) [void] */
+void leaf_node_zone_map(Pager* pager, uint32_t page_number, void* node) {
+    ZoneMap* zone = pager_zone_map(pager, page_number);
+    zone_map_clear(zone);
+
+    uint32_t num_cells = *leaf_node_num_cells(node);
+    for (uint32_t i = 0; i < num_cells; i++) {
+        const char* record = leaf_node_value(node, i);
+        uint8_t username_length = (uint8_t)record[0];
+        const char* email = record + RECORD_LENGTH_SIZE + username_length;
+        zone_map_add(zone, record + RECORD_LENGTH_SIZE, username_length, email + RECORD_LENGTH_SIZE, (uint8_t)email[0]);
+    }
+    zone->next_leaf = *leaf_node_next_leaf(node);
+    zone_map_publish(zone);
+}
+
+/* widens a valid zone map (invalidated by marking its page dirty) by the values of a row and makes
+ * it valid again [void] */
+void zone_map_add_row(ZoneMap* zone, Row* row) {
+    zone_map_add(zone, row->username, strlen(row->username), row->email, strlen(row->email));
+    zone_map_publish(zone);
+}
+
 /* main functions */
 
 /* inserts a new leaf node into the structure [void] */
@@ -270,76 +494,154 @@ void leaf_node_insert(Cursor* cursor, uint32_t key, Row* value) {
 
     void* node = get_page(cursor->table->pager, cursor->page_number);
 
-    uint32_t num_cells = *leaf_node_num_cells(node);
-    if (num_cells >= LEAF_NODE_MAX_CELLS) {
+    uint8_t record[ROW_MAX_SIZE];
+    uint32_t length = serialize_row(value, record);
+    uint32_t needed = LEAF_NODE_SLOT_SIZE + length;
+
+    /* the row is counted in the ancestors before a split (which recounts the two halves) */
+    internal_node_add_rows(cursor->table, cursor->path, cursor->depth, cursor->page_number, key, 1);
+
+    if (leaf_node_free_space(node) + *leaf_node_fragmented_bytes(node) < needed) {
         // Leaf node full, should split
         leaf_node_split_and_insert(cursor, key, value);
         return;
     }
 
-    if (cursor->cell_number < num_cells) {
-        // Make room for new cell
-        for (uint32_t i = num_cells; i > cursor->cell_number; i--) {
-          memcpy(leaf_node_cell(node, i), leaf_node_cell(node, i - 1), LEAF_NODE_CELL_SIZE);
-        }
+    /* a valid zone map stays valid with the new row (marking the page dirty invalidates it) */
+    ZoneMap* zone = pager_valid_zone_map(cursor->table->pager, cursor->page_number);
+    pager_mark_dirty(cursor->table->pager, cursor->page_number);
+
+    if (leaf_node_free_space(node) < needed)
+        leaf_node_defragment(node);
+
+    leaf_node_place_cell(node, cursor->cell_number, key, record, length);
+    if (zone != NULL)
+        zone_map_add_row(zone, value);
+}
+
+/* replaces the record of the row the cursor points at, the new record is written over the old
+ * one if it's not longer, or into the free space of the page otherwise, so only the leaf changes.
+ * If the page doesn't have room for it, the row is reinserted (which splits the leaf) [void] */
+void leaf_node_update(Cursor* cursor, Row* value) {
+    void* node = get_page(cursor->table->pager, cursor->page_number);
+    uint32_t cell_number = cursor->cell_number;
+
+    uint8_t record[ROW_MAX_SIZE];
+    uint32_t length = serialize_row(value, record);
+    uint32_t old_length = *leaf_node_record_length(node, cell_number);
+
+    if (length > old_length &&
+        leaf_node_free_space(node) + *leaf_node_fragmented_bytes(node) + old_length < length) {
+        /* the row doesn't fit into this page anymore */
+        pager_mark_dirty(cursor->table->pager, cursor->page_number);
+        leaf_node_remove_cells(node, cell_number, 1);
+        internal_node_add_rows(cursor->table, cursor->path, cursor->depth, cursor->page_number, value->id, -1);
+        leaf_node_insert(cursor, value->id, value);
+        return;
+    }
+
+    /* a valid zone map stays valid with the new values (the old ones may stay in it) */
+    ZoneMap* zone = pager_valid_zone_map(cursor->table->pager, cursor->page_number);
+    pager_mark_dirty(cursor->table->pager, cursor->page_number);
+    if (zone != NULL)
+        zone_map_add_row(zone, value);
+
+    if (length <= old_length) {
+        // the unused end of the old record becomes fragmented
+        memcpy(leaf_node_value(node, cell_number), record, length);
+        *leaf_node_fragmented_bytes(node) += old_length - length;
+        *leaf_node_record_length(node, cell_number) = length;
+        return;
     }
 
-    *(leaf_node_num_cells(node)) += 1;
-    *(leaf_node_key(node, cursor->cell_number)) = key;
-    serialize_row(value, leaf_node_value(node, cursor->cell_number));
+    /* the old record is unused now, the page is defragmented if the free space isn't enough */
+    *leaf_node_fragmented_bytes(node) += old_length;
+    *leaf_node_record_length(node, cell_number) = 0;
+    if (leaf_node_free_space(node) < length)
+        leaf_node_defragment(node);
+
+    uint16_t offset = *leaf_node_content_start(node) - length;
+    memcpy(node + offset, record, length);
+    *leaf_node_content_start(node) = offset;
+    *leaf_node_record_offset(node, cell_number) = offset;
+    *leaf_node_record_length(node, cell_number) = length;
 }
 
-/* creates a new node and move half of the cells over,
- * inserts the new value (row) into one of the two nodes [void] */
+/* creates a new node and move half of the cells (by size) over,
+ * inserts the new value (row) into one of the two nodes.
+ * Appending after the last key of the rightmost leaf (sequential ids) keeps the old node full
+ * and starts the new node with just the new row, a half split would leave every leaf half empty [void] */
 void leaf_node_split_and_insert(Cursor* cursor, uint32_t key, Row* value) {
     /* Create a new node and move half the cells over.
      * Insert the new value in one of the two nodes.
      * Update parent or create a new parent. */
 
     void* old_node = get_page(cursor->table->pager, cursor->page_number);
-    uint32_t old_max = get_node_max_key(old_node); // this is the maximum key of the node thats going to split
+    uint32_t old_max = get_node_max_key(cursor->table->pager, old_node); // this is the maximum key of the node thats going to split
+    bool append = cursor->cell_number == *leaf_node_num_cells(old_node) && *leaf_node_next_leaf(old_node) == 0;
+
+    /* the leaf and the path of the previous search won't be valid after the split */
+    table_clear_hint(cursor->table);
+
+    /* the zone maps of both halves are recorded if the leaf had a valid one */
+    bool zoned = pager_valid_zone_map(cursor->table->pager, cursor->page_number) != NULL;
 
     uint32_t new_page_num = get_unused_page_number(cursor->table->pager); // this page number is for the new, split node
     void* new_node = get_page(cursor->table->pager, new_page_num);
 
+    pager_mark_dirty(cursor->table->pager, cursor->page_number);
+    pager_mark_dirty(cursor->table->pager, new_page_num);
+
+    /* the cells are rebuilt from a copy of the old node (which also defragments both nodes) */
+    uint8_t copy[PAGE_SIZE];
+    memcpy(copy, old_node, PAGE_SIZE);
+
+    uint8_t record[ROW_MAX_SIZE];
+    uint32_t length = serialize_row(value, record);
+
     /* initializing the new node */
     initialize_leaf_node(new_node);
+    *leaf_node_next_leaf(new_node) = *leaf_node_next_leaf(copy);
 
-    /* puts old parent as the parent instead of the new internal node */
-    *node_parent(new_node) = *node_parent(old_node);
+    initialize_leaf_node(old_node);
+    set_node_root(old_node, is_node_root(copy));
+    *leaf_node_next_leaf(old_node) = new_page_num;
 
+    /* All existing cells plus the new cell are divided between old (left) and new (right)
+     * nodes, so that both get about half of the bytes */
+    uint32_t num_cells = *leaf_node_num_cells(copy) + 1;
+    uint32_t total = leaf_node_used_space(copy) + LEAF_NODE_SLOT_SIZE + length;
+    uint32_t left_bytes = 0;
 
-    *leaf_node_next_leaf(new_node) = *leaf_node_next_leaf(old_node);
-    *leaf_node_next_leaf(old_node) = new_page_num;
+    for (uint32_t i = 0; i < num_cells; i++) {
+        uint32_t cell_key = key;
+        const void* cell_record = record;
+        uint32_t cell_length = length;
+
+        if (i != cursor->cell_number) {
+            // cells after the new cell were shifted by one
+            uint32_t index = i < cursor->cell_number ? i : i - 1;
+            cell_key = *leaf_node_key(copy, index);
+            cell_record = leaf_node_value(copy, index);
+            cell_length = *leaf_node_record_length(copy, index);
+        }
+
+        /* the left node gets cells until it holds half of the bytes (all the old cells when appending),
+         * both nodes get at least one cell */
+        uint32_t cell_size = LEAF_NODE_SLOT_SIZE + cell_length;
+        bool left = i == 0 || (i < num_cells - 1 && *leaf_node_num_cells(new_node) == 0 &&
+                               (append || left_bytes + cell_size <= total / 2));
 
-    /* All existing keys plus new key should should be divided
-     * evenly between old (left) and new (right) nodes.
-     * Starting from the right, move each key to correct position. */
-
-    // all keys should be equally divided between the two nodes (old and new)
-    for (int32_t i = LEAF_NODE_MAX_CELLS; i >= 0; i--) {
-        void* destination_node;
-        if (i >= LEAF_NODE_LEFT_SPLIT_COUNT)
-            destination_node = new_node;
-        else
-            destination_node = old_node;
-
-        uint32_t index_within_node = i % LEAF_NODE_LEFT_SPLIT_COUNT;
-        void* destination = leaf_node_cell(destination_node, index_within_node);
-
-        // when we reach the new cell(row) index
-        if (i == cursor->cell_number) {
-            serialize_row(value, leaf_node_value(destination_node, index_within_node));
-            *leaf_node_key(destination_node, index_within_node) = key;
-        } else if (i > cursor->cell_number)
-            memcpy(destination, leaf_node_cell(old_node, i - 1), LEAF_NODE_CELL_SIZE);
-        else
-            memcpy(destination, leaf_node_cell(old_node, i), LEAF_NODE_CELL_SIZE);
+        void* destination_node = left ? old_node : new_node;
+        leaf_node_place_cell(destination_node, *leaf_node_num_cells(destination_node), cell_key, cell_record, cell_length);
+        if (left)
+            left_bytes += cell_size;
     }
 
-    /* Update cell count on both leaf nodes */
-    *(leaf_node_num_cells(old_node)) = LEAF_NODE_LEFT_SPLIT_COUNT;
-    *(leaf_node_num_cells(new_node)) = LEAF_NODE_RIGHT_SPLIT_COUNT;
+    if (zoned) {
+        leaf_node_zone_map(cursor->table->pager, cursor->page_number, old_node);
+        leaf_node_zone_map(cursor->table->pager, new_page_num, new_node);
+    }
 
     // create a new root node that will be the parent of the split nodes
     if (is_node_root(old_node)) {
@@ -347,326 +649,539 @@ void leaf_node_split_and_insert(Cursor* cursor, uint32_t key, Row* value) {
          * a new, internal node to be the root */
         return create_new_root(cursor->table, new_page_num);
     } else {
-        /* REMINDER: Updating parent (adding new key to the internal node) */
-        uint32_t parent_page_num = *node_parent(old_node);
-        uint32_t new_max = get_node_max_key(old_node); // this is the max key from the leaf node that split
+        /* REMINDER: Updating parent (adding new key to the internal node),
+         * the parent is the last internal node on the cursor's path */
+        uint32_t parent_level = cursor->depth - 1;
+        uint32_t parent_page_num = cursor->path[parent_level];
+        uint32_t new_max = get_node_max_key(cursor->table->pager, old_node); // this is the max key from the leaf node that split
         // REMINDER: ^^^ this checks out ^^^
 
         void* parent = get_page(cursor->table->pager, parent_page_num);
+        pager_mark_dirty(cursor->table->pager, parent_page_num);
 
         update_internal_node_key(parent, old_max, new_max);
-        internal_node_insert(cursor->table, parent_page_num, new_page_num);
+        internal_node_set_child_rows(parent, cursor->page_number, old_node);
+        internal_node_insert(cursor->table, cursor->path, parent_level, new_page_num);
         return;
     }
 }
 
-/* returns a cursor object that is at the position of a desired leaf_node,
+/* positions the cursor (the caller's) at a desired row of the leaf node,
  * if no node with the given id, 
- * it returns a cursor positioned at where the node should be inserted [Cursor*] */
-Cursor* leaf_node_find(Table* table, uint32_t page_number, uint32_t key) {
+ * it's positioned at where the node should be inserted, the leaf is pinned [void] */
+void leaf_node_find(Table* table, uint32_t page_number, uint32_t key, Cursor* cursor) {
     void* node = get_page(table->pager, page_number);
     uint32_t num_cells = *leaf_node_num_cells(node);
 
-    Cursor* cursor = malloc(sizeof(Cursor));
     cursor->table = table;
     cursor->page_number = page_number;
+    cursor->end_of_table = false;
+    cursor->depth = 0;
+    pager_pin(table->pager, page_number);
 
-    // Binary search
-    uint32_t min_index = 0;
-    uint32_t one_past_max_index = num_cells;
-    while (one_past_max_index != min_index) {
-        uint32_t index = (min_index + one_past_max_index) / 2;
-        uint32_t key_at_index = *leaf_node_key(node, index);
-        if (key == key_at_index) {
-            // found the cell (row)
-            cursor->cell_number = index;
-            return cursor;
-        }
-      if (key < key_at_index)
-        one_past_max_index = index;
-      else
-        min_index = index + 1;
-    }
-
-    cursor->cell_number = min_index;
-    return cursor;
+    /* the first cell with a key >= the searched key, that's the cell (row) itself if it exists,
+     * otherwise the position it would be inserted at */
+    cursor->cell_number = key_search(leaf_node_keys(node), num_cells, key);
 }
 
-/* add a new child/key pair to the parent node [void] */
-void internal_node_insert(Table* table, uint32_t parent_page_number, uint32_t child_page_number) {
+/* add a new child/key pair to the parent node, splits the parent if it's full,
+ * `path` => internal nodes from the root down to the parent, `path[level]` is the parent [void] */
+void internal_node_insert(Table* table, uint32_t* path, uint32_t level, uint32_t child_page_number) {
+    uint32_t parent_page_number = path[level];
     void* parent_page = get_page(table->pager, parent_page_number);
     void* child_page = get_page(table->pager, child_page_number);
-    uint32_t child_max_key = get_node_max_key(child_page);
+    uint32_t child_max_key = get_node_max_key(table->pager, child_page);
     uint32_t index = internal_node_find_child(parent_page, child_max_key);
 
-    /* update the key count for the internal node */
     uint32_t original_num_keys = *internal_node_num_keys(parent_page);
-    *internal_node_num_keys(parent_page) = original_num_keys + 1;
-
     if (original_num_keys >= INTERNAL_NODE_MAX_CELLS) {
-        void* root_node = get_page(table->pager, 0);
-        /* If there are 2 internal node layers, means that one of the children is hitting the cap,
-         * I will eventually implement 3-rd internal node layer */
-        if (table->internal_node_layers == 2 && *internal_node_num_keys(root_node) > INTERNAL_NODE_MAX_CELLS) {
-            printf("Need to implemenet 3 layers of internal nodes.\n");
-            exit(EXIT_FAILURE);
-        } else {
-            /* Splitting the internal node */
-            internal_node_split_and_insert(table, parent_page_number);
-            return;
-        }
+        /* Splitting the internal node (this may split all of its ancestors too) */
+        internal_node_split_and_insert(table, path, level, child_page_number);
+        return;
     }
 
-    /* -- this is just the standard case when there is a new child/pair to be added -- */
+    pager_mark_dirty(table->pager, parent_page_number);
+
+    /* update the key count for the internal node */
+    *internal_node_num_keys(parent_page) = original_num_keys + 1;
 
     // obtain the rightmost child node
     uint32_t right_child_page_number = *internal_node_right_child(parent_page);
     void* right_child_page = get_page(table->pager, right_child_page_number);
+    uint32_t right_child_max_key = get_node_max_key(table->pager, right_child_page);
 
-    if (child_max_key > get_node_max_key(right_child_page)) {
+    if (child_max_key > right_child_max_key) {
         /* replace the new child with the most right (bigger key) */
         *internal_node_child(parent_page, original_num_keys) = right_child_page_number; // replace the page number
-        *internal_node_key(parent_page, original_num_keys) = get_node_max_key(right_child_page); // replace the key
+        *internal_node_key(parent_page, original_num_keys) = right_child_max_key; // replace the key
+        internal_node_rows(parent_page)[original_num_keys] = *internal_node_right_child_rows(parent_page);
         *internal_node_right_child(parent_page) = child_page_number; // new page number for the right child
+        *internal_node_right_child_rows(parent_page) = node_row_count(child_page);
     } else {
-        /* otherwise just make room for the new cell (child/key) */
-        for (uint32_t i=original_num_keys; i > index; i--) {
-            /* moving 1 by 1 to make space for the new cell */
-            void* destination = internal_node_cell(parent_page, i);
-            void* source = internal_node_cell(parent_page, i-1);
-            memcpy(destination, source, INTERNAL_NODE_CELL_SIZE);
-        }
+        /* otherwise just make room for the new cell (child/key/row count) */
+        memmove(internal_node_keys(parent_page) + index + 1, internal_node_keys(parent_page) + index,
+                (original_num_keys - index) * INTERNAL_NODE_KEY_SIZE);
+        memmove(internal_node_children(parent_page) + index + 1, internal_node_children(parent_page) + index,
+                (original_num_keys - index) * INTERNAL_NODE_CHILD_SIZE);
+        memmove(internal_node_rows(parent_page) + index + 1, internal_node_rows(parent_page) + index,
+                (original_num_keys - index) * INTERNAL_NODE_ROWS_SIZE);
 
         *internal_node_child(parent_page, index) = child_page_number;
         *internal_node_key(parent_page, index) = child_max_key;
+        internal_node_rows(parent_page)[index] = node_row_count(child_page);
     }
 }
 
-/* Handles the splitting of the internal and potentially creating the new internal node root,
- * `node_page_number` => the internal node that we want to split [void] */
-void internal_node_split_and_insert(Table* table, uint32_t node_page_number) {
-    void* given_node = get_page(table->pager, node_page_number);
-
-    /* if given node is root, create new root and split the `node_page_number` node */
-    if (is_node_root(given_node) == 1) {
-        table->internal_node_layers++;
-
-        void* original_root = get_page(table->pager, table->root_page_number);
-
-        // get page number of an internal node child (leaf node) with the smallest key
-        int32_t lowest_pn = leaf_node_get_smallest(table, original_root);
-
-
-        // creating new space for the left split (current root)
-        uint32_t left_split_page_num = get_unused_page_number(table->pager);
-        void* left_split = get_page(table->pager, left_split_page_num);
-
-        initialize_internal_node(left_split);
-
-        // creating new space for the right split (right child)
-        uint32_t right_split_page_num = get_unused_page_number(table->pager);
-        void* right_split = get_page(table->pager, right_split_page_num);
-
-        initialize_internal_node(right_split);
-
-
-        // this is the key to put into the new internal root node
-        uint32_t root_first_key = *internal_node_key(original_root, INTERNAL_NODE_SPLIT_KEY_INDEX);
-
-        /* trigger for the left or right split */
-        int32_t left=1;
-
-        int32_t current_pn = lowest_pn; /* track the current page number */
-        int32_t count=0; /* track the number of nodes we copied to the new splits */
-        int32_t right_split_child_index = 0; /* track number of right split nodes we copied */
-
-        while (current_pn != 0) {
-            // `left` turns `0` when it's time to copy to right split
-            if (count > INTERNAL_NODE_LEFT_SPLIT_KEY_COUNT)
-                left=0;
-
-            void* node = get_page(table->pager, current_pn);
-            uint32_t node_max_key = get_node_max_key(node);
-
-            if (left) {
-                if (count == INTERNAL_NODE_LEFT_SPLIT_KEY_COUNT) {
-                    // this is the rightmost child for the left split
-                    *internal_node_right_child(left_split) = current_pn;
-                    *node_parent(node) = left_split_page_num;
-                } else {
-                    // copy to left split
-                    (*internal_node_num_keys(left_split))++;
-                    *internal_node_child(left_split, count) = current_pn;
-                    *internal_node_key(left_split, count) = node_max_key;
-                    *node_parent(node) = left_split_page_num;
-                }
-            } else {
-                /* since the number of children is always +1 on the number of cells in
-                 * internal node (basically checks if its the last child) */
-                if (count == INTERNAL_NODE_MAX_CELLS+1) {
-                    // this is the rightmost child for the right split
-                    *internal_node_right_child(right_split) = current_pn;
-                    *node_parent(node) = right_split_page_num;
-                } else {
-                    // copy to right split
-                    (*internal_node_num_keys(right_split))++;
-                    *internal_node_child(right_split, right_split_child_index) = current_pn;
-                    *internal_node_key(right_split, right_split_child_index) = node_max_key;
-                    right_split_child_index++;
-                    *node_parent(node) = right_split_page_num;
-                }
-            }
-
-            current_pn = *leaf_node_next_leaf(node);
-            count++;
-        }
+/* Handles the splitting of a full internal node, `path[level]` => the internal node that we
+ * want to split (its ancestors are before it in the `path`), `child_page_number` => the new
+ * child that didn't fit into it.
+ * The node keeps the lower half of its children and a new node gets the upper half, the new node
+ * is then inserted into the parent (recursively splitting it when it's full as well).
+ * Only the cells of the node are copied, the children themselves aren't touched.
+ * When the root splits, a new root is created above it and the tree grows by one level [void] */
+void internal_node_split_and_insert(Table* table, uint32_t* path, uint32_t level, uint32_t child_page_number) {
+    Pager* pager = table->pager;
+    uint32_t node_page_number = path[level];
+    void* node = get_page(pager, node_page_number);
+    void* child = get_page(pager, child_page_number);
+    uint32_t child_max_key = get_node_max_key(pager, child);
+    uint32_t old_max = get_node_max_key(pager, node); // this is the maximum key of the node thats going to split
+    uint32_t num_keys = *internal_node_num_keys(node);
 
-        create_new_internal_root(table, original_root, root_first_key, left_split_page_num, right_split_page_num);
+    /* All children of the node plus the new child sorted by their keys (kept in arrays, like in
+     * the node), the right child doesn't have a key in the node, it gets the node's max key */
+    uint32_t children[INTERNAL_NODE_MAX_CELLS + 2];
+    uint32_t keys[INTERNAL_NODE_MAX_CELLS + 2];
+    uint32_t rows[INTERNAL_NODE_MAX_CELLS + 2];
+    uint32_t index = child_max_key > old_max ? num_keys + 1 : internal_node_find_child(node, child_max_key);
+    uint32_t before = index > num_keys ? num_keys : index;
+
+    memcpy(children, internal_node_children(node), before * INTERNAL_NODE_CHILD_SIZE);
+    memcpy(keys, internal_node_keys(node), before * INTERNAL_NODE_KEY_SIZE);
+    memcpy(children + before + 1, internal_node_children(node) + before, (num_keys - before) * INTERNAL_NODE_CHILD_SIZE);
+    memcpy(keys + before + 1, internal_node_keys(node) + before, (num_keys - before) * INTERNAL_NODE_KEY_SIZE);
+    memcpy(rows, internal_node_rows(node), before * INTERNAL_NODE_ROWS_SIZE);
+    memcpy(rows + before + 1, internal_node_rows(node) + before, (num_keys - before) * INTERNAL_NODE_ROWS_SIZE);
+    children[num_keys + 1] = *internal_node_right_child(node);
+    keys[num_keys + 1] = old_max;
+    rows[num_keys + 1] = *internal_node_right_child_rows(node);
+    if (index > num_keys) {
+        /* the new child is the biggest one, the old right child goes before it */
+        children[num_keys] = children[num_keys + 1];
+        keys[num_keys] = old_max;
+        rows[num_keys] = rows[num_keys + 1];
+        children[num_keys + 1] = child_page_number;
+        keys[num_keys + 1] = child_max_key;
+        rows[num_keys + 1] = node_row_count(child);
+    } else {
+        children[index] = child_page_number;
+        keys[index] = child_max_key;
+        rows[index] = node_row_count(child);
+    }
 
-        /* finally setting the parent node pointer for the new splits */
-        *node_parent(left_split) = table->root_page_number;
-        *node_parent(right_split) = table->root_page_number;
+    /* (num_keys + 2) children are divided between old (left) and new (right) node,
+     * the last child of each half becomes its right child.
+     * When the new child is appended to the rightmost node of its level, the old node stays full
+     * and the new node starts with the last two children (sequential ids only ever grow the right edge) */
+    uint32_t child_count = num_keys + 2;
+    uint32_t left_count = child_count / 2;
+    if (index > num_keys && internal_node_is_rightmost(table, path, level))
+        left_count = child_count - 2;
+    uint32_t right_count = child_count - left_count;
+
+    uint32_t new_page_number = get_unused_page_number(pager); // this page number is for the new, split node
+    void* new_node = get_page(pager, new_page_number);
+    pager_mark_dirty(pager, node_page_number);
+    pager_mark_dirty(pager, new_page_number);
+    initialize_internal_node(new_node);
+
+    *internal_node_num_keys(node) = left_count - 1;
+    memcpy(internal_node_children(node), children, (left_count - 1) * INTERNAL_NODE_CHILD_SIZE);
+    memcpy(internal_node_keys(node), keys, (left_count - 1) * INTERNAL_NODE_KEY_SIZE);
+    memcpy(internal_node_rows(node), rows, (left_count - 1) * INTERNAL_NODE_ROWS_SIZE);
+    *internal_node_right_child(node) = children[left_count - 1];
+    *internal_node_right_child_rows(node) = rows[left_count - 1];
+    uint32_t new_max = keys[left_count - 1];
+
+    *internal_node_num_keys(new_node) = right_count - 1;
+    memcpy(internal_node_children(new_node), children + left_count, (right_count - 1) * INTERNAL_NODE_CHILD_SIZE);
+    memcpy(internal_node_keys(new_node), keys + left_count, (right_count - 1) * INTERNAL_NODE_KEY_SIZE);
+    memcpy(internal_node_rows(new_node), rows + left_count, (right_count - 1) * INTERNAL_NODE_ROWS_SIZE);
+    *internal_node_right_child(new_node) = children[child_count - 1];
+    *internal_node_right_child_rows(new_node) = rows[child_count - 1];
+
+    if (level == 0) {
+        /* the root moves to a new page, and a new root is created above both halves */
+        create_new_root(table, new_page_number);
     } else {
-        /* case if given node is not root, just add a new page and copy half of the stuff there */
-
-        /* create new node page */
-        uint32_t new_node_page_num = get_unused_page_number(table->pager);
-        void* new_node = get_page(table->pager, new_node_page_num);
-
-        initialize_internal_node(new_node);
-
-        int32_t lowest_pn = leaf_node_get_smallest(table, given_node);
-        int32_t current_pn = lowest_pn;
-        int32_t count = 0;
-        uint32_t child_index = 0;
-        uint32_t new_max;
-
-        /* loops until the mostright child (pn==0) or until it loops INTERNAL_NODE_MAX_CELLS+1 times (max size) */
-        while (current_pn != 0 && count < INTERNAL_NODE_MAX_CELLS+2) {
-            void* curr_node = get_page(table->pager, current_pn);
-            uint32_t node_max_key = get_node_max_key(curr_node);
-
-            if (count > INTERNAL_NODE_LEFT_SPLIT_KEY_COUNT) {
-                if (count == INTERNAL_NODE_MAX_CELLS+1) {
-                    /* COPY THE RIGHTMOST CHILD FOR THE NEW NODE */
-                    *internal_node_right_child(new_node) = current_pn;
-                    *node_parent(new_node) = table->root_page_number; // because the root stays the same 
-                    *node_parent(curr_node) = new_node_page_num;
-                } else {
-                    /* COPY REGULAR CELLS TO NEW INTERNAL NODE */
-                    (*internal_node_num_keys(new_node))++;
-                    *internal_node_child(new_node, child_index) = current_pn;
-                    *internal_node_key(new_node, child_index++) = node_max_key;
-                    *node_parent(curr_node) = new_node_page_num;
-                }
-                /* DECREMENT GIVEN NODE VARIABLES (original node) */
-                (*internal_node_num_keys(given_node))--;
-            } else if (count == INTERNAL_NODE_SPLIT_KEY_INDEX) {
-                /* this is the new rightmost child for given_node (original node) */
-                *internal_node_right_child(given_node) = current_pn;
-                new_max = node_max_key;
-            }
-
-            current_pn = *leaf_node_next_leaf(curr_node);
-            count++;
-        }
+        uint32_t parent_page_number = path[level - 1];
+        void* parent = get_page(pager, parent_page_number);
+        pager_mark_dirty(pager, parent_page_number);
+
+        update_internal_node_key(parent, old_max, new_max);
+        internal_node_set_child_rows(parent, node_page_number, node);
+        internal_node_insert(table, path, level - 1, new_page_number);
+    }
+}
+
+/* checks if `path[level]` is the rightmost node of its level, that's when every node
+ * above it on the path has it (or its ancestor) as the right child [bool] */
+bool internal_node_is_rightmost(Table* table, uint32_t* path, uint32_t level) {
+    for (uint32_t i = 0; i < level; i++) {
+        void* node = get_page(table->pager, path[i]);
+        if (*internal_node_right_child(node) != path[i + 1])
+            return false;
+    }
+    return true;
+}
+
+/* positions the cursor (the caller's) at the row with the desired key, 
+ * if there isn't a row with the desired key, cursor will point to where that
+ * key should be inserted, the internal nodes on the way down are stored in the
+ * cursor's path (nodes don't store their parent, splits use the path instead) [void] */
+void internal_node_find(Table* table, uint32_t page_num, uint32_t key, Cursor* cursor) {
+  uint32_t path[BTREE_MAX_DEPTH];
+  uint32_t depth = 0;
+
+  uint32_t frame_index;
+  void* node = get_page_frame(table->pager, page_num, &frame_index);
+  while (get_node_type(node) == NODE_INTERNAL) {
+    if (depth == BTREE_MAX_DEPTH) {
+      printf("Tree is deeper than %d levels.\n", BTREE_MAX_DEPTH);
+      exit(EXIT_FAILURE);
+    }
+    path[depth++] = page_num;
+
+    uint32_t child_index = internal_node_find_child(node, key);
+    page_num = *internal_node_child(node, child_index);
+    node = get_page_frame(table->pager, page_num, &frame_index);
+  }
 
-        /* REMINDER: parent page is not always `table->root_page_number`
-         * it is only when there is 2 layers of internal nodes (root, and then root's children) */
-        /* Now we connect the new node to the parent node */
-        *node_parent(new_node) = table->root_page_number;
+  /* same as `leaf_node_find()`, the leaf is searched and pinned through its frame */
+  cursor->table = table;
+  cursor->page_number = page_num;
+  cursor->end_of_table = false;
+  pager_pin_frame(table->pager, frame_index);
+  cursor->cell_number = key_search(leaf_node_keys(node), *leaf_node_num_cells(node), key);
+  memcpy(cursor->path, path, depth * sizeof(uint32_t));
+  cursor->depth = depth;
+}
 
-        /* Update the parent node with the new child pointer and key */
-        void* parent = get_page(table->pager, table->root_page_number);
 
-        uint32_t given_node_old_max = get_node_max_key(given_node);
+/* returns the index (in the internal node) of the child that contains the inputed key [uint32_t] */
+uint32_t internal_node_find_child(void* node, uint32_t key) {
+    /* the first key >= the searched key, the right child (index `num_keys`) if there is none,
+     * since there is one more child than the number of keys */
+    return key_search(internal_node_keys(node), *internal_node_num_keys(node), key);
+}
 
-        internal_node_insert(table, table->root_page_number, new_node_page_num);
-        /* updating the key in the parent node */
-        update_internal_node_key(parent, given_node_old_max, new_max);
 
-        /* this code is for the wrong order bug, 
-         * just setting the parent child page numbers */
-        uint32_t given_node_cell_index = internal_node_find_child(parent, given_node_old_max);
-        *internal_node_child(parent, given_node_cell_index) = node_page_number;
-        *internal_node_child(parent, given_node_cell_index+1) = new_node_page_num;
+/* returns the index of the child with the given page number in the internal node [uint32_t] */
+uint32_t internal_node_child_index(void* node, uint32_t child_page_number) {
+    uint32_t num_keys = *internal_node_num_keys(node);
+    for (uint32_t i = 0; i < num_keys; i++) {
+        if (*internal_node_child(node, i) == child_page_number)
+            return i;
     }
+
+    return num_keys;
 }
 
-/* handles the creation of the new internal node after internal node spliting */
-void create_new_internal_root(Table* table, void* root, uint32_t key, uint32_t left_split_pn, uint32_t right_split_pn) {
-  initialize_internal_node(root);
-  
-  /* setting up */
-  set_node_root(root, true);
-  *internal_node_num_keys(root) = 1;
-  *internal_node_key(root, 0) = key;
 
-  *internal_node_child(root, 0) = left_split_pn;
-  *internal_node_right_child(root) = right_split_pn;
+/* DELETION
+ * Keys in the internal nodes are upper bounds of their children, deleting the max key of a
+ * child doesn't update them (a search still ends in the right child). Nodes that get too
+ * small are merged with a sibling (under the same parent) when both fit into one node, or
+ * take cells from it otherwise, emptied pages go on the free list */
+
+/* removes `count` cells starting at `cell_number` from the leaf, their records become
+ * fragmented bytes (reclaimed by `leaf_node_defragment()`) [void] */
+void leaf_node_remove_cells(void* node, uint32_t cell_number, uint32_t count) {
+    uint32_t num_cells = *leaf_node_num_cells(node);
 
-//   printf("ROOT INTERNAL NODE SPLIT. NEW ROOT INTERNAL NODE CREATED.\n");
+    uint32_t removed_bytes = 0;
+    for (uint32_t i = cell_number; i < cell_number + count; i++)
+        removed_bytes += *leaf_node_record_length(node, i);
+
+    /* the keys after the removed ones move down, then the directory moves down to the new end
+     * of the keys (the entries after the removed ones by `count` more entries) */
+    uint8_t* keys = (uint8_t*)leaf_node_keys(node);
+    uint8_t* directory = keys + num_cells * LEAF_NODE_KEY_SIZE;
+    uint8_t* new_directory = keys + (num_cells - count) * LEAF_NODE_KEY_SIZE;
+    memmove(keys + cell_number * LEAF_NODE_KEY_SIZE, keys + (cell_number + count) * LEAF_NODE_KEY_SIZE,
+            (num_cells - cell_number - count) * LEAF_NODE_KEY_SIZE);
+    memmove(new_directory, directory, cell_number * LEAF_NODE_RECORD_ENTRY_SIZE);
+    memmove(new_directory + cell_number * LEAF_NODE_RECORD_ENTRY_SIZE, directory + (cell_number + count) * LEAF_NODE_RECORD_ENTRY_SIZE,
+            (num_cells - cell_number - count) * LEAF_NODE_RECORD_ENTRY_SIZE);
+    *leaf_node_num_cells(node) = num_cells - count;
+    *leaf_node_fragmented_bytes(node) += removed_bytes;
+
+    if (num_cells == count) {
+        /* the node is empty, the whole record area is free again */
+        *leaf_node_content_start(node) = PAGE_SIZE;
+        *leaf_node_fragmented_bytes(node) = 0;
+    }
 }
 
-/* returned cursor object is positioned at the row with the desired key, 
- * if there isn't a row with the desired key, cursor will point to where that
- * key should be inserted [Cursor*] */
-Cursor* internal_node_find(Table* table, uint32_t page_num, uint32_t key) {
-  void* node = get_page(table->pager, page_num);
-
-  uint32_t child_index = internal_node_find_child(node, key);
-  uint32_t child_num = *internal_node_child(node, child_index);
-  void* child = get_page(table->pager, child_num);
-
-  switch (get_node_type(child)) {
-    case NODE_LEAF:
-      return leaf_node_find(table, child_num, key);
-    case NODE_INTERNAL:
-      return internal_node_find(table, child_num, key);
-  }
+/* deletes `count` rows starting at the cursor's position from its leaf, the leaf (and the
+ * internal nodes above it) is rebalanced when it becomes too small [void] */
+void leaf_node_delete(Cursor* cursor, uint32_t count) {
+    void* node = get_page(cursor->table->pager, cursor->page_number);
+    /* a valid zone map stays valid without the rows (until the leaf is rebalanced) */
+    ZoneMap* zone = pager_valid_zone_map(cursor->table->pager, cursor->page_number);
+    pager_mark_dirty(cursor->table->pager, cursor->page_number);
+    if (zone != NULL)
+        zone_map_publish(zone);
+
+    uint32_t key = *leaf_node_key(node, cursor->cell_number);
+    leaf_node_remove_cells(node, cursor->cell_number, count);
+    internal_node_add_rows(cursor->table, cursor->path, cursor->depth, cursor->page_number, key, -(int32_t)count);
+    leaf_node_rebalance(cursor->table, cursor->path, cursor->depth, cursor->page_number);
 }
 
+/* merges the leaf with its sibling if both fit into one leaf, or divides the cells of both
+ * evenly otherwise, `path` => internal nodes above the leaf, `depth` => length of the path [void] */
+void leaf_node_rebalance(Table* table, uint32_t* path, uint32_t depth, uint32_t page_number) {
+    Pager* pager = table->pager;
+    void* node = get_page(pager, page_number);
 
-/* returns the index (in the internal node) of the child that contains the inputed key [uint32_t] */
-uint32_t internal_node_find_child(void* node, uint32_t key) {
+    // the root leaf can hold any number of cells
+    if (depth == 0 || leaf_node_used_space(node) >= LEAF_NODE_MIN_SPACE)
+        return;
+
+    uint32_t parent_page_number = path[depth - 1];
+    void* parent = get_page(pager, parent_page_number);
+    uint32_t num_keys = *internal_node_num_keys(parent);
+    if (num_keys == 0)
+        return; // no sibling under the same parent
+
+    /* the sibling on the right, or on the left for the right child */
+    uint32_t index = internal_node_child_index(parent, page_number);
+    uint32_t left_index = index < num_keys ? index : index - 1;
+    uint32_t left_page_number = *internal_node_child(parent, left_index);
+    uint32_t right_page_number = *internal_node_child(parent, left_index + 1);
+    void* left = get_page(pager, left_page_number);
+    void* right = get_page(pager, right_page_number);
+
+    /* the leaf and the path of the previous search may not be valid anymore */
+    table_clear_hint(table);
+
+    pager_mark_dirty(pager, parent_page_number);
+    pager_mark_dirty(pager, left_page_number);
+    pager_mark_dirty(pager, right_page_number);
+
+    if (leaf_node_used_space(left) + leaf_node_used_space(right) <= LEAF_NODE_SPACE_FOR_CELLS) {
+        leaf_node_merge(left, right);
+        internal_node_remove_child(parent, left_index + 1);
+        internal_node_set_child_rows(parent, left_page_number, left);
+        pager_free_page(pager, right_page_number);
+
+        // the parent lost a child
+        internal_node_rebalance(table, path, depth - 1);
+    } else {
+        leaf_node_redistribute(left, right);
+        *internal_node_key(parent, left_index) = *leaf_node_key(left, *leaf_node_num_cells(left) - 1);
+        internal_node_set_child_rows(parent, left_page_number, left);
+        internal_node_set_child_rows(parent, right_page_number, right);
+    }
+}
+
+/* moves all cells of the right leaf to the end of the left leaf (its sibling), the caller
+ * has to make sure they fit [void] */
+void leaf_node_merge(void* left, void* right) {
+    if (leaf_node_free_space(left) < leaf_node_used_space(right))
+        leaf_node_defragment(left);
+
+    for (uint32_t i = 0; i < *leaf_node_num_cells(right); i++) {
+        leaf_node_place_cell(left, *leaf_node_num_cells(left), *leaf_node_key(right, i),
+                             leaf_node_value(right, i), *leaf_node_record_length(right, i));
+    }
+
+    *leaf_node_next_leaf(left) = *leaf_node_next_leaf(right);
+}
+
+/* divides the cells of two sibling leaves, so that both get about half of the bytes [void] */
+void leaf_node_redistribute(void* left, void* right) {
+    uint8_t left_copy[PAGE_SIZE];
+    uint8_t right_copy[PAGE_SIZE];
+    memcpy(left_copy, left, PAGE_SIZE);
+    memcpy(right_copy, right, PAGE_SIZE);
+
+    initialize_leaf_node(left);
+    *leaf_node_next_leaf(left) = *leaf_node_next_leaf(left_copy);
+    initialize_leaf_node(right);
+    *leaf_node_next_leaf(right) = *leaf_node_next_leaf(right_copy);
+
+    uint32_t left_cells = *leaf_node_num_cells(left_copy);
+    uint32_t num_cells = left_cells + *leaf_node_num_cells(right_copy);
+    uint32_t total = leaf_node_used_space(left_copy) + leaf_node_used_space(right_copy);
+    uint32_t left_bytes = 0;
+
+    for (uint32_t i = 0; i < num_cells; i++) {
+        void* source = i < left_cells ? left_copy : right_copy;
+        uint32_t index = i < left_cells ? i : i - left_cells;
+        uint32_t cell_length = *leaf_node_record_length(source, index);
+
+        /* same rule as the split, both nodes get at least one cell */
+        uint32_t cell_size = LEAF_NODE_SLOT_SIZE + cell_length;
+        bool to_left = i == 0 || (i < num_cells - 1 && *leaf_node_num_cells(right) == 0 &&
+                                  left_bytes + cell_size <= total / 2);
+
+        void* destination_node = to_left ? left : right;
+        leaf_node_place_cell(destination_node, *leaf_node_num_cells(destination_node), *leaf_node_key(source, index),
+                             leaf_node_value(source, index), cell_length);
+        if (to_left)
+            left_bytes += cell_size;
+    }
+}
+
+/* removes a child (and its key) from the internal node, the child before it (that it was merged
+ * into) takes over its key, or becomes the right child [void] */
+void internal_node_remove_child(void* node, uint32_t child_number) {
     uint32_t num_keys = *internal_node_num_keys(node);
 
-    /* Binary search */
-    uint32_t min_index = 0;
-    uint32_t max_index = num_keys; // since there is one more child than the number of keys
-    while (min_index != max_index) {
-        uint32_t index = (min_index+max_index)/2;
-        uint32_t key_to_right = *internal_node_key(node, index);
-        if (key_to_right >= key)
-            max_index = index;
-        else
-            min_index = index+1;
+    if (child_number == num_keys) {
+        *internal_node_right_child(node) = *internal_node_child(node, num_keys - 1);
+        *internal_node_right_child_rows(node) = internal_node_rows(node)[num_keys - 1];
+    } else {
+        *internal_node_key(node, child_number - 1) = *internal_node_key(node, child_number);
+        memmove(internal_node_keys(node) + child_number, internal_node_keys(node) + child_number + 1,
+                (num_keys - child_number - 1) * INTERNAL_NODE_KEY_SIZE);
+        memmove(internal_node_children(node) + child_number, internal_node_children(node) + child_number + 1,
+                (num_keys - child_number - 1) * INTERNAL_NODE_CHILD_SIZE);
+        memmove(internal_node_rows(node) + child_number, internal_node_rows(node) + child_number + 1,
+                (num_keys - child_number - 1) * INTERNAL_NODE_ROWS_SIZE);
     }
 
-    return min_index;
+    *internal_node_num_keys(node) = num_keys - 1;
 }
 
+/* rebalances `path[level]` after it lost a child, like the leaves, it's merged with its sibling
+ * or takes children from it, a root with a single child is replaced by that child and the
+ * tree shrinks by one level [void] */
+void internal_node_rebalance(Table* table, uint32_t* path, uint32_t level) {
+    Pager* pager = table->pager;
+    uint32_t page_number = path[level];
+    void* node = get_page(pager, page_number);
+
+    if (level == 0) {
+        if (*internal_node_num_keys(node) == 0) {
+            /* the child is copied into the root page, the root always stays on the same page */
+            uint32_t child_page_number = *internal_node_right_child(node);
+            void* child = get_page(pager, child_page_number);
+
+            pager_mark_dirty(pager, page_number);
+            memcpy(node, child, PAGE_SIZE);
+            set_node_root(node, true);
+            pager_free_page(pager, child_page_number);
+
+            table->internal_node_layers--;
+        }
+        return;
+    }
+
+    if (*internal_node_num_keys(node) >= INTERNAL_NODE_MIN_KEYS)
+        return;
 
-/* handles splitting the root,
+    uint32_t parent_page_number = path[level - 1];
+    void* parent = get_page(pager, parent_page_number);
+    uint32_t num_keys = *internal_node_num_keys(parent);
+    if (num_keys == 0)
+        return; // no sibling under the same parent
+
+    uint32_t index = internal_node_child_index(parent, page_number);
+    uint32_t left_index = index < num_keys ? index : index - 1;
+    uint32_t left_page_number = *internal_node_child(parent, left_index);
+    uint32_t right_page_number = *internal_node_child(parent, left_index + 1);
+    void* left = get_page(pager, left_page_number);
+    void* right = get_page(pager, right_page_number);
+
+    pager_mark_dirty(pager, parent_page_number);
+    pager_mark_dirty(pager, left_page_number);
+    pager_mark_dirty(pager, right_page_number);
+
+    /* All children of both nodes with their keys and row counts (in arrays, like in the node), the
+     * right child of the left node gets the parent's key between the two nodes */
+    uint32_t children[2 * (INTERNAL_NODE_MAX_CELLS + 1)];
+    uint32_t keys[2 * (INTERNAL_NODE_MAX_CELLS + 1)];
+    uint32_t rows[2 * (INTERNAL_NODE_MAX_CELLS + 1)];
+    uint32_t left_keys = *internal_node_num_keys(left);
+    uint32_t right_keys = *internal_node_num_keys(right);
+    uint32_t child_count = left_keys + right_keys + 2;
+
+    memcpy(children, internal_node_children(left), left_keys * INTERNAL_NODE_CHILD_SIZE);
+    memcpy(keys, internal_node_keys(left), left_keys * INTERNAL_NODE_KEY_SIZE);
+    children[left_keys] = *internal_node_right_child(left);
+    keys[left_keys] = *internal_node_key(parent, left_index);
+    memcpy(children + left_keys + 1, internal_node_children(right), right_keys * INTERNAL_NODE_CHILD_SIZE);
+    memcpy(keys + left_keys + 1, internal_node_keys(right), right_keys * INTERNAL_NODE_KEY_SIZE);
+    children[child_count - 1] = *internal_node_right_child(right);
+    memcpy(rows, internal_node_rows(left), left_keys * INTERNAL_NODE_ROWS_SIZE);
+    rows[left_keys] = *internal_node_right_child_rows(left);
+    memcpy(rows + left_keys + 1, internal_node_rows(right), right_keys * INTERNAL_NODE_ROWS_SIZE);
+    rows[child_count - 1] = *internal_node_right_child_rows(right);
+
+    if (child_count - 1 <= INTERNAL_NODE_MAX_CELLS) {
+        /* both fit into the left node */
+        *internal_node_num_keys(left) = child_count - 1;
+        memcpy(internal_node_children(left), children, (child_count - 1) * INTERNAL_NODE_CHILD_SIZE);
+        memcpy(internal_node_keys(left), keys, (child_count - 1) * INTERNAL_NODE_KEY_SIZE);
+        memcpy(internal_node_rows(left), rows, (child_count - 1) * INTERNAL_NODE_ROWS_SIZE);
+        *internal_node_right_child(left) = children[child_count - 1];
+        *internal_node_right_child_rows(left) = rows[child_count - 1];
+
+        internal_node_remove_child(parent, left_index + 1);
+        internal_node_set_child_rows(parent, left_page_number, left);
+        pager_free_page(pager, right_page_number);
+
+        // the parent lost a child
+        internal_node_rebalance(table, path, level - 1);
+    } else {
+        /* the last child of each half becomes its right child */
+        uint32_t left_count = child_count / 2;
+        uint32_t right_count = child_count - left_count;
+
+        *internal_node_num_keys(left) = left_count - 1;
+        memcpy(internal_node_children(left), children, (left_count - 1) * INTERNAL_NODE_CHILD_SIZE);
+        memcpy(internal_node_keys(left), keys, (left_count - 1) * INTERNAL_NODE_KEY_SIZE);
+        memcpy(internal_node_rows(left), rows, (left_count - 1) * INTERNAL_NODE_ROWS_SIZE);
+        *internal_node_right_child(left) = children[left_count - 1];
+        *internal_node_right_child_rows(left) = rows[left_count - 1];
+        *internal_node_key(parent, left_index) = keys[left_count - 1];
+
+        *internal_node_num_keys(right) = right_count - 1;
+        memcpy(internal_node_children(right), children + left_count, (right_count - 1) * INTERNAL_NODE_CHILD_SIZE);
+        memcpy(internal_node_keys(right), keys + left_count, (right_count - 1) * INTERNAL_NODE_KEY_SIZE);
+        memcpy(internal_node_rows(right), rows + left_count, (right_count - 1) * INTERNAL_NODE_ROWS_SIZE);
+        *internal_node_right_child(right) = children[child_count - 1];
+        *internal_node_right_child_rows(right) = rows[child_count - 1];
+
+        internal_node_set_child_rows(parent, left_page_number, left);
+        internal_node_set_child_rows(parent, right_page_number, right);
+    }
+}
+
+/* handles splitting the root (leaf or internal),
  * old root is copied to the new page (it then becomes the left child),
  * re-initializes the root page to contain the new root node,
- * new root node points to two children [void] */
+ * new root node points to two children, the tree grows by one level [void] */
 void create_new_root(Table* table, uint32_t right_child_page_number) {
-    /* this function is called only when the original leaf node (root node at the
-     * time of calling) is split, so there is a need for the internal node to become
-     * the root */
-    table->internal_node_layers = 1;
-    
+    /* the root always stays on `table->root_page_number` (the header points to it) */
+    table->internal_node_layers++;
+
     /* new root node points to two children (left and right child) */
     /* original page (left node) */
     void* root = get_page(table->pager, table->root_page_number);
     /* new page (right node) */
     void* right_child = get_page(table->pager, right_child_page_number);
+    pager_mark_dirty(table->pager, table->root_page_number);
+    pager_mark_dirty(table->pager, right_child_page_number);
 
     /* new page number for the original child,
      * transfering old root (original left child) to the new page_number) */
     uint32_t left_child_page_number = get_unused_page_number(table->pager);
     void* left_child = get_page(table->pager, left_child_page_number);
+    pager_mark_dirty(table->pager, left_child_page_number);
   
     /* transfering old left child to the new destination, so we can reuse the
      * root page */
@@ -680,15 +1195,14 @@ void create_new_root(Table* table, uint32_t right_child_page_number) {
 
     /* setting the first children of the new internal node */
     *internal_node_child(root, 0) = left_child_page_number;
-    uint32_t left_child_max_key = get_node_max_key(left_child);
+    uint32_t left_child_max_key = get_node_max_key(table->pager, left_child);
     *internal_node_key(root, 0) = left_child_max_key;
 
     /* setting the right child for the new internal node */
     *internal_node_right_child(root) = right_child_page_number;
 
-    /* setting the page_number of a parent node for the left and right child */
-    *node_parent(left_child) = table->root_page_number;
-    *node_parent(right_child) = table->root_page_number;
+    internal_node_rows(root)[0] = node_row_count(left_child);
+    *internal_node_right_child_rows(root) = node_row_count(right_child);
 }
 
 
@@ -1,6 +1,9 @@
 #include "command.h"
 #include "btree.h"
 #include "buffer.h"
+#include "import.h"
+#include "alloc.h"
+#include "output.h"
 
 /* main function for meta command handling [MetaCommandResult] */
 MetaCommandResult do_meta_command(InputBuffer* input_buffer, Table* table) {
@@ -9,15 +12,22 @@ MetaCommandResult do_meta_command(InputBuffer* input_buffer, Table* table) {
         exit(EXIT_SUCCESS);
     } else if (strcmp(input_buffer->buffer, ".btree") == 0) {
         printf("Btree:\n");
-        print_btree(table->pager, 0, 0);
+        print_btree(table->pager, table->root_page_number, 0);
         /*print_leaf_node(get_page(table->pager, 0));*/
         return META_COMMAND_SUCCESS;
     } else if (strcmp(input_buffer->buffer, ".constants") == 0) {
         printf("Constants:\n");
         print_constants();
         return META_COMMAND_SUCCESS;
+    } else if (strcmp(input_buffer->buffer, ".allocations") == 0) {
+        printf("Heap allocations of the last statement: %llu\n", (unsigned long long)statement_allocations);
+        return META_COMMAND_SUCCESS;
+    } else if (strncmp(input_buffer->buffer, ".mode", 5) == 0) {
+        return mode_command(input_buffer);
     } else if (strncmp(input_buffer->buffer, ".pageinfo", 9) == 0) {
         return page_info_command(input_buffer, table);
+    } else if (strncmp(input_buffer->buffer, ".import", 7) == 0) {
+        return import_command(input_buffer, table);
     } else {
         return META_COMMAND_UNRECOGNIZED;
     }
@@ -45,3 +55,40 @@ MetaCommandResult page_info_command(InputBuffer* input_buffer, Table* table) {
         }
     }
 }
+
+/* function that handles `.import {file.csv} [fill_factor]` meta command [MetaCommandResult] */
+MetaCommandResult import_command(InputBuffer* input_buffer, Table* table) {
+    strtok(input_buffer->buffer, " ");
+    char* filename = strtok(NULL, " ");
+    char* fill_factor_string = strtok(NULL, " ");
+    if (filename == NULL) {
+        printf("Usage: `.import {file.csv} [fill_factor]`, every line of the file is `id,username,email`.\n");
+        return META_COMMAND_SUCCESS;
+    }
+
+    /* percentage of every page that's filled with rows (100 == packed) */
+    int fill_factor = IMPORT_DEFAULT_FILL_FACTOR;
+    if (fill_factor_string != NULL)
+        fill_factor = atoi(fill_factor_string);
+    if (fill_factor < 1 || fill_factor > 100) {
+        printf("Fill factor has to be between 1 and 100.\n");
+        return META_COMMAND_SUCCESS;
+    }
+
+    import_csv(table, filename, (uint32_t)fill_factor);
+    return META_COMMAND_SUCCESS;
+}
+
+/* function that handles `.mode {text|csv|binary}` meta command, the format of the results [MetaCommandResult] */
+MetaCommandResult mode_command(InputBuffer* input_buffer) {
+    strtok(input_buffer->buffer, " ");
+    char* mode = strtok(NULL, " ");
+    if (mode == NULL) {
+        printf("Output mode: %s\nTo change it, use `.mode {text|csv|binary}`.\n", output_mode_name(output_mode));
+        return META_COMMAND_SUCCESS;
+    }
+
+    if (!output_set_mode(mode))
+        printf("Unrecognized output mode '%s' (text, csv, binary).\n", mode);
+    return META_COMMAND_SUCCESS;
+}
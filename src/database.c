@@ -2,12 +2,14 @@
 #include "command.h"
 #include "statement.h"
 #include "table.h"
+#include "output.h"
 
 #include <stdbool.h>
 
-/* prints prompt [void] */
+/* prints prompt (only in text mode, the other output modes only print results) [void] */
 void print_prompt() {
-    printf("db > ");
+    if (output_mode == OUTPUT_TEXT)
+        printf("db > ");
 }
 
 int main(int argc, char* argv[]) {
@@ -18,8 +20,39 @@ int main(int argc, char* argv[]) {
 
     char* filename = argv[1];   
 
+    /* parsing the options that follow the filename */
+    DbOptions options = { .pager_mode = PAGER_BUFFERED, .cache_pages = PAGER_DEFAULT_MAX_FRAMES, .sync_level = SYNC_NORMAL, .threads = 0 };
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--cache-size") == 0 && i+1 < argc) {
+            /* buffer pool size in megabytes */
+            options.cache_pages = (uint32_t)(atol(argv[++i]) * 1024 * 1024 / PAGE_SIZE);
+        } else if (strcmp(argv[i], "--threads") == 0 && i+1 < argc) {
+            /* threads of parallel scans (1 == scans aren't parallel) */
+            options.threads = (uint32_t)atol(argv[++i]);
+        } else if (strcmp(argv[i], "--mmap") == 0) {
+            /* memory mapped pager instead of the buffer pool */
+            options.pager_mode = PAGER_MMAP;
+        } else if (strcmp(argv[i], "--sync") == 0 && i+1 < argc) {
+            /* durability level of the write-ahead log */
+            i++;
+            if (strcmp(argv[i], "off") == 0)
+                options.sync_level = SYNC_OFF;
+            else if (strcmp(argv[i], "normal") == 0)
+                options.sync_level = SYNC_NORMAL;
+            else if (strcmp(argv[i], "full") == 0)
+                options.sync_level = SYNC_FULL;
+            else {
+                printf("Unrecognized sync level '%s' (off, normal, full).\n", argv[i]);
+                exit(EXIT_FAILURE);
+            }
+        } else {
+            printf("Unrecognized option '%s'.\n", argv[i]);
+            exit(EXIT_FAILURE);
+        }
+    }
+
     /* create a table */
-    Table* table = db_open(filename);
+    Table* table = db_open(filename, &options);
 
     /* create the input buffer */
     InputBuffer* input_buffer = new_input_buffer();
@@ -74,6 +107,9 @@ int main(int argc, char* argv[]) {
             case (EXECUTE_TABLE_FULL):
                 printf("ERROR. Table is full.\n");
                 break;
+            case (EXECUTE_INDEX_EXISTS):
+                printf("Error: Index already exists.\n");
+                break;
         }
     }
 }
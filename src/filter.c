@@ -0,0 +1,356 @@
+#include "filter.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define FILTER_X86
+#endif
+
+uint32_t filter_values_resolve(const Predicate* predicate, const char** values, const uint8_t* lengths,
+                               uint32_t count, uint16_t* selection);
+
+/* starts as the resolver, which replaces it with the selected variant (the first call can be on the
+ * threads of a parallel scan, so it's read and replaced atomically) */
+FilterFunction filter_values = filter_values_resolve;
+
+
+/* sets up a predicate, the value is the pattern without its `%` characters [void] */
+void predicate_init(Predicate* predicate, IndexColumn column, MatchKind match, const char* value) {
+    predicate->column = column;
+    predicate->match = match;
+    predicate->length = strlen(value);
+    memset(predicate->value, 0, sizeof(predicate->value));
+    memcpy(predicate->value, value, predicate->length);
+
+    uint32_t tail_length = predicate->length < 16 ? predicate->length : 16;
+    memset(predicate->tail, 0, sizeof(predicate->tail));
+    memcpy(predicate->tail + 16 - tail_length, value + predicate->length - tail_length, tail_length);
+
+    /* equalities and prefixes fix the prefix of the value (a short prefix a range of prefixes),
+     * an email equality or a suffix with a '@' (`%@mail.com`) fixes the domain */
+    ZoneFilter* zone = &predicate->zone;
+    zone->email = column == INDEX_EMAIL;
+    zone->ranged = match == MATCH_EQUAL || match == MATCH_PREFIX;
+    zone->low = zone_prefix(value, predicate->length, 0);
+    zone->high = zone_prefix(value, predicate->length, match == MATCH_PREFIX ? 0xff : 0);
+    zone->domain_bits = 0;
+    const char* domain = strrchr(value, '@');
+    if (zone->email && (match == MATCH_EQUAL || (match == MATCH_SUFFIX && domain != NULL)))
+        zone->domain_bits = zone_domain_bits(value, predicate->length);
+}
+
+/* filters the rows of a batch by the predicate's column, returns the number of matching rows, their
+ * indexes are in the selection vector (it has room for `ROW_BATCH_MAX_ROWS` indexes) [uint32_t] */
+uint32_t filter_batch(const Predicate* predicate, RowBatch* batch, uint16_t* selection) {
+    FilterFunction function = __atomic_load_n(&filter_values, __ATOMIC_RELAXED);
+    if (predicate->column == INDEX_USERNAME)
+        return function(predicate, batch->usernames, batch->username_lengths, batch->count, selection);
+    return function(predicate, batch->emails, batch->email_lengths, batch->count, selection);
+}
+
+
+/* Scalar variant --------- */
+
+/* compares one value with the predicate [bool] */
+bool filter_match_scalar(const Predicate* predicate, const char* value, uint32_t length) {
+    uint32_t needle_length = predicate->length;
+    if (length < needle_length || (predicate->match == MATCH_EQUAL && length != needle_length))
+        return false;
+
+    switch (predicate->match) {
+        case (MATCH_EQUAL):
+        case (MATCH_PREFIX):
+            return memcmp(value, predicate->value, needle_length) == 0;
+        case (MATCH_SUFFIX):
+            return memcmp(value + length - needle_length, predicate->value, needle_length) == 0;
+        case (MATCH_CONTAINS):
+            for (uint32_t i = 0; i + needle_length <= length; i++)
+                if (memcmp(value + i, predicate->value, needle_length) == 0)
+                    return true;
+            return false;
+    }
+
+    return false;
+}
+
+/* compares the values one by one, used when the CPU has no SIMD support [uint32_t] */
+uint32_t filter_values_scalar(const Predicate* predicate, const char** values, const uint8_t* lengths,
+                              uint32_t count, uint16_t* selection) {
+    uint32_t selected = 0;
+    for (uint32_t i = 0; i < count; i++)
+        if (filter_match_scalar(predicate, values[i], lengths[i]))
+            selection[selected++] = i;
+
+    return selected;
+}
+
+#ifdef FILTER_X86
+
+/* The SIMD variants select the rows by their length first: a compare of 16 (or 32) length bytes
+ * gives a bit mask of the rows with the predicate's length (or at least that length). A value of up
+ * to 16 bytes is compared with one load of the 16 bytes that end at the end of the value (or of the
+ * prefix), the bytes before the value are masked out (they're in the leaf, see `ROW_BATCH_VALUE_SLACK`),
+ * longer values a block at a time. A substring is searched by comparing the first and the last byte
+ * of the needle at 16 (or 32) positions of the value at once, only the positions where both match are
+ * compared in full. Values are never read past their end (the last value of a leaf ends at the end
+ * of the page) */
+
+/* compares the predicate's value (of up to 16 bytes) with the bytes that end at `end` [bool] */
+__attribute__((target("sse2")))
+bool filter_tail_sse2(const Predicate* predicate, const char* end) {
+    __m128i equal = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(end - 16)), _mm_loadu_si128((const __m128i*)predicate->tail));
+    uint32_t wanted = (0xffffu << (16 - predicate->length)) & 0xffff;
+    return ((uint32_t)_mm_movemask_epi8(equal) & wanted) == wanted;
+}
+
+/* compares `length` bytes (at least 16), 16 at a time [bool] */
+__attribute__((target("sse2")))
+bool filter_equal_sse2(const char* a, const char* b, uint32_t length) {
+    uint32_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        __m128i equal = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(a + i)), _mm_loadu_si128((const __m128i*)(b + i)));
+        if (_mm_movemask_epi8(equal) != 0xffff)
+            return false;
+    }
+    if (i == length)
+        return true;
+
+    /* the last block overlaps the one before it */
+    i = length - 16;
+    __m128i equal = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(a + i)), _mm_loadu_si128((const __m128i*)(b + i)));
+    return _mm_movemask_epi8(equal) == 0xffff;
+}
+
+/* searches the needle in the haystack, 16 positions at a time. The last 16 positions are compared
+ * with loads that end at the end of the haystack, the positions before it are masked out [bool] */
+__attribute__((target("sse2")))
+bool filter_find_sse2(const char* haystack, uint32_t length, const char* needle, uint32_t needle_length) {
+    if (needle_length == 0)
+        return true;
+    if (length < needle_length)
+        return false;
+
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[needle_length - 1]);
+    int32_t last_block = (int32_t)length - (int32_t)needle_length - 15;
+    for (int32_t i = 0;; i += 16) {
+        if (i > last_block)
+            i = last_block;
+
+        __m128i first_block = _mm_loadu_si128((const __m128i*)(haystack + i));
+        __m128i last_block_bytes = _mm_loadu_si128((const __m128i*)(haystack + i + needle_length - 1));
+        uint32_t mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, first_block), _mm_cmpeq_epi8(last, last_block_bytes)));
+        if (i < 0)
+            mask &= 0xffffu << -i;
+        while (mask != 0) {
+            int32_t position = i + __builtin_ctz(mask);
+            if (needle_length <= 2 || memcmp(haystack + position + 1, needle + 1, needle_length - 2) == 0)
+                return true;
+            mask &= mask - 1;
+        }
+
+        if (i == last_block)
+            return false;
+    }
+}
+
+/* compares a value that's long enough with the predicate [bool] */
+__attribute__((target("sse2")))
+bool filter_match_sse2(const Predicate* predicate, const char* value, uint32_t length) {
+    uint32_t needle_length = predicate->length;
+    switch (predicate->match) {
+        case (MATCH_EQUAL):
+        case (MATCH_PREFIX):
+            if (needle_length <= 16)
+                return filter_tail_sse2(predicate, value + needle_length);
+            return filter_equal_sse2(value, predicate->value, needle_length);
+        case (MATCH_SUFFIX):
+            if (needle_length <= 16)
+                return filter_tail_sse2(predicate, value + length);
+            return filter_equal_sse2(value + length - needle_length, predicate->value, needle_length);
+        default:
+            return filter_find_sse2(value, length, predicate->value, needle_length);
+    }
+}
+
+/* selects the rows by length 16 at a time, then compares their values a block at a time [uint32_t] */
+__attribute__((target("sse2")))
+uint32_t filter_values_sse2(const Predicate* predicate, const char** values, const uint8_t* lengths,
+                            uint32_t count, uint16_t* selection) {
+    uint32_t needle_length = predicate->length;
+    const __m128i target = _mm_set1_epi8((char)needle_length);
+    uint32_t selected = 0;
+
+    for (uint32_t block = 0; block < count; block += 16) {
+        uint32_t mask;
+        if (block + 16 <= count) {
+            __m128i block_lengths = _mm_loadu_si128((const __m128i*)(lengths + block));
+            __m128i fits = predicate->match == MATCH_EQUAL ? _mm_cmpeq_epi8(block_lengths, target)
+                                                           : _mm_cmpeq_epi8(_mm_max_epu8(block_lengths, target), block_lengths);
+            mask = _mm_movemask_epi8(fits);
+        } else {
+            mask = 0;
+            for (uint32_t i = block; i < count; i++)
+                if (predicate->match == MATCH_EQUAL ? lengths[i] == needle_length : lengths[i] >= needle_length)
+                    mask |= 1u << (i - block);
+        }
+
+        while (mask != 0) {
+            uint32_t i = block + __builtin_ctz(mask);
+            mask &= mask - 1;
+            if (filter_match_sse2(predicate, values[i], lengths[i]))
+                selection[selected++] = i;
+        }
+    }
+
+    return selected;
+}
+
+/* compares `length` bytes (at least 16), 32 at a time (the rest like `filter_equal_sse2()`) [bool] */
+__attribute__((target("avx2")))
+bool filter_equal_avx2(const char* a, const char* b, uint32_t length) {
+    uint32_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+        __m256i equal = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(a + i)), _mm256_loadu_si256((const __m256i*)(b + i)));
+        if ((uint32_t)_mm256_movemask_epi8(equal) != 0xffffffff)
+            return false;
+    }
+    if (i == length)
+        return true;
+    if (length >= 32) {
+        i = length - 32;
+        __m256i equal = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(a + i)), _mm256_loadu_si256((const __m256i*)(b + i)));
+        return (uint32_t)_mm256_movemask_epi8(equal) == 0xffffffff;
+    }
+
+    return filter_equal_sse2(a, b, length);
+}
+
+/* searches the needle in the haystack, 32 positions at a time (the last positions like
+ * `filter_find_sse2()`) [bool] */
+__attribute__((target("avx2")))
+bool filter_find_avx2(const char* haystack, uint32_t length, const char* needle, uint32_t needle_length) {
+    if (needle_length == 0)
+        return true;
+    if (length < needle_length)
+        return false;
+
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[needle_length - 1]);
+    uint32_t i = 0;
+    for (; i + needle_length - 1 + 32 <= length; i += 32) {
+        __m256i first_block = _mm256_loadu_si256((const __m256i*)(haystack + i));
+        __m256i last_block = _mm256_loadu_si256((const __m256i*)(haystack + i + needle_length - 1));
+        uint32_t mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(first, first_block), _mm256_cmpeq_epi8(last, last_block)));
+        while (mask != 0) {
+            uint32_t position = i + __builtin_ctz(mask);
+            if (needle_length <= 2 || memcmp(haystack + position + 1, needle + 1, needle_length - 2) == 0)
+                return true;
+            mask &= mask - 1;
+        }
+    }
+
+    return filter_find_sse2(haystack + i, length - i, needle, needle_length);
+}
+
+/* compares a value that's long enough with the predicate, values of up to 16 bytes like
+ * `filter_match_sse2()` [bool] */
+__attribute__((target("avx2")))
+bool filter_match_avx2(const Predicate* predicate, const char* value, uint32_t length) {
+    uint32_t needle_length = predicate->length;
+    switch (predicate->match) {
+        case (MATCH_EQUAL):
+        case (MATCH_PREFIX):
+            if (needle_length <= 16)
+                return filter_tail_sse2(predicate, value + needle_length);
+            return filter_equal_avx2(value, predicate->value, needle_length);
+        case (MATCH_SUFFIX):
+            if (needle_length <= 16)
+                return filter_tail_sse2(predicate, value + length);
+            return filter_equal_avx2(value + length - needle_length, predicate->value, needle_length);
+        default:
+            /* a value too short for one block of 32 positions is searched 16 positions at a time */
+            if (length < needle_length + 31)
+                return filter_find_sse2(value, length, predicate->value, needle_length);
+            return filter_find_avx2(value, length, predicate->value, needle_length);
+    }
+}
+
+/* selects the rows by length 32 at a time, then compares their values a block at a time [uint32_t] */
+__attribute__((target("avx2")))
+uint32_t filter_values_avx2(const Predicate* predicate, const char** values, const uint8_t* lengths,
+                            uint32_t count, uint16_t* selection) {
+    uint32_t needle_length = predicate->length;
+    const __m256i target = _mm256_set1_epi8((char)needle_length);
+    uint32_t selected = 0;
+
+    for (uint32_t block = 0; block < count; block += 32) {
+        uint32_t mask;
+        if (block + 32 <= count) {
+            __m256i block_lengths = _mm256_loadu_si256((const __m256i*)(lengths + block));
+            __m256i fits = predicate->match == MATCH_EQUAL ? _mm256_cmpeq_epi8(block_lengths, target)
+                                                           : _mm256_cmpeq_epi8(_mm256_max_epu8(block_lengths, target), block_lengths);
+            mask = _mm256_movemask_epi8(fits);
+        } else {
+            mask = 0;
+            for (uint32_t i = block; i < count; i++)
+                if (predicate->match == MATCH_EQUAL ? lengths[i] == needle_length : lengths[i] >= needle_length)
+                    mask |= 1u << (i - block);
+        }
+
+        while (mask != 0) {
+            uint32_t i = block + __builtin_ctz(mask);
+            mask &= mask - 1;
+            if (filter_match_avx2(predicate, values[i], lengths[i]))
+                selection[selected++] = i;
+        }
+    }
+
+    return selected;
+}
+
+#else
+
+/* no SIMD variants on other architectures, they fall back to the scalar variant */
+uint32_t filter_values_sse2(const Predicate* predicate, const char** values, const uint8_t* lengths,
+                            uint32_t count, uint16_t* selection) {
+    return filter_values_scalar(predicate, values, lengths, count, selection);
+}
+
+uint32_t filter_values_avx2(const Predicate* predicate, const char** values, const uint8_t* lengths,
+                            uint32_t count, uint16_t* selection) {
+    return filter_values_scalar(predicate, values, lengths, count, selection);
+}
+
+#endif
+
+
+/* returns the fastest variant the CPU supports [FilterFunction] */
+FilterFunction filter_select() {
+#ifdef FILTER_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return filter_values_avx2;
+    if (__builtin_cpu_supports("sse2"))
+        return filter_values_sse2;
+#endif
+    return filter_values_scalar;
+}
+
+/* selects the variant on the first call [uint32_t] */
+uint32_t filter_values_resolve(const Predicate* predicate, const char** values, const uint8_t* lengths,
+                               uint32_t count, uint16_t* selection) {
+    FilterFunction function = filter_select();
+    __atomic_store_n(&filter_values, function, __ATOMIC_RELAXED);
+    return function(predicate, values, lengths, count, selection);
+}
+
+/* returns the name of a variant, for the benchmark [const char*] */
+const char* filter_name(FilterFunction function) {
+    if (function == filter_values_resolve)
+        function = filter_select();
+    if (function == filter_values_avx2)
+        return "avx2";
+    if (function == filter_values_sse2)
+        return "sse2";
+    return "scalar";
+}
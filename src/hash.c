@@ -0,0 +1,408 @@
+#include "hash.h"
+#include "search.h"
+
+/* mixes the bits of the id (the finalizer of MurmurHash3), so sequential ids are spread
+ * over all buckets and the low bits used by linear hashing are as good as the high ones [uint32_t] */
+uint32_t hash_key(uint32_t key) {
+    key ^= key >> 16;
+    key *= 0x85ebca6b;
+    key ^= key >> 13;
+    key *= 0xc2b2ae35;
+    key ^= key >> 16;
+
+    return key;
+}
+
+
+/* Hash pages --------- */
+
+/* returns a pointer to the round of linear hashing, the buckets use `level` bits of the hash
+ * (or one more if they were split in this round) [uint32_t*] */
+uint32_t* hash_meta_level(void* meta) {
+    return meta + HASH_META_LEVEL_OFFSET;
+}
+
+/* returns a pointer to the split pointer, the next bucket to split [uint32_t*] */
+uint32_t* hash_meta_split(void* meta) {
+    return meta + HASH_META_SPLIT_OFFSET;
+}
+
+/* returns a pointer to the number of buckets [uint32_t*] */
+uint32_t* hash_meta_bucket_count(void* meta) {
+    return meta + HASH_META_BUCKET_COUNT_OFFSET;
+}
+
+/* returns a pointer to the number of directory pages [uint32_t*] */
+uint32_t* hash_meta_directory_count(void* meta) {
+    return meta + HASH_META_DIRECTORY_COUNT_OFFSET;
+}
+
+/* returns a pointer to the bytes used by the cells (slots and records) of all buckets [uint64_t*] */
+uint64_t* hash_meta_used_bytes(void* meta) {
+    return meta + HASH_META_USED_BYTES_OFFSET;
+}
+
+/* returns a pointer to the page number of a directory page [uint32_t*] */
+uint32_t* hash_meta_directory(void* meta, uint32_t directory_number) {
+    return meta + HASH_META_HEADER_SIZE + directory_number * sizeof(uint32_t);
+}
+
+/* returns a pointer to the page number of a bucket in a directory page [uint32_t*] */
+uint32_t* hash_directory_entry(void* directory, uint32_t entry_number) {
+    return directory + HASH_DIRECTORY_HEADER_SIZE + entry_number * sizeof(uint32_t);
+}
+
+/* initializes an empty bucket page (a leaf without the tree around it) [void] */
+void initialize_hash_bucket(void* node) {
+    initialize_leaf_node(node);
+    set_node_type(node, NODE_HASH_BUCKET);
+}
+
+/* returns the bucket of a key [uint32_t] */
+uint32_t hash_bucket_number(void* meta, uint32_t key) {
+    uint32_t hash = hash_key(key);
+    uint32_t level = *hash_meta_level(meta);
+
+    uint32_t bucket_number = hash & ((1u << level) - 1);
+    if (bucket_number < *hash_meta_split(meta))
+        bucket_number = hash & ((2u << level) - 1); // split in this round
+    return bucket_number;
+}
+
+/* returns the page of a bucket (the first page of its chain) of the hash index with the given meta page [uint32_t] */
+uint32_t hash_bucket_page(Pager* pager, uint32_t meta_page_number, uint32_t bucket_number) {
+    void* meta = get_page(pager, meta_page_number);
+    uint32_t directory_page_number = *hash_meta_directory(meta, bucket_number / HASH_DIRECTORY_ENTRIES);
+
+    return *hash_directory_entry(get_page(pager, directory_page_number), bucket_number % HASH_DIRECTORY_ENTRIES);
+}
+
+
+/* Lookups and changes --------- */
+
+/* searches the key in its bucket's pages (their keys are sorted like the keys of a leaf), returns
+ * false if it isn't there, otherwise its page and cell [bool] */
+bool hash_find(Table* table, uint32_t key, uint32_t* page_number, uint32_t* cell_number) {
+    void* meta = get_page(table->pager, table->hash_root_page_number);
+    uint32_t page = hash_bucket_page(table->pager, table->hash_root_page_number, hash_bucket_number(meta, key));
+
+    while (page != 0) {
+        void* node = get_page(table->pager, page);
+        uint32_t num_cells = *leaf_node_num_cells(node);
+        uint32_t cell = key_search(leaf_node_keys(node), num_cells, key);
+        if (cell < num_cells && *leaf_node_key(node, cell) == key) {
+            *page_number = page;
+            *cell_number = cell;
+            return true;
+        }
+        page = *leaf_node_next_leaf(node);
+    }
+
+    return false;
+}
+
+/* reads the row with the given id, returns false if there is none [bool] */
+bool hash_read_row(Table* table, uint32_t key, Row* row) {
+    uint32_t page_number, cell_number;
+    if (!hash_find(table, key, &page_number, &cell_number))
+        return false;
+
+    row->id = key;
+    deserialize_row(leaf_node_value(get_page(table->pager, page_number), cell_number), row);
+    return true;
+}
+
+/* places a cell into the first page of the bucket's chain that has room for it, a new
+ * overflow page is added to the end of the chain if none has [void] */
+void hash_bucket_place(Table* table, uint32_t page_number, uint32_t key, const void* record, uint32_t length) {
+    Pager* pager = table->pager;
+    uint32_t needed = LEAF_NODE_SLOT_SIZE + length;
+
+    void* node = get_page(pager, page_number);
+    while (leaf_node_free_space(node) + *leaf_node_fragmented_bytes(node) < needed) {
+        uint32_t next_page_number = *leaf_node_next_leaf(node);
+        if (next_page_number == 0) {
+            next_page_number = get_unused_page_number(pager);
+            pager_mark_dirty(pager, next_page_number);
+            initialize_hash_bucket(get_page(pager, next_page_number));
+
+            pager_mark_dirty(pager, page_number);
+            *leaf_node_next_leaf(node) = next_page_number;
+        }
+
+        page_number = next_page_number;
+        node = get_page(pager, page_number);
+    }
+
+    pager_mark_dirty(pager, page_number);
+    if (leaf_node_free_space(node) < needed)
+        leaf_node_defragment(node);
+
+    uint32_t cell_number = key_search(leaf_node_keys(node), *leaf_node_num_cells(node), key);
+    leaf_node_place_cell(node, cell_number, key, record, length);
+}
+
+/* adds a row (that isn't in the index) to its bucket, then splits the next bucket if the
+ * buckets are too full [void] */
+void hash_insert(Table* table, Row* row) {
+    uint8_t record[ROW_MAX_SIZE];
+    uint32_t length = serialize_row(row, record);
+
+    void* meta = get_page(table->pager, table->hash_root_page_number);
+    hash_bucket_place(table, hash_bucket_page(table->pager, table->hash_root_page_number, hash_bucket_number(meta, row->id)), row->id, record, length);
+
+    pager_mark_dirty(table->pager, table->hash_root_page_number);
+    *hash_meta_used_bytes(meta) += LEAF_NODE_SLOT_SIZE + length;
+
+    uint64_t capacity = (uint64_t)*hash_meta_bucket_count(meta) * LEAF_NODE_SPACE_FOR_CELLS;
+    if (*hash_meta_used_bytes(meta) * 100 > capacity * HASH_LOAD_FACTOR && *hash_meta_bucket_count(meta) < HASH_MAX_BUCKETS)
+        hash_split(table);
+}
+
+/* removes a row from its bucket, an overflow page that becomes empty is freed [void] */
+void hash_delete(Table* table, uint32_t key) {
+    Pager* pager = table->pager;
+    void* meta = get_page(pager, table->hash_root_page_number);
+    uint32_t page_number = hash_bucket_page(table->pager, table->hash_root_page_number, hash_bucket_number(meta, key));
+    uint32_t previous_page_number = 0;
+
+    while (page_number != 0) {
+        void* node = get_page(pager, page_number);
+        uint32_t num_cells = *leaf_node_num_cells(node);
+        uint32_t cell_number = key_search(leaf_node_keys(node), num_cells, key);
+
+        if (cell_number < num_cells && *leaf_node_key(node, cell_number) == key) {
+            pager_mark_dirty(pager, page_number);
+            pager_mark_dirty(pager, table->hash_root_page_number);
+            *hash_meta_used_bytes(meta) -= LEAF_NODE_SLOT_SIZE + *leaf_node_record_length(node, cell_number);
+            leaf_node_remove_cells(node, cell_number, 1);
+
+            if (num_cells == 1 && previous_page_number != 0) {
+                /* the bucket's first page stays in the directory, even if it's empty */
+                pager_mark_dirty(pager, previous_page_number);
+                *leaf_node_next_leaf(get_page(pager, previous_page_number)) = *leaf_node_next_leaf(node);
+                pager_free_page(pager, page_number);
+            }
+            return;
+        }
+
+        previous_page_number = page_number;
+        page_number = *leaf_node_next_leaf(node);
+    }
+}
+
+/* replaces a row (its record can have another length, so it's removed and added again) [void] */
+void hash_update(Table* table, Row* row) {
+    hash_delete(table, row->id);
+    hash_insert(table, row);
+}
+
+/* adds a new empty bucket after the last one of the hash index with the given meta page (and a new
+ * directory page if the last one is full), returns its page [uint32_t] */
+uint32_t hash_add_bucket(Pager* pager, uint32_t meta_page_number) {
+    void* meta = get_page(pager, meta_page_number);
+    pager_mark_dirty(pager, meta_page_number);
+
+    uint32_t bucket_number = *hash_meta_bucket_count(meta);
+    uint32_t directory_number = bucket_number / HASH_DIRECTORY_ENTRIES;
+    if (directory_number == *hash_meta_directory_count(meta)) {
+        uint32_t directory_page_number = get_unused_page_number(pager);
+        void* directory = get_page(pager, directory_page_number);
+        pager_mark_dirty(pager, directory_page_number);
+        set_node_type(directory, NODE_HASH_DIRECTORY);
+        set_node_root(directory, false);
+
+        *hash_meta_directory(meta, directory_number) = directory_page_number;
+        *hash_meta_directory_count(meta) = directory_number + 1;
+    }
+
+    uint32_t page_number = get_unused_page_number(pager);
+    pager_mark_dirty(pager, page_number);
+    initialize_hash_bucket(get_page(pager, page_number));
+
+    uint32_t directory_page_number = *hash_meta_directory(meta, directory_number);
+    pager_mark_dirty(pager, directory_page_number);
+    *hash_directory_entry(get_page(pager, directory_page_number), bucket_number % HASH_DIRECTORY_ENTRIES) = page_number;
+    *hash_meta_bucket_count(meta) = bucket_number + 1;
+
+    return page_number;
+}
+
+/* splits the bucket at the split pointer: its rows are divided between it and a new last bucket
+ * by the next bit of their hash, and its overflow pages are freed (the rows of both buckets
+ * are placed again from a copy of the chain) [void] */
+void hash_split(Table* table) {
+    Pager* pager = table->pager;
+    void* meta = get_page(pager, table->hash_root_page_number);
+    uint32_t level = *hash_meta_level(meta);
+    uint32_t bucket_number = *hash_meta_split(meta);
+    uint32_t page_number = hash_bucket_page(pager, table->hash_root_page_number, bucket_number);
+    uint32_t new_page_number = hash_add_bucket(pager, table->hash_root_page_number);
+
+    uint32_t chain_length = 0;
+    uint8_t* chain = NULL;
+    for (uint32_t page = page_number; page != 0; page = *leaf_node_next_leaf(chain + (size_t)(chain_length - 1) * PAGE_SIZE)) {
+        chain = realloc(chain, (size_t)(chain_length + 1) * PAGE_SIZE);
+        memcpy(chain + (size_t)chain_length * PAGE_SIZE, get_page(pager, page), PAGE_SIZE);
+        chain_length++;
+    }
+
+    pager_mark_dirty(pager, page_number);
+    initialize_hash_bucket(get_page(pager, page_number));
+    for (uint32_t i = 0; i + 1 < chain_length; i++)
+        pager_free_page(pager, *leaf_node_next_leaf(chain + (size_t)i * PAGE_SIZE));
+
+    if (++*hash_meta_split(meta) == 1u << level) {
+        /* every bucket of the round was split, the next round splits them again from the first one */
+        *hash_meta_level(meta) = level + 1;
+        *hash_meta_split(meta) = 0;
+    }
+
+    for (uint32_t i = 0; i < chain_length; i++) {
+        void* node = chain + (size_t)i * PAGE_SIZE;
+        uint32_t num_cells = *leaf_node_num_cells(node);
+        for (uint32_t cell = 0; cell < num_cells; cell++) {
+            uint32_t key = *leaf_node_key(node, cell);
+            uint32_t target = (hash_key(key) & ((2u << level) - 1)) == bucket_number ? page_number : new_page_number;
+            hash_bucket_place(table, target, key, leaf_node_value(node, cell), *leaf_node_record_length(node, cell));
+        }
+    }
+
+    free(chain);
+}
+
+
+/* Building and dropping --------- */
+
+/* creates the hash index and adds every row of the table to it, returns the number of rows.
+ * All buckets the rows need are created up front (from the space used by the table's leaves),
+ * so the build doesn't split buckets. The rows are added in passes over the table's leaves, every
+ * pass copies the rows of the next quarter of the buffer pool's frames of buckets and places them, and is
+ * committed at once, so every bucket page is logged once (adding the rows in the table's order
+ * would change random buckets, and every commit would log most of them again) [uint32_t] */
+uint32_t hash_create(Table* table) {
+    Pager* pager = table->pager;
+
+    Cursor cursor;
+    table_start(table, &cursor);
+    uint32_t first_leaf = cursor.page_number;
+    cursor_close(&cursor);
+
+    uint64_t used_bytes = 0;
+    for (uint32_t page_number = first_leaf; page_number != 0;) {
+        void* node = get_page(pager, page_number);
+        used_bytes += leaf_node_used_space(node);
+        page_number = *leaf_node_next_leaf(node);
+        pager_release(pager);
+    }
+
+    uint64_t bucket_count = used_bytes * 100 / ((uint64_t)LEAF_NODE_SPACE_FOR_CELLS * HASH_LOAD_FACTOR) + 1;
+    if (bucket_count > HASH_MAX_BUCKETS)
+        bucket_count = HASH_MAX_BUCKETS;
+    uint32_t level = 0;
+    while ((2ull << level) <= bucket_count)
+        level++;
+
+    uint32_t meta_page_number = get_unused_page_number(pager);
+    void* meta = get_page(pager, meta_page_number);
+    pager_mark_dirty(pager, meta_page_number);
+    set_node_type(meta, NODE_HASH_META);
+    set_node_root(meta, true);
+    *hash_meta_level(meta) = level;
+    *hash_meta_split(meta) = bucket_count - (1u << level);
+    *hash_meta_bucket_count(meta) = 0;
+    *hash_meta_directory_count(meta) = 0;
+    *hash_meta_used_bytes(meta) = used_bytes;
+
+    /* the index becomes the table's hash index after its last bucket is written, and the commits of the
+     * build keep the header's root (`db_commit_build()`), so an interrupted build leaves no index */
+    for (uint32_t b = 0; b < bucket_count; b++) {
+        hash_add_bucket(pager, meta_page_number);
+        if ((b + 1) % HASH_BUILD_COMMIT_INTERVAL == 0) {
+            db_commit_build(table);
+            pager_release(pager);
+        }
+    }
+    db_commit_build(table);
+    pager_release(pager);
+
+    uint32_t pass_buckets = pager->max_frames / 4 > HASH_BUILD_COMMIT_INTERVAL ? pager->max_frames / 4 : HASH_BUILD_COMMIT_INTERVAL;
+    uint8_t* cells = NULL; // key, record length (uint16_t) and record of every row of the pass
+    size_t cells_capacity = 0;
+    uint32_t count = 0;
+
+    for (uint32_t first = 0; first < bucket_count; first += pass_buckets) {
+        size_t cells_size = 0;
+
+        for (uint32_t page_number = first_leaf; page_number != 0;) {
+            void* node = get_page(pager, page_number);
+            meta = get_page(pager, meta_page_number);
+
+            uint32_t num_cells = *leaf_node_num_cells(node);
+            for (uint32_t i = 0; i < num_cells; i++) {
+                uint32_t key = *leaf_node_key(node, i);
+                uint32_t bucket_number = hash_bucket_number(meta, key);
+                if (bucket_number < first || bucket_number - first >= pass_buckets)
+                    continue;
+
+                uint16_t length = *leaf_node_record_length(node, i);
+                if (cells_size + sizeof(uint32_t) + sizeof(uint16_t) + length > cells_capacity) {
+                    cells_capacity = cells_capacity == 0 ? PAGE_SIZE * 64 : cells_capacity * 2;
+                    cells = realloc(cells, cells_capacity);
+                }
+                memcpy(cells + cells_size, &key, sizeof(uint32_t));
+                memcpy(cells + cells_size + sizeof(uint32_t), &length, sizeof(uint16_t));
+                memcpy(cells + cells_size + sizeof(uint32_t) + sizeof(uint16_t), leaf_node_value(node, i), length);
+                cells_size += sizeof(uint32_t) + sizeof(uint16_t) + length;
+            }
+
+            page_number = *leaf_node_next_leaf(node);
+            pager_release(pager); // nothing was changed since the last commit
+        }
+
+        meta = get_page(pager, meta_page_number);
+        for (size_t offset = 0; offset < cells_size;) {
+            uint32_t key;
+            uint16_t length;
+            memcpy(&key, cells + offset, sizeof(uint32_t));
+            memcpy(&length, cells + offset + sizeof(uint32_t), sizeof(uint16_t));
+            hash_bucket_place(table, hash_bucket_page(pager, meta_page_number, hash_bucket_number(meta, key)), key,
+                              cells + offset + sizeof(uint32_t) + sizeof(uint16_t), length);
+            offset += sizeof(uint32_t) + sizeof(uint16_t) + length;
+            count++;
+        }
+
+        db_commit_build(table);
+        pager_release(pager);
+    }
+
+    free(cells);
+    table->hash_root_page_number = meta_page_number;
+    return count;
+}
+
+/* puts all pages of a hash index (buckets with their overflow pages, directory pages and the meta page)
+ * on the free list [void] */
+void hash_free_pages(Table* table, uint32_t meta_page_number) {
+    Pager* pager = table->pager;
+    void* meta = get_page(pager, meta_page_number);
+    uint32_t bucket_count = *hash_meta_bucket_count(meta);
+    uint32_t directory_count = *hash_meta_directory_count(meta);
+
+    for (uint32_t d = 0; d < directory_count; d++) {
+        uint32_t directory_page_number = *hash_meta_directory(get_page(pager, meta_page_number), d);
+        uint32_t entries = d + 1 < directory_count ? HASH_DIRECTORY_ENTRIES : bucket_count - d * HASH_DIRECTORY_ENTRIES;
+
+        for (uint32_t e = 0; e < entries; e++) {
+            uint32_t page_number = *hash_directory_entry(get_page(pager, directory_page_number), e);
+            while (page_number != 0) {
+                uint32_t next_page_number = *leaf_node_next_leaf(get_page(pager, page_number));
+                pager_free_page(pager, page_number);
+                page_number = next_page_number;
+            }
+        }
+        pager_free_page(pager, directory_page_number);
+    }
+
+    pager_free_page(pager, meta_page_number);
+}
@@ -0,0 +1,474 @@
+#include "import.h"
+#include "btree.h"
+#include "index.h"
+
+/* loads the rows of a CSV file (`id,username,email` per line) into the table,
+ * an empty table is built bottom-up from the sorted rows, otherwise the sorted rows are
+ * inserted one by one, rows with an id that's already in the table (or the file) are skipped [void] */
+void import_csv(Table* table, const char* filename, uint32_t fill_factor) {
+    CsvReader reader;
+    Row row;
+    int result;
+
+    /* first pass only validates the file and checks if the ids are already sorted */
+    if (!csv_open(&reader, filename))
+        return;
+
+    bool sorted = true;
+    uint64_t count = 0;
+    uint32_t previous_id = 0;
+    while ((result = csv_next_row(&reader, &row)) == 1) {
+        if (count > 0 && row.id <= previous_id)
+            sorted = false;
+        previous_id = row.id;
+        count++;
+    }
+    csv_close(&reader);
+    if (result < 0)
+        return;
+
+    void* root = get_page(table->pager, table->root_page_number);
+    TreeBuilder builder;
+    builder_init(&builder, table, fill_factor);
+    builder.bulk = get_node_type(root) == NODE_LEAF && *leaf_node_num_cells(root) == 0;
+
+    void* cell = malloc(IMPORT_CELL_SIZE);
+    csv_open(&reader, filename);
+
+    if (sorted) {
+        /* rows go straight from the file into the tree */
+        while (csv_next_row(&reader, &row) == 1) {
+            *(uint32_t*)cell = row.id;
+            serialize_row(&row, cell + LEAF_NODE_KEY_SIZE);
+            import_row(&builder, cell);
+        }
+    } else {
+        /* external merge sort, sorted runs of `IMPORT_SORT_MEMORY` are written to temporary
+         * files and merged, a file that fits into a single run is sorted in memory */
+        uint32_t run_rows = IMPORT_SORT_MEMORY / IMPORT_CELL_SIZE;
+        if (count < run_rows)
+            run_rows = count;
+
+        void* cells = malloc((size_t)run_rows * IMPORT_CELL_SIZE);
+        FILE** run_files = NULL;
+        uint32_t run_count = 0;
+        uint32_t buffered = 0;
+
+        while (csv_next_row(&reader, &row) == 1) {
+            void* destination = cells + (size_t)buffered * IMPORT_CELL_SIZE;
+            *(uint32_t*)destination = row.id;
+            serialize_row(&row, destination + LEAF_NODE_KEY_SIZE);
+
+            if (++buffered == run_rows && count > run_rows) {
+                run_files = realloc(run_files, (run_count + 1) * sizeof(FILE*));
+                run_files[run_count++] = import_write_run(cells, buffered);
+                buffered = 0;
+            }
+        }
+
+        if (run_count == 0) {
+            qsort(cells, buffered, IMPORT_CELL_SIZE, compare_cells);
+            for (uint32_t i = 0; i < buffered; i++)
+                import_row(&builder, cells + (size_t)i * IMPORT_CELL_SIZE);
+        } else {
+            if (buffered > 0) {
+                run_files = realloc(run_files, (run_count + 1) * sizeof(FILE*));
+                run_files[run_count++] = import_write_run(cells, buffered);
+            }
+            import_merge_runs(&builder, run_files, run_count);
+        }
+
+        free(run_files);
+        free(cells);
+    }
+
+    csv_close(&reader);
+    free(cell);
+
+    uint32_t empty_root = table->root_page_number;
+    if (builder.bulk)
+        builder_finish(&builder);
+
+    /* the built tree has no index entries yet (rows inserted one by one are added to the
+     * indexes right away), the indexes are built again from the whole table */
+    if (builder.bulk && builder.rows > 0 && index_exists(table))
+        index_rebuild_all(table);
+
+    /* the header still has the empty root (the commits of the index builds don't change it),
+     * it's freed together with the commit of the new one */
+    if (table->root_page_number != empty_root)
+        pager_free_page(table->pager, empty_root);
+
+    /* the import is complete, the header is written with the rest of the last commit */
+    db_commit(table);
+    pager_release(table->pager);
+
+    printf("Imported %llu rows.\n", (unsigned long long)builder.rows);
+    if (builder.duplicates > 0)
+        printf("Skipped %llu rows with an id that already exists.\n", (unsigned long long)builder.duplicates);
+}
+
+/* adds the next row (import cell) in key order to the table, skips duplicate ids [void] */
+void import_row(TreeBuilder* builder, void* cell) {
+    uint32_t key = *(uint32_t*)cell;
+    if (builder->has_last_key && key == builder->last_key) {
+        builder->duplicates++;
+        return;
+    }
+    builder->has_last_key = true;
+    builder->last_key = key;
+
+    if (builder->bulk) {
+        builder_add_cell(builder, cell);
+        return;
+    }
+
+    if (!import_insert_cell(builder->table, cell)) {
+        builder->duplicates++;
+        return;
+    }
+    builder->rows++;
+
+    if (++builder->since_commit >= IMPORT_COMMIT_INTERVAL) {
+        db_commit(builder->table);
+        pager_release(builder->table->pager);
+        builder->since_commit = 0;
+    }
+}
+
+
+/* CSV READING */
+
+/* opens the CSV file, prints an error if it can't be opened [bool] */
+bool csv_open(CsvReader* reader, const char* filename) {
+    reader->file = fopen(filename, "r");
+    reader->line = NULL;
+    reader->line_capacity = 0;
+    reader->line_number = 0;
+
+    if (reader->file == NULL) {
+        printf("Could not open '%s'.\n", filename);
+        return false;
+    }
+    return true;
+}
+
+/* reads the next `id,username,email` line into the row, empty lines and a header line
+ * are skipped (quoting isn't supported, values can't contain commas),
+ * returns 1 if a row was read, 0 at the end of the file and -1 on an invalid line [int] */
+int csv_next_row(CsvReader* reader, Row* row) {
+    ssize_t length;
+    while ((length = getline(&reader->line, &reader->line_capacity, reader->file)) != -1) {
+        reader->line_number++;
+
+        /* stripping the line ending */
+        while (length > 0 && (reader->line[length-1] == '\n' || reader->line[length-1] == '\r'))
+            reader->line[--length] = 0;
+        if (length == 0)
+            continue;
+
+        char* id_string = reader->line;
+        char* username = strchr(id_string, ',');
+        char* email = username == NULL ? NULL : strchr(username + 1, ',');
+        if (username == NULL || email == NULL || strchr(email + 1, ',') != NULL) {
+            printf("Import error on line %u: expected `id,username,email`.\n", reader->line_number);
+            return -1;
+        }
+        *username++ = 0;
+        *email++ = 0;
+
+        char* end;
+        unsigned long id = strtoul(id_string, &end, 10);
+        if (*id_string < '0' || *id_string > '9' || *end != 0 || id > INT32_MAX) {
+            /* the first line can be a header with the column names */
+            if (reader->line_number == 1)
+                continue;
+            printf("Import error on line %u: invalid id '%s'.\n", reader->line_number, id_string);
+            return -1;
+        }
+
+        if (*username == 0 || *email == 0) {
+            printf("Import error on line %u: expected `id,username,email`.\n", reader->line_number);
+            return -1;
+        }
+        if (strlen(username) > COLUMN_USERNAME_SIZE || strlen(email) > COLUMN_EMAIL_SIZE) {
+            printf("Import error on line %u: string is too long.\n", reader->line_number);
+            return -1;
+        }
+
+        row->id = (uint32_t)id;
+        strcpy(row->username, username);
+        strcpy(row->email, email);
+        return 1;
+    }
+
+    return 0;
+}
+
+/* closes the CSV file [void] */
+void csv_close(CsvReader* reader) {
+    fclose(reader->file);
+    free(reader->line);
+}
+
+
+/* EXTERNAL MERGE SORT */
+
+/* compares two import cells by their key (for `qsort()`) [int] */
+int compare_cells(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a;
+    uint32_t y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+/* sorts the cells and writes them into a temporary file (a run) [FILE*] */
+FILE* import_write_run(void* cells, uint32_t count) {
+    qsort(cells, count, IMPORT_CELL_SIZE, compare_cells);
+
+    FILE* file = tmpfile();
+    if (file == NULL || fwrite(cells, IMPORT_CELL_SIZE, count, file) != count) {
+        printf("Error writing a temporary file for the import: %d\n", errno);
+        exit(EXIT_FAILURE);
+    }
+    rewind(file);
+
+    return file;
+}
+
+/* reads the next cells of the run into its buffer, returns false when the run is exhausted [bool] */
+bool import_run_load(ImportRun* run) {
+    run->count = fread(run->cells, IMPORT_CELL_SIZE, IMPORT_RUN_BUFFER_ROWS, run->file);
+    run->position = 0;
+    return run->count > 0;
+}
+
+/* returns the key of the run's current cell [uint32_t] */
+uint32_t import_run_key(ImportRun* run) {
+    return *(uint32_t*)(run->cells + (size_t)run->position * IMPORT_CELL_SIZE);
+}
+
+/* restores the min-heap (of run indexes, ordered by the runs' current keys) below `index` [void] */
+void import_heap_down(ImportRun* runs, uint32_t* heap, uint32_t size, uint32_t index) {
+    while (true) {
+        uint32_t smallest = index;
+        uint32_t left = 2 * index + 1;
+        uint32_t right = left + 1;
+        if (left < size && import_run_key(&runs[heap[left]]) < import_run_key(&runs[heap[smallest]]))
+            smallest = left;
+        if (right < size && import_run_key(&runs[heap[right]]) < import_run_key(&runs[heap[smallest]]))
+            smallest = right;
+        if (smallest == index)
+            return;
+
+        uint32_t swap = heap[index];
+        heap[index] = heap[smallest];
+        heap[smallest] = swap;
+        index = smallest;
+    }
+}
+
+/* k-way merge of the sorted runs, the rows are passed to the builder in key order,
+ * closes the run files [void] */
+void import_merge_runs(TreeBuilder* builder, FILE** run_files, uint32_t run_count) {
+    ImportRun* runs = malloc(run_count * sizeof(ImportRun));
+    uint32_t* heap = malloc(run_count * sizeof(uint32_t));
+    uint32_t size = 0;
+
+    for (uint32_t i = 0; i < run_count; i++) {
+        runs[i].file = run_files[i];
+        runs[i].cells = malloc((size_t)IMPORT_RUN_BUFFER_ROWS * IMPORT_CELL_SIZE);
+        if (import_run_load(&runs[i]))
+            heap[size++] = i;
+    }
+    for (uint32_t i = size / 2; i-- > 0; )
+        import_heap_down(runs, heap, size, i);
+
+    while (size > 0) {
+        ImportRun* run = &runs[heap[0]];
+        import_row(builder, run->cells + (size_t)run->position * IMPORT_CELL_SIZE);
+
+        if (++run->position == run->count && !import_run_load(run))
+            heap[0] = heap[--size]; // the run is exhausted
+        import_heap_down(runs, heap, size, 0);
+    }
+
+    for (uint32_t i = 0; i < run_count; i++) {
+        fclose(runs[i].file);
+        free(runs[i].cells);
+    }
+    free(runs);
+    free(heap);
+}
+
+
+/* BOTTOM-UP TREE BUILDING */
+
+/* initializes the builder, the fill factor is the percentage of the node capacity
+ * that gets used (100 == packed nodes) [void] */
+void builder_init(TreeBuilder* builder, Table* table, uint32_t fill_factor) {
+    memset(builder, 0, sizeof(TreeBuilder));
+    builder->table = table;
+
+    builder->leaf_fill = LEAF_NODE_SPACE_FOR_CELLS * fill_factor / 100;
+    builder->internal_fill = (INTERNAL_NODE_MAX_CELLS + 1) * fill_factor / 100;
+    if (builder->internal_fill < 2)
+        builder->internal_fill = 2;
+}
+
+/* adds the next cell (in key order) to the open leaf, the leaf is written out
+ * once it's full and another cell arrives [void] */
+void builder_add_cell(TreeBuilder* builder, void* cell) {
+    BuildLevel* leaf = &builder->levels[0];
+
+    if (builder->height == 0) {
+        leaf->node = malloc(PAGE_SIZE);
+        memset(leaf->node, 0, PAGE_SIZE);
+        initialize_leaf_node(leaf->node);
+        leaf->count = 0;
+        leaf->rows = 0;
+        builder->height = 1;
+    }
+
+    void* record = cell + LEAF_NODE_KEY_SIZE;
+    uint32_t length = serialized_row_size(record);
+    uint32_t size = LEAF_NODE_SLOT_SIZE + length;
+    if (leaf->count > 0 && (leaf_node_used_space(leaf->node) + size > builder->leaf_fill ||
+                            leaf_node_free_space(leaf->node) < size))
+        builder_write_node(builder, 0);
+
+    leaf_node_place_cell(leaf->node, leaf->count, *(uint32_t*)cell, record, length);
+    leaf->count++;
+    leaf->rows++;
+    leaf->max_key = *(uint32_t*)cell;
+    builder->rows++;
+}
+
+/* adds a written node (in key order) as the next child of the open internal node at the given
+ * level, the internal node is written out once it's full and another child arrives [void] */
+void builder_add_child(TreeBuilder* builder, uint32_t level, uint32_t page_number, uint32_t max_key, uint32_t rows) {
+    if (level > BTREE_MAX_DEPTH) {
+        printf("Tree is deeper than %d levels.\n", BTREE_MAX_DEPTH);
+        exit(EXIT_FAILURE);
+    }
+
+    BuildLevel* internal = &builder->levels[level];
+
+    if (level == builder->height) {
+        internal->node = malloc(PAGE_SIZE);
+        memset(internal->node, 0, PAGE_SIZE);
+        initialize_internal_node(internal->node);
+        internal->count = 0;
+        internal->rows = 0;
+        builder->height++;
+    } else if (internal->count == builder->internal_fill) {
+        builder_write_node(builder, level);
+    }
+
+    if (internal->count > 0) {
+        /* the previous right child gets a cell with its key */
+        uint32_t num_keys = *internal_node_num_keys(internal->node);
+        *internal_node_num_keys(internal->node) = num_keys + 1;
+        *internal_node_child(internal->node, num_keys) = *internal_node_right_child(internal->node);
+        *internal_node_key(internal->node, num_keys) = internal->max_key;
+        internal_node_rows(internal->node)[num_keys] = *internal_node_right_child_rows(internal->node);
+    }
+
+    *internal_node_right_child(internal->node) = page_number;
+    *internal_node_right_child_rows(internal->node) = rows;
+    internal->max_key = max_key;
+    internal->rows += rows;
+    internal->count++;
+}
+
+/* writes the open node of the given level into a new page and adds it to the level above [void] */
+void builder_write_node(TreeBuilder* builder, uint32_t level) {
+    Pager* pager = builder->table->pager;
+    BuildLevel* open = &builder->levels[level];
+
+    uint32_t page_number = get_unused_page_number(pager);
+    void* page = get_page(pager, page_number);
+    pager_mark_dirty(pager, page_number);
+    memcpy(page, open->node, PAGE_SIZE);
+
+    if (level == 0) {
+        /* linking the leaves (the previous leaf didn't know the page of this one) */
+        if (builder->previous_leaf != 0) {
+            void* previous = get_page(pager, builder->previous_leaf);
+            pager_mark_dirty(pager, builder->previous_leaf);
+            *leaf_node_next_leaf(previous) = page_number;
+        }
+        builder->previous_leaf = page_number;
+        initialize_leaf_node(open->node);
+    } else {
+        initialize_internal_node(open->node);
+    }
+    uint32_t rows = open->rows;
+    open->count = 0;
+    open->rows = 0;
+
+    builder_add_child(builder, level + 1, page_number, open->max_key, rows);
+
+    if (++builder->since_commit >= IMPORT_COMMIT_INTERVAL) {
+        /* the header keeps the empty root until the import is finished, so the table stays
+         * empty if the import is interrupted */
+        db_commit_build(builder->table);
+        pager_release(pager);
+        builder->since_commit = 0;
+    }
+}
+
+/* writes out the open nodes of all levels, the open node of the top level becomes the root [void] */
+void builder_finish(TreeBuilder* builder) {
+    if (builder->height == 0)
+        return;
+
+    Table* table = builder->table;
+
+    /* every open node has at least one cell/child, so the top level ends up with at least two children */
+    for (uint32_t level = 0; level + 1 < builder->height; level++)
+        builder_write_node(builder, level);
+
+    /* the indexes are built again after the tree, and their builds commit before the header is written,
+     * so then the empty root stays as it is (the header has it until the end) and the tree gets a new
+     * root page, the caller frees the empty one */
+    uint32_t top = builder->height - 1;
+    uint32_t root_page_number = index_exists(table) ? get_unused_page_number(table->pager) : table->root_page_number;
+    void* root = get_page(table->pager, root_page_number);
+    pager_mark_dirty(table->pager, root_page_number);
+    memcpy(root, builder->levels[top].node, PAGE_SIZE);
+    set_node_root(root, true);
+
+    table->root_page_number = root_page_number;
+    table->internal_node_layers = top;
+    table->row_count += builder->rows;
+    table_clear_hint(table);
+
+    for (uint32_t level = 0; level < builder->height; level++)
+        free(builder->levels[level].node);
+}
+
+
+/* ROW BY ROW LOADING */
+
+/* inserts the cell into a table that isn't empty, returns false if the id already exists [bool] */
+bool import_insert_cell(Table* table, void* cell) {
+    uint32_t key = *(uint32_t*)cell;
+    Cursor cursor;
+    table_find(table, key, &cursor);
+
+    void* node = get_page(table->pager, cursor.page_number);
+    if (cursor.cell_number < *leaf_node_num_cells(node) && *leaf_node_key(node, cursor.cell_number) == key) {
+        cursor_close(&cursor);
+        return false;
+    }
+
+    Row row;
+    row.id = key;
+    deserialize_row(cell + LEAF_NODE_KEY_SIZE, &row);
+    leaf_node_insert(&cursor, key, &row);
+    table->row_count++;
+    cursor_close(&cursor);
+
+    index_insert_row(table, &row);
+    return true;
+}
@@ -0,0 +1,562 @@
+#include "index.h"
+#include "hash.h"
+
+/* Index entries --------- */
+
+/* name of an index column, as used by the statements [const char*] */
+const char* index_column_name(IndexColumn column) {
+    return column == INDEX_USERNAME ? "username" : "email";
+}
+
+/* returns the value of the indexed column of a row [char*] */
+char* index_row_value(Row* row, IndexColumn column) {
+    return column == INDEX_USERNAME ? row->username : row->email;
+}
+
+/* fills an entry with the prefix of the value (zero padded) and the id [void] */
+void index_entry_make(IndexEntry* entry, const char* value, uint32_t id) {
+    strncpy(entry->prefix, value, INDEX_PREFIX_SIZE);
+    entry->id = id;
+}
+
+/* orders entries by the prefix (bytewise, the zero padding makes a shorter value smaller)
+ * and then by the id, also used by `qsort()` when building an index [int] */
+int index_entry_compare(const void* a, const void* b) {
+    const IndexEntry* first = a;
+    const IndexEntry* second = b;
+
+    int result = memcmp(first->prefix, second->prefix, INDEX_PREFIX_SIZE);
+    if (result != 0)
+        return result;
+    if (first->id != second->id)
+        return first->id < second->id ? -1 : 1;
+    return 0;
+}
+
+/* checks if the entry's prefix is the prefix of `value`, the rows of the value can only
+ * be found in the entries it matches [bool] */
+bool index_entry_matches(IndexEntry* entry, const char* value) {
+    IndexEntry searched;
+    index_entry_make(&searched, value, 0);
+
+    return memcmp(entry->prefix, searched.prefix, INDEX_PREFIX_SIZE) == 0;
+}
+
+
+/* Index nodes --------- */
+
+/* returns a pointer to the number of entries of an index leaf [uint32_t*] */
+uint32_t* index_leaf_num_cells(void* node) {
+    return node + INDEX_LEAF_NUM_CELLS_OFFSET;
+}
+
+/* returns a pointer to the next index leaf (0 == none) [uint32_t*] */
+uint32_t* index_leaf_next_leaf(void* node) {
+    return node + INDEX_LEAF_NEXT_LEAF_OFFSET;
+}
+
+/* returns a pointer to an entry of an index leaf [IndexEntry*] */
+IndexEntry* index_leaf_entry(void* node, uint32_t cell_number) {
+    return node + INDEX_LEAF_HEADER_SIZE + cell_number * INDEX_ENTRY_SIZE;
+}
+
+/* initializes an empty index leaf [void] */
+void initialize_index_leaf(void* node) {
+    set_node_type(node, NODE_INDEX_LEAF);
+    set_node_root(node, false);
+    *index_leaf_num_cells(node) = 0;
+    *index_leaf_next_leaf(node) = 0;
+}
+
+/* returns the first cell of the leaf with an entry that isn't smaller than `entry` [uint32_t] */
+uint32_t index_leaf_find(void* node, IndexEntry* entry) {
+    uint32_t min_index = 0;
+    uint32_t max_index = *index_leaf_num_cells(node);
+    while (min_index != max_index) {
+        uint32_t index = (min_index + max_index) / 2;
+        if (index_entry_compare(index_leaf_entry(node, index), entry) >= 0)
+            max_index = index;
+        else
+            min_index = index + 1;
+    }
+
+    return min_index;
+}
+
+/* returns a pointer to the number of keys of an index internal node [uint32_t*] */
+uint32_t* index_internal_num_keys(void* node) {
+    return node + INDEX_INTERNAL_NUM_KEYS_OFFSET;
+}
+
+/* returns a pointer to the right child of an index internal node [uint32_t*] */
+uint32_t* index_internal_right_child(void* node) {
+    return node + INDEX_INTERNAL_RIGHT_CHILD_OFFSET;
+}
+
+/* returns a pointer to a key (max entry of the child with the same number) [IndexEntry*] */
+IndexEntry* index_internal_key(void* node, uint32_t key_number) {
+    return node + INDEX_INTERNAL_HEADER_SIZE + key_number * INDEX_ENTRY_SIZE;
+}
+
+/* returns a pointer to the array of children (without the right child) [uint32_t*] */
+uint32_t* index_internal_children(void* node) {
+    return node + INDEX_INTERNAL_CHILDREN_OFFSET;
+}
+
+/* returns a pointer to a child, `num_keys` is the right child [uint32_t*] */
+uint32_t* index_internal_child(void* node, uint32_t child_number) {
+    if (child_number == *index_internal_num_keys(node))
+        return index_internal_right_child(node);
+    return index_internal_children(node) + child_number;
+}
+
+/* initializes an empty index internal node [void] */
+void initialize_index_internal(void* node) {
+    set_node_type(node, NODE_INDEX_INTERNAL);
+    set_node_root(node, false);
+    *index_internal_num_keys(node) = 0;
+    *index_internal_right_child(node) = 0;
+}
+
+/* returns the number of the child that contains `entry` (the first one with a key that isn't smaller) [uint32_t] */
+uint32_t index_internal_find_child(void* node, IndexEntry* entry) {
+    uint32_t min_index = 0;
+    uint32_t max_index = *index_internal_num_keys(node);
+    while (min_index != max_index) {
+        uint32_t index = (min_index + max_index) / 2;
+        if (index_entry_compare(index_internal_key(node, index), entry) >= 0)
+            max_index = index;
+        else
+            min_index = index + 1;
+    }
+
+    return min_index;
+}
+
+
+/* Index maintenance --------- */
+
+/* finds the leaf that contains `entry` (or where it would be inserted), `path` is filled with
+ * the internal nodes from the root down to the leaf's parent [uint32_t] */
+uint32_t index_find_leaf(Table* table, IndexColumn column, IndexEntry* entry, uint32_t* path, uint32_t* depth) {
+    uint32_t page_number = table->index_root_page_numbers[column];
+    void* node = get_page(table->pager, page_number);
+
+    *depth = 0;
+    while (get_node_type(node) == NODE_INDEX_INTERNAL) {
+        if (*depth == BTREE_MAX_DEPTH) {
+            printf("Index is deeper than %d levels.\n", BTREE_MAX_DEPTH);
+            exit(EXIT_FAILURE);
+        }
+        path[(*depth)++] = page_number;
+        page_number = *index_internal_child(node, index_internal_find_child(node, entry));
+        node = get_page(table->pager, page_number);
+    }
+
+    return page_number;
+}
+
+/* adds the row's entry to the column's index, a full leaf is split in half and the
+ * new leaf is added to the parent [void] */
+void index_insert(Table* table, IndexColumn column, Row* row) {
+    Pager* pager = table->pager;
+    IndexEntry entry;
+    index_entry_make(&entry, index_row_value(row, column), row->id);
+
+    uint32_t path[BTREE_MAX_DEPTH];
+    uint32_t depth;
+    uint32_t page_number = index_find_leaf(table, column, &entry, path, &depth);
+    void* node = get_page(pager, page_number);
+    pager_mark_dirty(pager, page_number);
+
+    uint32_t num_cells = *index_leaf_num_cells(node);
+    uint32_t cell_number = index_leaf_find(node, &entry);
+    if (num_cells < INDEX_LEAF_MAX_CELLS) {
+        memmove(index_leaf_entry(node, cell_number + 1), index_leaf_entry(node, cell_number),
+                (num_cells - cell_number) * INDEX_ENTRY_SIZE);
+        *index_leaf_entry(node, cell_number) = entry;
+        *index_leaf_num_cells(node) = num_cells + 1;
+        return;
+    }
+
+    IndexEntry entries[INDEX_LEAF_MAX_CELLS + 1];
+    memcpy(entries, index_leaf_entry(node, 0), cell_number * INDEX_ENTRY_SIZE);
+    entries[cell_number] = entry;
+    memcpy(entries + cell_number + 1, index_leaf_entry(node, cell_number), (num_cells - cell_number) * INDEX_ENTRY_SIZE);
+
+    uint32_t new_page_number = get_unused_page_number(pager);
+    void* new_node = get_page(pager, new_page_number);
+    pager_mark_dirty(pager, new_page_number);
+    initialize_index_leaf(new_node);
+
+    uint32_t left_count = (INDEX_LEAF_MAX_CELLS + 1) / 2;
+    uint32_t right_count = INDEX_LEAF_MAX_CELLS + 1 - left_count;
+    memcpy(index_leaf_entry(node, 0), entries, left_count * INDEX_ENTRY_SIZE);
+    memcpy(index_leaf_entry(new_node, 0), entries + left_count, right_count * INDEX_ENTRY_SIZE);
+    *index_leaf_num_cells(node) = left_count;
+    *index_leaf_num_cells(new_node) = right_count;
+    *index_leaf_next_leaf(new_node) = *index_leaf_next_leaf(node);
+    *index_leaf_next_leaf(node) = new_page_number;
+
+    index_internal_insert(table, column, path, depth, page_number, &entries[left_count - 1], new_page_number);
+}
+
+/* adds the node `right_page_number` right after its left half `left_page_number` (whose max entry is
+ * `separator`) to the parent `path[depth - 1]`, a full parent is split the same way, a split root
+ * gets a new root above it [void] */
+void index_internal_insert(Table* table, IndexColumn column, uint32_t* path, uint32_t depth,
+                           uint32_t left_page_number, IndexEntry* separator, uint32_t right_page_number) {
+    Pager* pager = table->pager;
+
+    if (depth == 0) {
+        uint32_t root_page_number = get_unused_page_number(pager);
+        void* root = get_page(pager, root_page_number);
+        pager_mark_dirty(pager, root_page_number);
+        initialize_index_internal(root);
+        set_node_root(root, true);
+        *index_internal_num_keys(root) = 1;
+        *index_internal_key(root, 0) = *separator;
+        *index_internal_child(root, 0) = left_page_number;
+        *index_internal_right_child(root) = right_page_number;
+
+        void* left = get_page(pager, left_page_number);
+        pager_mark_dirty(pager, left_page_number);
+        set_node_root(left, false);
+        table->index_root_page_numbers[column] = root_page_number;
+        return;
+    }
+
+    uint32_t page_number = path[depth - 1];
+    void* node = get_page(pager, page_number);
+    pager_mark_dirty(pager, page_number);
+
+    /* the left half keeps the key of the old node (the max entry of both halves), so the
+     * position of the old node is the first key that isn't smaller than the left half's max */
+    uint32_t num_keys = *index_internal_num_keys(node);
+    uint32_t index = index_internal_find_child(node, separator);
+
+    if (num_keys < INDEX_INTERNAL_MAX_CELLS) {
+        uint32_t* children = index_internal_children(node);
+        memmove(index_internal_key(node, index + 1), index_internal_key(node, index), (num_keys - index) * INDEX_ENTRY_SIZE);
+        memmove(children + index + 1, children + index, (num_keys - index) * sizeof(uint32_t));
+        *index_internal_key(node, index) = *separator;
+        children[index] = left_page_number;
+        if (index == num_keys)
+            *index_internal_right_child(node) = right_page_number; // the old node was the right child
+        else
+            children[index + 1] = right_page_number;
+        *index_internal_num_keys(node) = num_keys + 1;
+        return;
+    }
+
+    /* full node, all keys and children in order and then split in half, the middle key goes up */
+    IndexEntry keys[INDEX_INTERNAL_MAX_CELLS + 1];
+    uint32_t children[INDEX_INTERNAL_MAX_CELLS + 2];
+    for (uint32_t i = 0, j = 0; i <= num_keys; i++, j++) {
+        if (i == index) {
+            keys[j] = *separator;
+            children[j] = left_page_number;
+            j++;
+            children[j] = right_page_number;
+        } else {
+            children[j] = *index_internal_child(node, i);
+        }
+        if (i < num_keys)
+            keys[j] = *index_internal_key(node, i);
+    }
+
+    uint32_t total_keys = num_keys + 1;
+    uint32_t middle = total_keys / 2;
+    IndexEntry middle_key = keys[middle];
+
+    uint32_t new_page_number = get_unused_page_number(pager);
+    void* new_node = get_page(pager, new_page_number);
+    pager_mark_dirty(pager, new_page_number);
+    initialize_index_internal(new_node);
+
+    bool is_root = is_node_root(node);
+    initialize_index_internal(node);
+    set_node_root(node, is_root);
+    *index_internal_num_keys(node) = middle;
+    for (uint32_t i = 0; i < middle; i++) {
+        *index_internal_key(node, i) = keys[i];
+        *index_internal_child(node, i) = children[i];
+    }
+    *index_internal_right_child(node) = children[middle];
+
+    *index_internal_num_keys(new_node) = total_keys - middle - 1;
+    for (uint32_t i = middle + 1; i < total_keys; i++) {
+        *index_internal_key(new_node, i - middle - 1) = keys[i];
+        *index_internal_child(new_node, i - middle - 1) = children[i];
+    }
+    *index_internal_right_child(new_node) = children[total_keys];
+
+    index_internal_insert(table, column, path, depth - 1, page_number, &middle_key, new_page_number);
+}
+
+/* removes the row's entry from the column's index, nodes aren't merged (an empty leaf is
+ * skipped by the cursors and filled again by later inserts) [void] */
+void index_delete(Table* table, IndexColumn column, Row* row) {
+    IndexEntry entry;
+    index_entry_make(&entry, index_row_value(row, column), row->id);
+
+    uint32_t path[BTREE_MAX_DEPTH];
+    uint32_t depth;
+    uint32_t page_number = index_find_leaf(table, column, &entry, path, &depth);
+    void* node = get_page(table->pager, page_number);
+
+    uint32_t num_cells = *index_leaf_num_cells(node);
+    uint32_t cell_number = index_leaf_find(node, &entry);
+    if (cell_number == num_cells || index_entry_compare(index_leaf_entry(node, cell_number), &entry) != 0)
+        return;
+
+    pager_mark_dirty(table->pager, page_number);
+    memmove(index_leaf_entry(node, cell_number), index_leaf_entry(node, cell_number + 1),
+            (num_cells - cell_number - 1) * INDEX_ENTRY_SIZE);
+    *index_leaf_num_cells(node) = num_cells - 1;
+}
+
+/* adds a new row to every index of the table (and to the hash index) [void] */
+void index_insert_row(Table* table, Row* row) {
+    for (uint32_t c = 0; c < INDEX_COLUMNS; c++)
+        if (table->index_root_page_numbers[c] != 0)
+            index_insert(table, c, row);
+    if (table->hash_root_page_number != 0)
+        hash_insert(table, row);
+}
+
+/* removes a deleted row from every index of the table (and from the hash index) [void] */
+void index_delete_row(Table* table, Row* row) {
+    for (uint32_t c = 0; c < INDEX_COLUMNS; c++)
+        if (table->index_root_page_numbers[c] != 0)
+            index_delete(table, c, row);
+    if (table->hash_root_page_number != 0)
+        hash_delete(table, row->id);
+}
+
+/* checks if the table has an index (or a hash index) [bool] */
+bool index_exists(Table* table) {
+    for (uint32_t c = 0; c < INDEX_COLUMNS; c++)
+        if (table->index_root_page_numbers[c] != 0)
+            return true;
+    return table->hash_root_page_number != 0;
+}
+
+
+/* Building and dropping --------- */
+
+/* builds the column's index from the rows of the table and makes it the column's index (the
+ * header is written by the caller's commit), returns the number of entries. The entries are
+ * collected by one scan of the table, sorted, and the tree is built bottom-up. The commits of
+ * the build keep the header's roots (`db_commit_build()`) [uint32_t] */
+uint32_t index_create(Table* table, IndexColumn column) {
+    Pager* pager = table->pager;
+    IndexEntry* entries = malloc((table->row_count + 1) * sizeof(IndexEntry));
+    uint32_t count = 0;
+
+    RowBatch batch;
+    Cursor cursor;
+    table_start(table, &cursor);
+    uint32_t since_commit = 0;
+    while (cursor_read_batch(&cursor, &batch) > 0) {
+        const char** values = column == INDEX_USERNAME ? batch.usernames : batch.emails;
+        uint8_t* lengths = column == INDEX_USERNAME ? batch.username_lengths : batch.email_lengths;
+        for (uint32_t i = 0; i < batch.count; i++) {
+            /* same as `index_entry_make()`, the values in the leaf aren't NUL terminated */
+            IndexEntry* entry = &entries[count++];
+            memset(entry->prefix, 0, INDEX_PREFIX_SIZE);
+            memcpy(entry->prefix, values[i], lengths[i] < INDEX_PREFIX_SIZE ? lengths[i] : INDEX_PREFIX_SIZE);
+            entry->id = batch.ids[i];
+        }
+
+        /* only the cursor's (pinned) leaf has to stay in the buffer pool while scanning */
+        since_commit += batch.count;
+        if (since_commit >= INDEX_BUILD_COMMIT_INTERVAL) {
+            db_commit_build(table);
+            pager_release(pager);
+            since_commit = 0;
+        }
+    }
+    cursor_close(&cursor);
+
+    qsort(entries, count, sizeof(IndexEntry), index_entry_compare);
+    table->index_root_page_numbers[column] = index_build(table, entries, count);
+
+    free(entries);
+    return count;
+}
+
+/* writes the sorted entries into full leaves and builds the internal levels above them, every level
+ * divides the nodes below it evenly between as few nodes as possible (like `header_upgrade()`).
+ * The pages are committed every `INDEX_BUILD_COMMIT_INTERVAL` pages with `db_commit_build()`, the
+ * header keeps the old root, so an interrupted build leaves the old index in place, returns the root [uint32_t] */
+uint32_t index_build(Table* table, IndexEntry* entries, uint32_t count) {
+    Pager* pager = table->pager;
+    uint32_t leaf_count = count == 0 ? 1 : (count + INDEX_LEAF_MAX_CELLS - 1) / INDEX_LEAF_MAX_CELLS;
+    IndexBuildNode* nodes = malloc(leaf_count * sizeof(IndexBuildNode));
+    uint32_t since_commit = 0;
+
+    uint32_t previous_leaf = 0;
+    for (uint32_t n = 0; n < leaf_count; n++) {
+        uint32_t start = (uint64_t)count * n / leaf_count;
+        uint32_t end = (uint64_t)count * (n + 1) / leaf_count;
+
+        uint32_t page_number = get_unused_page_number(pager);
+        void* node = get_page(pager, page_number);
+        pager_mark_dirty(pager, page_number);
+        initialize_index_leaf(node);
+        *index_leaf_num_cells(node) = end - start;
+        memcpy(index_leaf_entry(node, 0), entries + start, (end - start) * INDEX_ENTRY_SIZE);
+
+        if (previous_leaf != 0) {
+            pager_mark_dirty(pager, previous_leaf);
+            *index_leaf_next_leaf(get_page(pager, previous_leaf)) = page_number;
+        }
+        previous_leaf = page_number;
+
+        nodes[n].page_number = page_number;
+        if (end > start)
+            nodes[n].max_entry = entries[end - 1];
+
+        if (++since_commit >= INDEX_BUILD_COMMIT_INTERVAL) {
+            db_commit_build(table);
+            pager_release(pager);
+            since_commit = 0;
+        }
+    }
+
+    count = leaf_count;
+    while (count > 1) {
+        uint32_t node_count = (count + INDEX_INTERNAL_MAX_CELLS) / (INDEX_INTERNAL_MAX_CELLS + 1);
+        uint32_t start = 0;
+
+        for (uint32_t n = 0; n < node_count; n++) {
+            uint32_t end = (uint64_t)count * (n + 1) / node_count;
+            uint32_t page_number = get_unused_page_number(pager);
+            void* node = get_page(pager, page_number);
+            pager_mark_dirty(pager, page_number);
+            initialize_index_internal(node);
+
+            uint32_t num_keys = end - start - 1;
+            *index_internal_num_keys(node) = num_keys;
+            for (uint32_t i = 0; i < num_keys; i++) {
+                *index_internal_key(node, i) = nodes[start + i].max_entry;
+                *index_internal_child(node, i) = nodes[start + i].page_number;
+            }
+            *index_internal_right_child(node) = nodes[end - 1].page_number;
+
+            /* `n` <= `start`, the children were read already */
+            nodes[n] = (IndexBuildNode){ page_number, nodes[end - 1].max_entry };
+            start = end;
+
+            if (++since_commit >= INDEX_BUILD_COMMIT_INTERVAL) {
+                db_commit_build(table);
+                pager_release(pager);
+                since_commit = 0;
+            }
+        }
+
+        count = node_count;
+    }
+
+    uint32_t root_page_number = nodes[0].page_number;
+    void* root = get_page(pager, root_page_number);
+    pager_mark_dirty(pager, root_page_number);
+    set_node_root(root, true);
+
+    free(nodes);
+    return root_page_number;
+}
+
+/* puts all pages of an index (sub)tree on the free list [void] */
+void index_free_pages(Table* table, uint32_t page_number) {
+    void* node = get_page(table->pager, page_number);
+
+    if (get_node_type(node) == NODE_INDEX_INTERNAL) {
+        uint32_t num_keys = *index_internal_num_keys(node);
+        for (uint32_t i = 0; i <= num_keys; i++)
+            index_free_pages(table, *index_internal_child(get_page(table->pager, page_number), i));
+    }
+
+    pager_free_page(table->pager, page_number);
+}
+
+/* builds every existing index (and the hash index) again, after an import added rows without
+ * them. The old indexes are freed after all new ones are built, so they stay valid until the
+ * header is written with the new roots [void] */
+void index_rebuild_all(Table* table) {
+    uint32_t old_roots[INDEX_COLUMNS];
+
+    for (uint32_t c = 0; c < INDEX_COLUMNS; c++) {
+        old_roots[c] = table->index_root_page_numbers[c];
+        if (old_roots[c] != 0)
+            index_create(table, c);
+    }
+
+    uint32_t old_hash_root = table->hash_root_page_number;
+    if (old_hash_root != 0)
+        hash_create(table);
+
+    for (uint32_t c = 0; c < INDEX_COLUMNS; c++)
+        if (old_roots[c] != 0)
+            index_free_pages(table, old_roots[c]);
+    if (old_hash_root != 0)
+        hash_free_pages(table, old_hash_root);
+}
+
+
+/* Lookups --------- */
+
+/* positions the cursor (the caller's) at the first entry of the column's index that isn't smaller
+ * than `entry`, it's at the end of the index if there is none [void] */
+void index_seek(Table* table, IndexColumn column, IndexEntry* entry, IndexCursor* cursor) {
+    uint32_t path[BTREE_MAX_DEPTH];
+    uint32_t depth;
+    uint32_t page_number = index_find_leaf(table, column, entry, path, &depth);
+
+    cursor->table = table;
+    cursor->page_number = page_number;
+    cursor->cell_number = index_leaf_find(get_page(table->pager, page_number), entry);
+    cursor->end_of_index = false;
+    pager_pin(table->pager, page_number);
+
+    index_cursor_skip_empty(cursor);
+}
+
+/* returns the entry the cursor is pointing at [IndexEntry*] */
+IndexEntry* index_cursor_entry(IndexCursor* cursor) {
+    return index_leaf_entry(get_page(cursor->table->pager, cursor->page_number), cursor->cell_number);
+}
+
+/* advances the cursor to the next entry [void] */
+void index_cursor_advance(IndexCursor* cursor) {
+    cursor->cell_number++;
+    index_cursor_skip_empty(cursor);
+}
+
+/* moves a cursor that is past the last entry of its leaf to the first entry of the
+ * next leaf that has one (leaves can be empty after deletes) [void] */
+void index_cursor_skip_empty(IndexCursor* cursor) {
+    Pager* pager = cursor->table->pager;
+    void* node = get_page(pager, cursor->page_number);
+
+    while (cursor->cell_number >= *index_leaf_num_cells(node)) {
+        uint32_t next_page_number = *index_leaf_next_leaf(node);
+        if (next_page_number == 0) {
+            cursor->end_of_index = true;
+            return;
+        }
+
+        /* the cursor keeps only the leaf it's pointing at pinned */
+        pager_unpin(pager, cursor->page_number);
+        pager_pin(pager, next_page_number);
+        cursor->page_number = next_page_number;
+        cursor->cell_number = 0;
+        node = get_page(pager, next_page_number);
+    }
+}
+
+/* unpins the cursor's page [void] */
+void index_cursor_close(IndexCursor* cursor) {
+    pager_unpin(cursor->table->pager, cursor->page_number);
+}
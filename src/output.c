@@ -0,0 +1,163 @@
+#include "output.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+OutputMode output_mode = OUTPUT_TEXT;
+
+static char output_buffer[OUTPUT_BUFFER_SIZE];
+static uint32_t output_length = 0;
+
+static const char* output_mode_names[] = {"text", "csv", "binary"};
+
+/* writes the decimal digits of the number to the destination, returns the number of digits [uint32_t] */
+uint32_t output_format_number(uint64_t number, char* destination) {
+    char digits[20];
+    uint32_t count = 0;
+    do {
+        digits[count++] = '0' + number % 10;
+        number /= 10;
+    } while (number > 0);
+
+    for (uint32_t i = 0; i < count; i++)
+        destination[i] = digits[count - 1 - i];
+    return count;
+}
+
+/* writes a csv value to the destination (quoted if it has a comma or a double quote),
+ * returns the number of bytes written [uint32_t] */
+uint32_t output_format_csv_value(const char* value, uint32_t length, char* destination) {
+    if (memchr(value, ',', length) == NULL && memchr(value, '"', length) == NULL) {
+        memcpy(destination, value, length);
+        return length;
+    }
+
+    uint32_t written = 0;
+    destination[written++] = '"';
+    for (uint32_t i = 0; i < length; i++) {
+        if (value[i] == '"')
+            destination[written++] = '"';
+        destination[written++] = value[i];
+    }
+    destination[written++] = '"';
+    return written;
+}
+
+/* makes room for one more row in the output buffer (by writing it out if it's too full) [char*] */
+char* output_reserve() {
+    if (output_length + OUTPUT_MAX_ROW_SIZE > OUTPUT_BUFFER_SIZE)
+        output_flush();
+    return output_buffer + output_length;
+}
+
+/* adds a row to the output, the values don't have to be NUL terminated (they can point into a leaf) [void] */
+void output_row(uint32_t id, const char* username, uint32_t username_length, const char* email, uint32_t email_length) {
+    char* destination = output_reserve();
+    char* start = destination;
+
+    switch (output_mode) {
+        case (OUTPUT_TEXT):
+            *destination++ = '(';
+            destination += output_format_number(id, destination);
+            *destination++ = ',';
+            *destination++ = ' ';
+            memcpy(destination, username, username_length);
+            destination += username_length;
+            *destination++ = ',';
+            *destination++ = ' ';
+            memcpy(destination, email, email_length);
+            destination += email_length;
+            *destination++ = ')';
+            *destination++ = '\n';
+            break;
+        case (OUTPUT_CSV):
+            destination += output_format_number(id, destination);
+            *destination++ = ',';
+            destination += output_format_csv_value(username, username_length, destination);
+            *destination++ = ',';
+            destination += output_format_csv_value(email, email_length, destination);
+            *destination++ = '\n';
+            break;
+        case (OUTPUT_BINARY):
+            /* the same bytes as the leaf's key and record */
+            memcpy(destination, &id, sizeof(uint32_t));
+            destination += sizeof(uint32_t);
+            *destination++ = (char)username_length;
+            memcpy(destination, username, username_length);
+            destination += username_length;
+            *destination++ = (char)email_length;
+            memcpy(destination, email, email_length);
+            destination += email_length;
+            break;
+    }
+
+    output_length += destination - start;
+}
+
+/* adds the result of a `count(*)` to the output [void] */
+void output_count(uint64_t count) {
+    char* destination = output_reserve();
+    char* start = destination;
+
+    switch (output_mode) {
+        case (OUTPUT_TEXT):
+            *destination++ = '(';
+            destination += output_format_number(count, destination);
+            *destination++ = ')';
+            *destination++ = '\n';
+            break;
+        case (OUTPUT_CSV):
+            destination += output_format_number(count, destination);
+            *destination++ = '\n';
+            break;
+        case (OUTPUT_BINARY):
+            memcpy(destination, &count, sizeof(uint64_t));
+            destination += sizeof(uint64_t);
+            break;
+    }
+
+    output_length += destination - start;
+}
+
+/* writes the output buffer to the standard output, after everything that was printed before
+ * it with `printf()` [void] */
+void output_flush() {
+    if (output_length == 0)
+        return;
+
+    fflush(stdout);
+    uint32_t written = 0;
+    while (written < output_length) {
+        ssize_t result = write(STDOUT_FILENO, output_buffer + written, output_length - written);
+        if (result == -1) {
+            if (errno == EINTR)
+                continue;
+            printf("Error writing the output: %d\n", errno);
+            exit(EXIT_FAILURE);
+        }
+        written += result;
+    }
+
+    output_length = 0;
+}
+
+/* selects the output format by its name, returns false if there isn't one with that name [bool] */
+bool output_set_mode(const char* name) {
+    for (uint32_t mode = OUTPUT_TEXT; mode <= OUTPUT_BINARY; mode++) {
+        if (strcmp(name, output_mode_names[mode]) == 0) {
+            output_flush();
+            output_mode = mode;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* returns the name of the output format [const char*] */
+const char* output_mode_name(OutputMode mode) {
+    return output_mode_names[mode];
+}
@@ -0,0 +1,605 @@
+#include "pager.h"
+#include "wal.h"
+
+/* returns the address to the raw page data (bytes from memory) of a given page number,
+ * the address stays valid until the next `pager_release()` call, or as long as the page is pinned
+ * (in shared mode only as long as it's pinned) [void*] */
+void* get_page(Pager* pager, uint32_t page_number) {
+    if (!pager->shared)
+        return pager_get_page(pager, page_number);
+
+    pthread_mutex_lock(&pager->lock);
+    void* page = pager_get_page(pager, page_number);
+    pthread_mutex_unlock(&pager->lock);
+    return page;
+}
+
+/* `get_page()` without the lock of shared mode [void*] */
+void* pager_get_page(Pager* pager, uint32_t page_number) {
+    if (page_number >= TABLE_MAX_PAGES) {
+        printf("Tried to fetch page number out of bounds. %d > %d\n", page_number, TABLE_MAX_PAGES);
+        exit(EXIT_FAILURE);
+    }
+
+    if (pager->mode == PAGER_MMAP) {
+        /* the page lives in the mapping, there is nothing to read or copy */
+        if (page_number >= pager->mapped_pages)
+            pager_map_grow(pager, page_number);
+        if (page_number >= pager->page_count)
+            pager->page_count = page_number + 1;
+
+        return pager->map + (size_t)page_number * PAGE_SIZE;
+    }
+
+    if (page_number >= pager->page_frames_capacity) {
+        /* growing the page table (doubling it) */
+        uint32_t new_capacity = pager->page_frames_capacity;
+        while (new_capacity <= page_number)
+            new_capacity *= 2;
+        if (new_capacity > TABLE_MAX_PAGES)
+            new_capacity = TABLE_MAX_PAGES;
+
+        pager->page_frames = realloc(pager->page_frames, new_capacity * sizeof(uint32_t));
+        memset(pager->page_frames + pager->page_frames_capacity, 0,
+               (new_capacity - pager->page_frames_capacity) * sizeof(uint32_t));
+        pager->page_frames_capacity = new_capacity;
+    }
+
+    uint32_t frame_index;
+    if (pager->page_frames[page_number] != 0) {
+        // Cache hit.
+        frame_index = pager->page_frames[page_number] - 1;
+    } else {
+        // Cache miss. Take a free (or evicted) frame and load from file.
+        frame_index = pager_find_victim(pager);
+        Frame* frame = &pager->frames[frame_index];
+
+        memset(frame->data, 0, PAGE_SIZE);
+
+        uint32_t num_pages = pager->file_size / PAGE_SIZE;
+
+        frame->dirty = false;
+        frame->spilled = false;
+        if (wal_read_spilled(pager->wal, page_number, frame->data)) {
+            /* the page was spilled into the log and evicted, the database file doesn't have it yet */
+            frame->dirty = true;
+            frame->spilled = true;
+        } else if (page_number < num_pages) {
+            ssize_t bytes_read = pread(pager->file_descriptor, frame->data, PAGE_SIZE, (off_t)page_number * PAGE_SIZE);
+            if (bytes_read == -1) {
+                printf("Error reading file: %d\n", errno);
+                exit(EXIT_FAILURE);
+            }
+            pager->page_reads++;
+        }
+
+        frame->page_number = page_number;
+        frame->pin_count = 0;
+        pager->page_frames[page_number] = frame_index + 1;
+
+        if (page_number >= pager->page_count)
+            pager->page_count = page_number + 1;
+    }
+
+    Frame* frame = &pager->frames[frame_index];
+    frame->referenced = true;
+    frame->last_used = pager->epoch;
+
+    return frame->data;
+}
+
+/* same as `get_page()`, and sets `frame_index` to the page's frame (0 in `PAGER_MMAP` mode) [void*] */
+void* get_page_frame(Pager* pager, uint32_t page_number, uint32_t* frame_index) {
+    void* page = get_page(pager, page_number);
+    *frame_index = pager->mode == PAGER_MMAP ? 0 : pager->page_frames[page_number] - 1;
+
+    return page;
+}
+
+/* returns the page number for a new page, a page from the free list is reused before
+ * the file grows [uint32_t] */
+uint32_t get_unused_page_number(Pager* pager) {
+    if (pager->free_list_head == 0)
+        return pager->page_count;
+
+    uint32_t page_number = pager->free_list_head;
+    void* page = get_page(pager, page_number);
+    pager->free_list_head = *(uint32_t*)(page + FREE_PAGE_NEXT_OFFSET);
+
+    /* the caller initializes the page, it mustn't look like a node or a free page */
+    pager_mark_dirty(pager, page_number);
+    memset(page, 0, PAGE_SIZE);
+
+    return page_number;
+}
+
+/* puts a page that isn't used anymore on the free list [void] */
+void pager_free_page(Pager* pager, uint32_t page_number) {
+    void* page = get_page(pager, page_number);
+    pager_mark_dirty(pager, page_number);
+
+    memset(page, 0, PAGE_SIZE);
+    *(uint32_t*)(page + FREE_PAGE_NEXT_OFFSET) = pager->free_list_head;
+    pager->free_list_head = page_number;
+}
+
+
+/* Pager handling --------- */
+
+/* opens a file and assigns values to the Pager structure (file_descriptor, file_size, buffer pool) [Pager*] */
+Pager* pager_open(const char* filename, PagerMode mode, uint32_t max_frames, SyncLevel sync_level) {
+    int fd = open(filename,
+                  O_RDWR |    // Read/Write mode
+                  O_CREAT,    // Create file if it does not exist
+                  S_IWUSR |   // User write permission
+                  S_IRUSR);   // User read permission
+
+    if (fd == -1) {
+        printf("Unable to open file\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // lseek() returns the length of a file from the beggining up till the given offset in 'off_t'
+    off_t file_size = lseek(fd, 0, SEEK_END);
+
+
+    Pager* pager = malloc(sizeof(Pager));
+    pager->mode = mode;
+    pager->file_descriptor = fd;
+    pager->file_size = file_size;
+    pager->page_count = (file_size / PAGE_SIZE);
+    pager->free_list_head = 0;
+
+    // ! 'file_size' needs to be divisible with 'PAGE_SIZE', otherwise it means that there was trouble writing down the full pages
+    if (file_size % PAGE_SIZE != 0) {
+        printf("Db file is not a whole number of pages. Corrupt file.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    /* a B-tree operation needs a few pages at the same time (a path from the root and the split nodes) */
+    if (max_frames < 16)
+        max_frames = 16;
+
+    /* frames are allocated lazily, the pool only grows until it reaches `max_frames` */
+    pager->max_frames = max_frames;
+    pager->frame_count = 0;
+    pager->frame_capacity = 1024;
+    pager->frames = malloc(pager->frame_capacity * sizeof(Frame));
+    pager->clock_hand = 0;
+    pager->epoch = 1;
+
+    pager->page_frames_capacity = 1024;
+    pager->page_frames = calloc(pager->page_frames_capacity, sizeof(uint32_t));
+
+    pager->shared = false;
+    pthread_mutex_init(&pager->lock, NULL);
+
+    pager->zone_maps = NULL;
+    pager->zone_map_capacity = 0;
+    pager->page_reads = 0;
+
+    /* committed statements that didn't make it into the database file are replayed from the log */
+    pager->wal = NULL;
+    wal_open(pager, filename, sync_level);
+
+    pager->map = NULL;
+    pager->mapped_pages = 0;
+    pager->map_dirty = NULL;
+    pager->map_dirty_pages = NULL;
+    pager->map_dirty_count = 0;
+    pager->map_dirty_capacity = 0;
+    if (mode == PAGER_MMAP)
+        pager_map_file(pager);
+
+    return pager;
+}
+
+/* writes (flushes) the cached page with the given page number onto the disk (file) [void] */
+void pager_flush(Pager* pager, uint32_t page_number) {
+    if (pager->mode == PAGER_BUFFERED &&
+        (page_number >= pager->page_frames_capacity || pager->page_frames[page_number] == 0)) {
+        printf("Tried to flush null page.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    /* the page of the memory mapped pager is its private copy in the mapping */
+    Frame* frame = NULL;
+    void* data = pager->map + (size_t)page_number * PAGE_SIZE;
+    if (pager->mode == PAGER_BUFFERED) {
+        frame = &pager->frames[pager->page_frames[page_number] - 1];
+        data = frame->data;
+    }
+    ssize_t bytes_written = pwrite(pager->file_descriptor, data, PAGE_SIZE, (off_t)page_number * PAGE_SIZE);
+
+    if (bytes_written == -1) {
+        printf("Error writing: %d.\n", errno);
+        exit(EXIT_FAILURE);
+    }
+
+    if ((off_t)(page_number + 1) * PAGE_SIZE > pager->file_size)
+        pager->file_size = (off_t)(page_number + 1) * PAGE_SIZE;
+
+    if (frame != NULL)
+        frame->dirty = false;
+}
+
+/* `qsort()` comparator for page numbers [int] */
+int compare_page_numbers(const void* a, const void* b) {
+    uint32_t page_a = *(const uint32_t*)a;
+    uint32_t page_b = *(const uint32_t*)b;
+
+    return (page_a > page_b) - (page_a < page_b);
+}
+
+/* writes every dirty page onto the disk, runs of adjacent dirty pages
+ * are written with a single `pwritev()` call [void] */
+void pager_flush_all(Pager* pager) {
+    /* collecting the dirty pages, sorted by page number */
+    uint32_t* dirty_pages;
+    uint32_t dirty_count = 0;
+    if (pager->mode == PAGER_MMAP) {
+        dirty_pages = pager->map_dirty_pages;
+        dirty_count = pager->map_dirty_count;
+    } else {
+        dirty_pages = malloc(pager->frame_count * sizeof(uint32_t));
+        for (uint32_t i = 0; i < pager->frame_count; i++) {
+            if (pager->frames[i].page_number != UINT32_MAX && pager->frames[i].dirty)
+                dirty_pages[dirty_count++] = pager->frames[i].page_number;
+        }
+    }
+    qsort(dirty_pages, dirty_count, sizeof(uint32_t), compare_page_numbers);
+
+    struct iovec iov[PAGER_MAX_IOV];
+    uint32_t i = 0;
+    while (i < dirty_count) {
+        /* extending the run while the next dirty page is the adjacent one */
+        uint32_t first_page = dirty_pages[i];
+        uint32_t run = 0;
+        while (i + run < dirty_count && run < PAGER_MAX_IOV && dirty_pages[i + run] == first_page + run) {
+            if (pager->mode == PAGER_MMAP)
+                iov[run].iov_base = pager->map + (size_t)(first_page + run) * PAGE_SIZE;
+            else
+                iov[run].iov_base = pager->frames[pager->page_frames[first_page + run] - 1].data;
+            iov[run].iov_len = PAGE_SIZE;
+            run++;
+        }
+
+        off_t offset = (off_t)first_page * PAGE_SIZE;
+        ssize_t expected = (ssize_t)run * PAGE_SIZE;
+        ssize_t bytes_written = pwritev(pager->file_descriptor, iov, run, offset);
+        if (bytes_written == -1) {
+            printf("Error writing: %d.\n", errno);
+            exit(EXIT_FAILURE);
+        }
+
+        /* short write, writing the rest of the run page by page */
+        for (uint32_t j = bytes_written / PAGE_SIZE; j < run; j++)
+            pager_flush(pager, first_page + j);
+
+        if (offset + expected > pager->file_size)
+            pager->file_size = offset + expected;
+
+        if (pager->mode == PAGER_MMAP) {
+            pager_map_reload(pager, first_page, run);
+        } else {
+            for (uint32_t j = 0; j < run; j++)
+                pager->frames[pager->page_frames[first_page + j] - 1].dirty = false;
+        }
+        i += run;
+    }
+
+    if (pager->mode == PAGER_MMAP) {
+        for (uint32_t j = 0; j < dirty_count; j++)
+            pager->map_dirty[dirty_pages[j]] = false;
+        pager->map_dirty_count = 0;
+    } else {
+        free(dirty_pages);
+    }
+}
+
+/* checkpoints the log (flushing every dirty page), frees the buffer pool and closes the database file [void] */
+void pager_close(Pager* pager) {
+    wal_close(pager);
+
+    if (pager->mode == PAGER_MMAP) {
+        munmap(pager->map, (size_t)TABLE_MAX_PAGES * PAGE_SIZE);
+        /* the mapping grows in bigger steps, the unused pages at the end are cut off */
+        if (ftruncate(pager->file_descriptor, (off_t)pager->page_count * PAGE_SIZE) == -1) {
+            printf("Error truncating db file: %d.\n", errno);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // closing the database file
+    int result = close(pager->file_descriptor);
+    if (result == -1) {
+        printf("Error closing db file.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Free memory
+    for (uint32_t i = 0; i < pager->frame_count; i++) {
+        free(pager->frames[i].data);
+    }
+    free(pager->frames);
+    free(pager->page_frames);
+    free(pager->map_dirty);
+    free(pager->map_dirty_pages);
+    free(pager->zone_maps);
+    pthread_mutex_destroy(&pager->lock);
+    free(pager);
+}
+
+
+/* commits the changes made by the current statement into the write-ahead log [void] */
+void pager_commit(Pager* pager) {
+    wal_commit(pager);
+}
+
+/* writes the pages modified so far by the current statement into the log without committing it,
+ * see `wal_spill()` [void] */
+void pager_spill(Pager* pager) {
+    wal_spill(pager);
+}
+
+
+/* Buffer pool handling --------- */
+
+/* pins a cached page, so it can't be evicted until it's unpinned [void] */
+void pager_pin(Pager* pager, uint32_t page_number) {
+    if (pager->mode == PAGER_MMAP)
+        return;
+    if (pager->shared)
+        pthread_mutex_lock(&pager->lock);
+
+    pager_get_page(pager, page_number);
+    pager->frames[pager->page_frames[page_number] - 1].pin_count++;
+
+    if (pager->shared)
+        pthread_mutex_unlock(&pager->lock);
+}
+
+/* pins the page held by the given frame (a frame returned by `get_page_frame()`),
+ * unpinned with `pager_unpin()` [void] */
+void pager_pin_frame(Pager* pager, uint32_t frame_index) {
+    if (pager->mode == PAGER_MMAP)
+        return;
+    pager->frames[frame_index].pin_count++;
+}
+
+/* unpins a page pinned with `pager_pin()` [void] */
+void pager_unpin(Pager* pager, uint32_t page_number) {
+    if (pager->mode == PAGER_MMAP)
+        return;
+    if (pager->shared)
+        pthread_mutex_lock(&pager->lock);
+    if (page_number >= pager->page_frames_capacity || pager->page_frames[page_number] == 0) {
+        printf("Tried to unpin page %d that is not cached.\n", page_number);
+        exit(EXIT_FAILURE);
+    }
+
+    Frame* frame = &pager->frames[pager->page_frames[page_number] - 1];
+    if (frame->pin_count > 0)
+        frame->pin_count--;
+
+    if (pager->shared)
+        pthread_mutex_unlock(&pager->lock);
+}
+
+/* marks a cached page as modified, so it's written back on eviction and flush (a page of the
+ * memory mapped pager on the next checkpoint), it has to be called before the page is changed
+ * (the log saves the page's old image) [void] */
+void pager_mark_dirty(Pager* pager, uint32_t page_number) {
+    wal_add_page(pager->wal, page_number, get_page(pager, page_number));
+
+    /* the page is about to change, its zone map doesn't describe it anymore */
+    if (page_number < pager->zone_map_capacity)
+        pager->zone_maps[page_number].valid = false;
+
+    if (pager->mode == PAGER_MMAP) {
+        if (!pager->map_dirty[page_number]) {
+            if (pager->map_dirty_count == pager->map_dirty_capacity) {
+                pager->map_dirty_capacity = pager->map_dirty_capacity > 0 ? 2 * pager->map_dirty_capacity : 1024;
+                pager->map_dirty_pages = realloc(pager->map_dirty_pages, pager->map_dirty_capacity * sizeof(uint32_t));
+            }
+            pager->map_dirty_pages[pager->map_dirty_count++] = page_number;
+            pager->map_dirty[page_number] = true;
+        }
+        return;
+    }
+    if (page_number >= pager->page_frames_capacity || pager->page_frames[page_number] == 0) {
+        printf("Tried to mark page %d dirty that is not cached.\n", page_number);
+        exit(EXIT_FAILURE);
+    }
+
+    Frame* frame = &pager->frames[pager->page_frames[page_number] - 1];
+    frame->dirty = true;
+    frame->spilled = false; // the image in the log is about to be out of date
+}
+
+/* ends the current access epoch, every page fetched with `get_page()` until now
+ * (which is not pinned) can be evicted afterwards [void] */
+void pager_release(Pager* pager) {
+    if (!pager->shared) {
+        pager->epoch++;
+        return;
+    }
+
+    pthread_mutex_lock(&pager->lock);
+    pager->epoch++;
+    pthread_mutex_unlock(&pager->lock);
+}
+
+/* switches shared mode on (before worker threads read pages) or off (after they're done), in shared
+ * mode the pages can only be read (`get_page()`, `pager_pin()`, `pager_unpin()` and `pager_release()`),
+ * the memory mapped pager doesn't need it [void] */
+void pager_share(Pager* pager, bool shared) {
+    if (pager->mode == PAGER_BUFFERED)
+        pager->shared = shared;
+}
+
+/* returns the zone map of a page (see zone.h, it's invalid until it's recorded), the zone maps are
+ * grown to cover the page. In shared mode they aren't grown (`pager_reserve_zone_maps()` is called
+ * before), NULL is returned for a page they don't cover [ZoneMap*] */
+ZoneMap* pager_zone_map(Pager* pager, uint32_t page_number) {
+    if (page_number >= pager->zone_map_capacity) {
+        if (pager->shared)
+            return NULL;
+        pager_reserve_zone_maps(pager, page_number + 1);
+    }
+
+    return &pager->zone_maps[page_number];
+}
+
+/* returns the zone map of a page if it's valid, NULL otherwise [ZoneMap*] */
+ZoneMap* pager_valid_zone_map(Pager* pager, uint32_t page_number) {
+    if (page_number >= pager->zone_map_capacity || !zone_map_is_valid(&pager->zone_maps[page_number]))
+        return NULL;
+
+    return &pager->zone_maps[page_number];
+}
+
+/* grows the zone maps (doubling them) so they cover at least `page_count` pages [void] */
+void pager_reserve_zone_maps(Pager* pager, uint32_t page_count) {
+    if (page_count <= pager->zone_map_capacity)
+        return;
+
+    uint32_t new_capacity = pager->zone_map_capacity > 0 ? pager->zone_map_capacity : 1024;
+    while (new_capacity < page_count)
+        new_capacity *= 2;
+
+    pager->zone_maps = realloc(pager->zone_maps, new_capacity * sizeof(ZoneMap));
+    memset(pager->zone_maps + pager->zone_map_capacity, 0, (new_capacity - pager->zone_map_capacity) * sizeof(ZoneMap));
+    pager->zone_map_capacity = new_capacity;
+}
+
+/* returns the index of a frame that can hold a new page, allocating new frames until the
+ * budget is reached, and then evicting pages with the CLOCK algorithm [uint32_t] */
+uint32_t pager_find_victim(Pager* pager) {
+    /* frame budget not yet reached, allocating a new frame */
+    if (pager->frame_count < pager->max_frames)
+        return pager_allocate_frame(pager);
+
+    /* CLOCK: the hand sweeps the frames and clears reference bits, the first frame
+     * that wasn't referenced since the last sweep is the victim. Pinned frames and frames
+     * used in the current epoch are skipped, after two full sweeps every frame is in use */
+    for (uint32_t i = 0; i < 2 * pager->frame_count; i++) {
+        uint32_t frame_index = pager->clock_hand;
+        pager->clock_hand = (pager->clock_hand + 1) % pager->frame_count;
+
+        Frame* frame = &pager->frames[frame_index];
+        if (frame->pin_count > 0 || frame->last_used == pager->epoch)
+            continue;
+
+        if (frame->referenced) {
+            frame->referenced = false;
+            continue;
+        }
+
+        pager_evict(pager, frame_index);
+        return frame_index;
+    }
+
+    /* every frame is in use, so we go over the budget with one more frame
+     * (it is reused by later evictions, the pool won't grow any further unless this happens again) */
+    return pager_allocate_frame(pager);
+}
+
+/* allocates a new (empty) frame in the buffer pool and returns its index [uint32_t] */
+uint32_t pager_allocate_frame(Pager* pager) {
+    if (pager->frame_count == pager->frame_capacity) {
+        pager->frame_capacity *= 2;
+        pager->frames = realloc(pager->frames, pager->frame_capacity * sizeof(Frame));
+    }
+
+    uint32_t frame_index = pager->frame_count++;
+    Frame* frame = &pager->frames[frame_index];
+    frame->data = malloc(PAGE_SIZE);
+    frame->page_number = UINT32_MAX;
+    frame->pin_count = 0;
+    frame->referenced = false;
+    frame->dirty = false;
+    frame->spilled = false;
+    frame->last_used = 0;
+
+    return frame_index;
+}
+
+/* writes back the page held by the given frame (if it's dirty) and removes it from the page table [void] */
+void pager_evict(Pager* pager, uint32_t frame_index) {
+    Frame* frame = &pager->frames[frame_index];
+    if (frame->page_number == UINT32_MAX)
+        return;
+
+    /* clean pages are the same as on the disk, no need to write them back. Spilled pages
+     * are read from the log again, their statement may not be committed yet */
+    if (frame->dirty && !frame->spilled) {
+        /* the log has to be durable before the page it describes is written (the page was
+         * committed already, pages of the current statement are never evicted) */
+        wal_sync(pager->wal);
+        pager_flush(pager, frame->page_number);
+        wal_forget_spilled(pager->wal, frame->page_number); // the file has a newer image than the log
+    }
+
+    pager->page_frames[frame->page_number] = 0;
+    frame->page_number = UINT32_MAX;
+    frame->referenced = false;
+}
+
+
+/* Memory mapped pager handling --------- */
+
+/* reserves the address range for the whole database and maps the file at its start [void] */
+void pager_map_file(Pager* pager) {
+    size_t reserved = (size_t)TABLE_MAX_PAGES * PAGE_SIZE;
+    pager->map = mmap(NULL, reserved, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (pager->map == MAP_FAILED) {
+        printf("Error reserving memory for the mapping: %d.\n", errno);
+        exit(EXIT_FAILURE);
+    }
+
+    pager->mapped_pages = 0;
+    if (pager->page_count > 0)
+        pager_map_grow(pager, pager->page_count - 1);
+}
+
+/* grows the file (`ftruncate()`) and the mapping so that it contains the given page,
+ * the new part of the file is mapped right after the existing mapping [void] */
+void pager_map_grow(Pager* pager, uint32_t page_number) {
+    /* growing in bigger steps so the file isn't extended for every new page */
+    uint32_t new_mapped_pages = pager->mapped_pages < 256 ? 256 : pager->mapped_pages * 2;
+    while (new_mapped_pages <= page_number)
+        new_mapped_pages *= 2;
+    if (new_mapped_pages > TABLE_MAX_PAGES)
+        new_mapped_pages = TABLE_MAX_PAGES;
+
+    off_t new_size = (off_t)new_mapped_pages * PAGE_SIZE;
+    if (new_size > pager->file_size) {
+        if (ftruncate(pager->file_descriptor, new_size) == -1) {
+            printf("Error extending db file: %d.\n", errno);
+            exit(EXIT_FAILURE);
+        }
+        pager->file_size = new_size;
+    }
+
+    off_t mapped_size = (off_t)pager->mapped_pages * PAGE_SIZE;
+    void* address = mmap(pager->map + mapped_size, new_size - mapped_size, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_FIXED, pager->file_descriptor, mapped_size);
+    if (address == MAP_FAILED) {
+        printf("Error mapping db file: %d.\n", errno);
+        exit(EXIT_FAILURE);
+    }
+
+    pager->map_dirty = realloc(pager->map_dirty, new_mapped_pages * sizeof(bool));
+    memset(pager->map_dirty + pager->mapped_pages, 0, (new_mapped_pages - pager->mapped_pages) * sizeof(bool));
+    pager->mapped_pages = new_mapped_pages;
+}
+
+/* drops the private copies of `page_count` pages from `page_number` on after they were written into
+ * the file, the next access maps the pages of the file again (so the copies don't pile up) [void] */
+void pager_map_reload(Pager* pager, uint32_t page_number, uint32_t page_count) {
+    if (madvise(pager->map + (size_t)page_number * PAGE_SIZE, (size_t)page_count * PAGE_SIZE, MADV_DONTNEED) == -1) {
+        printf("Error reloading mapped pages: %d.\n", errno);
+        exit(EXIT_FAILURE);
+    }
+}
@@ -0,0 +1,100 @@
+#include "pool.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/* starts the workers of a pool of `thread_count` threads (including the thread that runs the jobs) [ThreadPool*] */
+ThreadPool* pool_create(uint32_t thread_count) {
+    ThreadPool* pool = malloc(sizeof(ThreadPool));
+    pool->thread_count = thread_count > 0 ? thread_count : 1;
+    pool->workers = malloc(pool->thread_count * sizeof(pthread_t));
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work, NULL);
+    pthread_cond_init(&pool->done, NULL);
+
+    pool->task = NULL;
+    pool->argument = NULL;
+    pool->task_count = 0;
+    pool->next_task = 0;
+    pool->finished_tasks = 0;
+    pool->stopping = false;
+
+    for (uint32_t i = 0; i + 1 < pool->thread_count; i++) {
+        if (pthread_create(&pool->workers[i], NULL, pool_worker, pool) != 0) {
+            printf("Error starting a worker thread.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    return pool;
+}
+
+/* runs the tasks `0` to `task_count - 1` on the pool's threads (and the calling thread), returns
+ * when all of them finished [void] */
+void pool_run(ThreadPool* pool, PoolTask task, void* argument, uint32_t task_count) {
+    pthread_mutex_lock(&pool->lock);
+    pool->task = task;
+    pool->argument = argument;
+    pool->task_count = task_count;
+    pool->next_task = 0;
+    pool->finished_tasks = 0;
+    pthread_cond_broadcast(&pool->work);
+
+    pool_take_tasks(pool);
+    while (pool->finished_tasks < pool->task_count)
+        pthread_cond_wait(&pool->done, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/* runs tasks of the current job until none is left, called (and returns) with the pool's lock held [void] */
+void pool_take_tasks(ThreadPool* pool) {
+    while (pool->next_task < pool->task_count) {
+        uint32_t task = pool->next_task++;
+        pthread_mutex_unlock(&pool->lock);
+        pool->task(pool->argument, task);
+        pthread_mutex_lock(&pool->lock);
+
+        if (++pool->finished_tasks == pool->task_count)
+            pthread_cond_signal(&pool->done);
+    }
+}
+
+/* main function of a worker thread, waits for jobs and takes their tasks [void*] */
+void* pool_worker(void* argument) {
+    ThreadPool* pool = argument;
+
+    pthread_mutex_lock(&pool->lock);
+    while (!pool->stopping) {
+        if (pool->next_task < pool->task_count)
+            pool_take_tasks(pool);
+        else
+            pthread_cond_wait(&pool->work, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    return NULL;
+}
+
+/* stops the workers (between jobs) and frees the pool [void] */
+void pool_destroy(ThreadPool* pool) {
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = true;
+    pthread_cond_broadcast(&pool->work);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (uint32_t i = 0; i + 1 < pool->thread_count; i++)
+        pthread_join(pool->workers[i], NULL);
+
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->work);
+    pthread_cond_destroy(&pool->done);
+    free(pool->workers);
+    free(pool);
+}
+
+/* returns the number of threads used when none is configured, one per online processor [uint32_t] */
+uint32_t pool_default_threads() {
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+    return processors > 0 ? (uint32_t)processors : 1;
+}
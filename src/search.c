@@ -0,0 +1,134 @@
+#include "search.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define KEY_SEARCH_X86
+#endif
+
+uint32_t key_search_resolve(const uint32_t* keys, uint32_t count, uint32_t key);
+
+/* starts as the resolver, which replaces it with the selected variant */
+KeySearchFunction key_search = key_search_resolve;
+
+
+/* binary search, used when the CPU has no SIMD support (and for the tail of the SIMD variants) [uint32_t] */
+uint32_t key_search_scalar(const uint32_t* keys, uint32_t count, uint32_t key) {
+    uint32_t min_index = 0;
+    uint32_t max_index = count;
+    while (min_index != max_index) {
+        uint32_t index = (min_index + max_index) / 2;
+        if (keys[index] >= key)
+            max_index = index;
+        else
+            min_index = index + 1;
+    }
+
+    return min_index;
+}
+
+#ifdef KEY_SEARCH_X86
+
+/* Keys are unsigned but SSE/AVX2 only compare signed integers, flipping the sign bit of both
+ * sides keeps the order. The keys of the window are sorted, so the number of keys smaller than
+ * `key` is the position of `key` in the window */
+
+/* 4 keys per compare [uint32_t] */
+__attribute__((target("sse4.2,popcnt")))
+uint32_t key_search_sse4(const uint32_t* keys, uint32_t count, uint32_t key) {
+    uint32_t low = 0;
+    uint32_t high = count;
+    while (high - low > KEY_SEARCH_SSE4_WINDOW) {
+        uint32_t index = (low + high) / 2;
+        if (keys[index] >= key)
+            high = index;
+        else
+            low = index + 1;
+    }
+
+    const __m128i sign = _mm_set1_epi32((int)0x80000000);
+    const __m128i target = _mm_xor_si128(_mm_set1_epi32((int)key), sign);
+    uint32_t index = low;
+    for (; index + 4 <= high; index += 4) {
+        __m128i block = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(keys + index)), sign);
+        int smaller = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(target, block)));
+        low += _mm_popcnt_u32(smaller);
+        if (smaller != 0xf)
+            return low;
+    }
+    for (; index < high && keys[index] < key; index++)
+        low++;
+
+    return low;
+}
+
+/* 8 keys per compare [uint32_t] */
+__attribute__((target("avx2,popcnt")))
+uint32_t key_search_avx2(const uint32_t* keys, uint32_t count, uint32_t key) {
+    uint32_t low = 0;
+    uint32_t high = count;
+    while (high - low > KEY_SEARCH_AVX2_WINDOW) {
+        uint32_t index = (low + high) / 2;
+        if (keys[index] >= key)
+            high = index;
+        else
+            low = index + 1;
+    }
+
+    const __m256i sign = _mm256_set1_epi32((int)0x80000000);
+    const __m256i target = _mm256_xor_si256(_mm256_set1_epi32((int)key), sign);
+    uint32_t index = low;
+    for (; index + 8 <= high; index += 8) {
+        __m256i block = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(keys + index)), sign);
+        int smaller = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(target, block)));
+        low += _mm_popcnt_u32(smaller);
+        if (smaller != 0xff)
+            return low;
+    }
+    for (; index < high && keys[index] < key; index++)
+        low++;
+
+    return low;
+}
+
+#else
+
+/* no SIMD variants on other architectures, they fall back to the binary search */
+uint32_t key_search_sse4(const uint32_t* keys, uint32_t count, uint32_t key) {
+    return key_search_scalar(keys, count, key);
+}
+
+uint32_t key_search_avx2(const uint32_t* keys, uint32_t count, uint32_t key) {
+    return key_search_scalar(keys, count, key);
+}
+
+#endif
+
+
+/* returns the fastest variant the CPU supports [KeySearchFunction] */
+KeySearchFunction key_search_select() {
+#ifdef KEY_SEARCH_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt"))
+        return key_search_avx2;
+    if (__builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt"))
+        return key_search_sse4;
+#endif
+    return key_search_scalar;
+}
+
+/* selects the variant on the first search [uint32_t] */
+uint32_t key_search_resolve(const uint32_t* keys, uint32_t count, uint32_t key) {
+    key_search = key_search_select();
+    return key_search(keys, count, key);
+}
+
+/* returns the name of a variant, for the benchmark [const char*] */
+const char* key_search_name(KeySearchFunction function) {
+    if (function == key_search_resolve)
+        function = key_search_select();
+    if (function == key_search_avx2)
+        return "avx2";
+    if (function == key_search_sse4)
+        return "sse4";
+    return "scalar";
+}
@@ -1,5 +1,9 @@
 #include "statement.h"
 #include "btree.h"
+#include "index.h"
+#include "hash.h"
+#include "alloc.h"
+#include "output.h"
 
 // compiler
 
@@ -35,14 +39,348 @@ PrepareResult prepare_insert(InputBuffer* input_buffer, Statement* statement) {
     return PREPARE_SUCCESS;
 }
 
+/* parses a non negative number (an id or a limit), returns false if it isn't valid [bool] */
+bool parse_number(char* string, uint32_t* number) {
+    if (string == NULL)
+        return false;
+
+    char* end;
+    long value = strtol(string, &end, 10);
+    if (*end != '\0' || value < 0 || value > UINT32_MAX)
+        return false;
+
+    *number = (uint32_t)value;
+    return true;
+}
+
+/* preparation for a predicate on the username or email, `username = bob` or `email = 'bob@mail.com'`
+ * (the quotes are optional), or a pattern, `email like '%@mail.com'` (a `%` at the start and/or end
+ * of the pattern, see `MatchKind`) [PrepareResult] */
+PrepareResult prepare_where_column(Statement* statement, char* column, char* operator, char* value) {
+    bool like = strcmp(operator, "like") == 0;
+    if (!like && strcmp(operator, "=") != 0)
+        return PREPARE_SYNTAX_ERROR;
+
+    size_t length = strlen(value);
+    if (length >= 2 && value[0] == '\'' && value[length - 1] == '\'') {
+        value[length - 1] = '\0';
+        value++;
+        length -= 2;
+    }
+
+    statement->match = MATCH_EQUAL;
+    if (like) {
+        bool prefix = length > 0 && value[length - 1] == '%';
+        if (prefix)
+            value[--length] = '\0';
+        bool suffix = length > 0 && value[0] == '%';
+        if (suffix) {
+            value++;
+            length--;
+        }
+        if (strchr(value, '%') != NULL)
+            return PREPARE_SYNTAX_ERROR;
+
+        if (prefix && suffix)
+            statement->match = MATCH_CONTAINS;
+        else if (prefix || suffix)
+            statement->match = prefix ? MATCH_PREFIX : MATCH_SUFFIX;
+    }
+
+    statement->column_predicate = true;
+    statement->column = strcmp(column, "username") == 0 ? INDEX_USERNAME : INDEX_EMAIL;
+    if (length > (statement->column == INDEX_USERNAME ? COLUMN_USERNAME_SIZE : COLUMN_EMAIL_SIZE))
+        return PREPARE_STRING_TOO_LONG;
+    strcpy(statement->column_value, value);
+
+    return PREPARE_SUCCESS;
+}
+
+/* preparation for the list of `id in (1, 5, 9)` (the tokens after `in`), the list can be split into
+ * several tokens by spaces, it's checked here and kept in the input line (`id_list` to `id_list_end`),
+ * its ids are read by `parse_id_list()` [PrepareResult] */
+PrepareResult prepare_id_list(Statement* statement) {
+    char* token = strtok(NULL, " ");
+    if (token == NULL || token[0] != '(')
+        return PREPARE_SYNTAX_ERROR;
+    statement->id_list = token + 1;
+
+    char* close;
+    while ((close = strchr(token, ')')) == NULL) {
+        if ((token = strtok(NULL, " ")) == NULL)
+            return PREPARE_SYNTAX_ERROR;
+    }
+    if (close[1] != '\0')
+        return PREPARE_SYNTAX_ERROR;
+    *close = '\0';
+    statement->id_list_end = close;
+
+    /* ids separated by commas, the spaces between the tokens are null characters now */
+    statement->id_count = 0;
+    bool expect_id = true;
+    for (char* c = statement->id_list; c < close;) {
+        if (*c == ' ' || *c == '\0') {
+            c++;
+        } else if (expect_id) {
+            if (*c == '-')
+                return PREPARE_NEGATIVE_ID;
+            if (!isdigit((unsigned char)*c) || strtoul(c, &c, 10) > UINT32_MAX)
+                return PREPARE_SYNTAX_ERROR;
+            statement->id_count++;
+            expect_id = false;
+        } else {
+            if (*c != ',')
+                return PREPARE_SYNTAX_ERROR;
+            c++;
+            expect_id = true;
+        }
+    }
+
+    /* an empty list or a comma at its end */
+    if (expect_id)
+        return PREPARE_SYNTAX_ERROR;
+
+    return PREPARE_SUCCESS;
+}
+
+/* reads the ids of a list checked by `prepare_id_list()` into `ids` [void] */
+void parse_id_list(Statement* statement, uint32_t* ids) {
+    uint32_t count = 0;
+    for (char* c = statement->id_list; c < statement->id_list_end;) {
+        if (isdigit((unsigned char)*c))
+            ids[count++] = (uint32_t)strtoul(c, &c, 10);
+        else
+            c++;
+    }
+}
+
+/* preparation for the predicate (the tokens after `where`), the matching ids of a predicate on the id are
+ * `low_id` to `high_id`: `id = 5`, `id > 5`, `id >= 5`, `id < 5`, `id <= 5` or `id between 5 and 10`,
+ * or a list of ids: `id in (1, 5, 9)` [PrepareResult] */
+PrepareResult prepare_where(Statement* statement) {
+    char* column = strtok(NULL, " ");
+    char* operator = strtok(NULL, " ");
+
+    if (column != NULL && operator != NULL && strcmp(column, "id") == 0 && strcmp(operator, "in") == 0)
+        return prepare_id_list(statement);
+
+    char* value = strtok(NULL, " ");
+    if (column == NULL || operator == NULL || value == NULL)
+        return PREPARE_SYNTAX_ERROR;
+    if (strcmp(column, "username") == 0 || strcmp(column, "email") == 0)
+        return prepare_where_column(statement, column, operator, value);
+    if (strcmp(column, "id") != 0)
+        return PREPARE_SYNTAX_ERROR;
+    if (value[0] == '-')
+        return PREPARE_NEGATIVE_ID;
+
+    uint32_t id;
+    if (!parse_number(value, &id))
+        return PREPARE_SYNTAX_ERROR;
+
+    statement->low_id = 0;
+    statement->high_id = UINT32_MAX;
+
+    if (strcmp(operator, "=") == 0) {
+        statement->low_id = id;
+        statement->high_id = id;
+    } else if (strcmp(operator, ">=") == 0) {
+        statement->low_id = id;
+    } else if (strcmp(operator, "<=") == 0) {
+        statement->high_id = id;
+    } else if (strcmp(operator, ">") == 0 || strcmp(operator, "<") == 0) {
+        if (id == (operator[0] == '>' ? UINT32_MAX : 0)) {
+            // matches nothing
+            statement->low_id = 1;
+            statement->high_id = 0;
+        } else if (operator[0] == '>') {
+            statement->low_id = id + 1;
+        } else {
+            statement->high_id = id - 1;
+        }
+    } else if (strcmp(operator, "between") == 0) {
+        char* and = strtok(NULL, " ");
+        char* high = strtok(NULL, " ");
+        if (and == NULL || high == NULL || strcmp(and, "and") != 0)
+            return PREPARE_SYNTAX_ERROR;
+        if (high[0] == '-')
+            return PREPARE_NEGATIVE_ID;
+        if (!parse_number(high, &statement->high_id))
+            return PREPARE_SYNTAX_ERROR;
+        statement->low_id = id;
+    } else {
+        return PREPARE_SYNTAX_ERROR;
+    }
+
+    return PREPARE_SUCCESS;
+}
+
+/* preparation for the 'select' statement, `select [where <predicate>] [limit N] [offset N]`
+ * or `select count(*) [where <predicate>]` [PrepareResult] */
+PrepareResult prepare_select(InputBuffer* input_buffer, Statement* statement) {
+    statement->type = STATEMENT_SELECT;
+    statement->column_predicate = false;
+    statement->id_list = NULL;
+    statement->low_id = 0;
+    statement->high_id = UINT32_MAX;
+    statement->limit = UINT32_MAX;
+    statement->offset = 0;
+    statement->count = false;
+
+    char* keyword = strtok(input_buffer->buffer, " ");
+    if (strcmp(keyword, "select") != 0)
+        return PREPARE_UNRECOGNIZED_STATEMENT;
+
+    char* token = strtok(NULL, " ");
+    if (token != NULL && strcmp(token, "count(*)") == 0) {
+        statement->count = true;
+        token = strtok(NULL, " ");
+    }
+
+    if (token != NULL && strcmp(token, "where") == 0) {
+        PrepareResult result = prepare_where(statement);
+        if (result != PREPARE_SUCCESS)
+            return result;
+        token = strtok(NULL, " ");
+    }
+
+    if (token != NULL && strcmp(token, "limit") == 0 && !statement->count) {
+        if (!parse_number(strtok(NULL, " "), &statement->limit))
+            return PREPARE_SYNTAX_ERROR;
+        token = strtok(NULL, " ");
+    }
+
+    if (token != NULL && strcmp(token, "offset") == 0 && !statement->count) {
+        if (!parse_number(strtok(NULL, " "), &statement->offset))
+            return PREPARE_SYNTAX_ERROR;
+        token = strtok(NULL, " ");
+    }
+
+    if (token != NULL)
+        return PREPARE_SYNTAX_ERROR;
+
+    return PREPARE_SUCCESS;
+}
+
+/* preparation for the 'delete' statement, `delete 5` or `delete where <predicate on id>` [PrepareResult] */
+PrepareResult prepare_delete(InputBuffer* input_buffer, Statement* statement) {
+    statement->type = STATEMENT_DELETE;
+    statement->column_predicate = false;
+    statement->id_list = NULL;
+
+    strtok(input_buffer->buffer, " ");
+    char* argument = strtok(NULL, " ");
+    if (argument == NULL)
+        return PREPARE_SYNTAX_ERROR;
+
+    if (strcmp(argument, "where") != 0) {
+        if (argument[0] == '-')
+            return PREPARE_NEGATIVE_ID;
+        if (!parse_number(argument, &statement->low_id) || strtok(NULL, " ") != NULL)
+            return PREPARE_SYNTAX_ERROR;
+
+        statement->high_id = statement->low_id;
+        return PREPARE_SUCCESS;
+    }
+
+    PrepareResult result = prepare_where(statement);
+    if (result == PREPARE_SUCCESS && (statement->column_predicate || statement->id_list != NULL || strtok(NULL, " ") != NULL))
+        return PREPARE_SYNTAX_ERROR;
+
+    return result;
+}
+
+/* preparation for the 'update' statement, `update 5 set username=bob, email=bob@mail.com`
+ * (either column can be left out) [PrepareResult] */
+PrepareResult prepare_update(InputBuffer* input_buffer, Statement* statement) {
+    statement->type = STATEMENT_UPDATE;
+    statement->update_username = false;
+    statement->update_email = false;
+
+    strtok(input_buffer->buffer, " ");
+    char* id_string = strtok(NULL, " ");
+    char* set = strtok(NULL, " ");
+
+    if (id_string == NULL || set == NULL || strcmp(set, "set") != 0)
+        return PREPARE_SYNTAX_ERROR;
+    if (id_string[0] == '-')
+        return PREPARE_NEGATIVE_ID;
+    if (!parse_number(id_string, &statement->row_to_insert.id))
+        return PREPARE_SYNTAX_ERROR;
+
+    /* `column=value` assignments, separated by commas */
+    char* assignment;
+    while ((assignment = strtok(NULL, " ,")) != NULL) {
+        char* value = strchr(assignment, '=');
+        if (value == NULL || value[1] == '\0')
+            return PREPARE_SYNTAX_ERROR;
+        *value++ = '\0';
+
+        if (strcmp(assignment, "username") == 0 && !statement->update_username) {
+            if (strlen(value) > COLUMN_USERNAME_SIZE)
+                return PREPARE_STRING_TOO_LONG;
+            strcpy(statement->row_to_insert.username, value);
+            statement->update_username = true;
+        } else if (strcmp(assignment, "email") == 0 && !statement->update_email) {
+            if (strlen(value) > COLUMN_EMAIL_SIZE)
+                return PREPARE_STRING_TOO_LONG;
+            strcpy(statement->row_to_insert.email, value);
+            statement->update_email = true;
+        } else {
+            return PREPARE_SYNTAX_ERROR;
+        }
+    }
+
+    if (!statement->update_username && !statement->update_email)
+        return PREPARE_SYNTAX_ERROR;
+
+    return PREPARE_SUCCESS;
+}
+
+/* preparation for the 'create index' statement, `create index on username`, `create index on email`
+ * or `create hash index on id` [PrepareResult] */
+PrepareResult prepare_create_index(InputBuffer* input_buffer, Statement* statement) {
+    statement->type = STATEMENT_CREATE_INDEX;
+    statement->hash_index = false;
+
+    char* keyword = strtok(input_buffer->buffer, " ");
+    char* index = strtok(NULL, " ");
+    if (index != NULL && strcmp(index, "hash") == 0) {
+        statement->hash_index = true;
+        index = strtok(NULL, " ");
+    }
+    char* on = strtok(NULL, " ");
+    char* column = strtok(NULL, " ");
+
+    if (strcmp(keyword, "create") != 0 || index == NULL || on == NULL || column == NULL ||
+        strcmp(index, "index") != 0 || strcmp(on, "on") != 0 || strtok(NULL, " ") != NULL)
+        return PREPARE_SYNTAX_ERROR;
+
+    if (statement->hash_index)
+        return strcmp(column, "id") == 0 ? PREPARE_SUCCESS : PREPARE_SYNTAX_ERROR;
+
+    if (strcmp(column, "username") == 0)
+        statement->column = INDEX_USERNAME;
+    else if (strcmp(column, "email") == 0)
+        statement->column = INDEX_EMAIL;
+    else
+        return PREPARE_SYNTAX_ERROR;
+
+    return PREPARE_SUCCESS;
+}
+
 /* driver function for statement preparation [PrepareResult] */
 PrepareResult prepare_statement(InputBuffer* input_buffer, Statement* statement) {
     if (strncmp(input_buffer->buffer, "insert", 6) == 0)
         return prepare_insert(input_buffer, statement);
-    if (strcmp(input_buffer->buffer, "select") == 0) {
-        statement->type = STATEMENT_SELECT;
-        return PREPARE_SUCCESS;
-    }
+    if (strncmp(input_buffer->buffer, "delete", 6) == 0)
+        return prepare_delete(input_buffer, statement);
+    if (strncmp(input_buffer->buffer, "update", 6) == 0)
+        return prepare_update(input_buffer, statement);
+    if (strncmp(input_buffer->buffer, "select", 6) == 0)
+        return prepare_select(input_buffer, statement);
+    if (strncmp(input_buffer->buffer, "create", 6) == 0)
+        return prepare_create_index(input_buffer, statement);
 
     return PREPARE_UNRECOGNIZED_STATEMENT;
 }
@@ -53,57 +391,462 @@ PrepareResult prepare_statement(InputBuffer* input_buffer, Statement* statement)
 
 /* driver for the prepared (compiled) statement execution [ExecuteResult] */
 ExecuteResult execute_statement(Statement* statement, Table* table) {
+    uint64_t allocations = allocation_count;
+    ExecuteResult result;
     switch (statement->type) {
         case (STATEMENT_INSERT):
-            return execute_insert(statement, table);
+            result = execute_insert(statement, table);
+            break;
         case (STATEMENT_SELECT):
-            return execute_select(statement, table);
+            result = execute_select(statement, table);
+            break;
+        case (STATEMENT_DELETE):
+            result = execute_delete(statement, table);
+            break;
+        case (STATEMENT_UPDATE):
+            result = execute_update(statement, table);
+            break;
+        case (STATEMENT_CREATE_INDEX):
+            result = execute_create_index(statement, table);
+            break;
     }
+
+    /* the statement is complete, logging its changes (commit) */
+    db_commit(table);
+
+    /* pages used by the statement can now be evicted from the buffer pool */
+    pager_release(table->pager);
+
+    statement_allocations = allocation_count - allocations;
+
+    /* the statement's results are written out at once */
+    output_flush();
+
+    return result;
 }
 
 /* executing the 'insert' statement [ExecuteResult] */
 ExecuteResult execute_insert(Statement* statement, Table* table) {
     Row* row_to_insert = &(statement->row_to_insert);
     uint32_t key_to_insert = row_to_insert->id;
-    Cursor* cursor = table_find(table, key_to_insert);
+    Cursor cursor;
+    table_find(table, key_to_insert, &cursor);
 
-    void* node = get_page(table->pager, cursor->page_number);
+    void* node = get_page(table->pager, cursor.page_number);
     uint32_t num_cells = (*leaf_node_num_cells(node));
 
     /* if we have a cursor that's pointing at a cell number lower than the num of cells,
      * it means we found that exact cell somewhere,
      * otherwise it will point to the end, where the new cell will settle */
-    if (cursor->cell_number < num_cells) {
-        uint32_t key_at_index = *leaf_node_key(node, cursor->cell_number);
-        if (key_at_index == key_to_insert)
+    if (cursor.cell_number < num_cells) {
+        uint32_t key_at_index = *leaf_node_key(node, cursor.cell_number);
+        if (key_at_index == key_to_insert) {
+            cursor_close(&cursor);
             return EXECUTE_DUPLICATE_KEY;
+        }
     }
 
-    leaf_node_insert(cursor, row_to_insert->id, row_to_insert);
+    leaf_node_insert(&cursor, row_to_insert->id, row_to_insert);
+    table->row_count++;
+    cursor_close(&cursor);
 
-    free(cursor);
+    index_insert_row(table, row_to_insert);
     printf("Inserted.\n");
 
     return EXECUTE_SUCCESS;
 }
 
-/* executing the 'select' statement [ExecuteResult] */
+/* executing the 'select' statement, the scan starts at the first row in the id range
+ * (found by searching the tree) and stops after the last one or at the limit.
+ * The row counts of the internal nodes answer `count(*)` (the difference of the ranks of
+ * both ends of the range) and skip the `offset` rows without reading them [ExecuteResult] */
 ExecuteResult execute_select(Statement* statement, Table* table) {
-    Cursor* cursor = table_start(table);
+    if (statement->column_predicate)
+        return execute_select_column(statement, table);
+    if (statement->id_list != NULL)
+        return execute_select_ids(statement, table);
+
+    if (table->hash_root_page_number != 0 && statement->low_id == statement->high_id &&
+        !statement->count && statement->offset == 0) {
+        /* a single id is read from its hash bucket instead of searching the tree */
+        Row row;
+        if (statement->limit > 0 && hash_read_row(table, statement->low_id, &row))
+            print_row(&row);
+        return EXECUTE_SUCCESS;
+    }
+
+    if (statement->count) {
+        uint64_t count = 0;
+        if (statement->low_id <= statement->high_id) {
+            uint64_t end = statement->high_id == UINT32_MAX ? table->row_count : table_rank(table, statement->high_id + 1);
+            count = end - table_rank(table, statement->low_id);
+        }
+        output_count(count);
+        return EXECUTE_SUCCESS;
+    }
+
+    Cursor cursor;
+    if (statement->offset == 0)
+        table_seek(table, statement->low_id, &cursor);
+    else
+        table_seek_rank(table, table_rank(table, statement->low_id) + statement->offset, &cursor);
+
+    /* the rows are read a leaf at a time, without copying them */
+    RowBatch batch;
+    uint32_t count = 0;
+    bool done = false;
+    while (!done && count < statement->limit && cursor_read_batch(&cursor, &batch) > 0) {
+        for (uint32_t i = 0; i < batch.count; i++) {
+            if (batch.ids[i] > statement->high_id || count == statement->limit) {
+                done = true;
+                break;
+            }
+
+            print_batch_row(&batch, i);
+            count++;
+        }
+        /* only the cursor's (pinned) leaf has to stay in the buffer pool while scanning */
+        pager_release(table->pager);
+    }
+
+    cursor_close(&cursor);
+
+    return EXECUTE_SUCCESS;
+}
+
+/* executing the 'delete' statement, the rows of one leaf are removed at once,
+ * so every leaf in the range is searched for only once [ExecuteResult] */
+ExecuteResult execute_delete(Statement* statement, Table* table) {
+    uint32_t key = statement->low_id;
+    uint64_t deleted = 0;
+    uint32_t since_spill = 0; // leaves
+
+    while (key <= statement->high_id) {
+        Cursor cursor;
+        table_find(table, key, &cursor);
+        void* node = get_page(table->pager, cursor.page_number);
+        uint32_t num_cells = *leaf_node_num_cells(node);
+
+        if (cursor.cell_number == num_cells) {
+            /* every key of the leaf is smaller, the range continues in the next leaf */
+            uint32_t next_page_number = *leaf_node_next_leaf(node);
+            cursor_close(&cursor);
+            if (next_page_number == 0)
+                break;
+
+            key = *leaf_node_key(get_page(table->pager, next_page_number), 0);
+            continue;
+        }
+
+        uint32_t count = 0;
+        while (cursor.cell_number + count < num_cells &&
+               *leaf_node_key(node, cursor.cell_number + count) <= statement->high_id)
+            count++;
+
+        if (count == 0) {
+            cursor_close(&cursor);
+            break;
+        }
+
+        uint32_t last_key = *leaf_node_key(node, cursor.cell_number + count - 1);
+        bool leaf_end = cursor.cell_number + count == num_cells;
+
+        if (index_exists(table)) {
+            /* the entries of the rows are removed from the indexes first (the rows are read from the leaf) */
+            Cursor row_cursor = cursor;
+            Row row;
+            for (uint32_t i = 0; i < count; i++, row_cursor.cell_number++) {
+                cursor_read_row(&row_cursor, &row);
+                index_delete_row(table, &row);
+            }
+        }
+
+        leaf_node_delete(&cursor, count);
+        table->row_count -= count;
+        deleted += count;
+        since_spill++;
+        cursor_close(&cursor);
+
+        if (!leaf_end || last_key == UINT32_MAX)
+            break; // the next key is bigger than the range
+        key = last_key + 1;
+
+        if (since_spill >= DELETE_SPILL_INTERVAL) {
+            /* the statement stays uncommitted, a crash before its commit leaves every row */
+            pager_spill(table->pager);
+            pager_release(table->pager);
+            since_spill = 0;
+        }
+    }
+
+    printf("Deleted %llu rows.\n", (unsigned long long)deleted);
+
+    return EXECUTE_SUCCESS;
+}
+
+/* executing the 'update' statement [ExecuteResult] */
+ExecuteResult execute_update(Statement* statement, Table* table) {
+    Row* values = &(statement->row_to_insert);
+    Cursor cursor;
+    table_find(table, values->id, &cursor);
+
+    void* node = get_page(table->pager, cursor.page_number);
+    if (cursor.cell_number == *leaf_node_num_cells(node) ||
+        *leaf_node_key(node, cursor.cell_number) != values->id) {
+        cursor_close(&cursor);
+        printf("Updated 0 rows.\n");
+        return EXECUTE_SUCCESS;
+    }
 
     Row row;
-    while (!(cursor->end_of_table)) {
-        deserialize_row(cursor_position(cursor), &row);
-        print_row(&row);
-        cursor_advance(cursor);
+    cursor_read_row(&cursor, &row);
+    Row old_row = row;
+    if (statement->update_username)
+        strcpy(row.username, values->username);
+    if (statement->update_email)
+        strcpy(row.email, values->email);
+
+    leaf_node_update(&cursor, &row);
+    cursor_close(&cursor);
+
+    /* the index entries of the changed columns are moved to the new values */
+    for (uint32_t c = 0; c < INDEX_COLUMNS; c++) {
+        if (table->index_root_page_numbers[c] != 0 && strcmp(index_row_value(&old_row, c), index_row_value(&row, c)) != 0) {
+            index_delete(table, c, &old_row);
+            index_insert(table, c, &row);
+        }
     }
+    if (table->hash_root_page_number != 0)
+        hash_update(table, &row);
+    printf("Updated 1 rows.\n");
+
+    return EXECUTE_SUCCESS;
+}
+
+/* executing the 'select' statement with a predicate on the username or email, the column's index
+ * is searched for the entries with the value's prefix if the column has one and the predicate is an
+ * equality (the rows are then read by their id), otherwise every row of the table is compared [ExecuteResult] */
+ExecuteResult execute_select_column(Statement* statement, Table* table) {
+    uint64_t matches = 0;
+    uint32_t printed = 0;
+    Row row;
+    Predicate predicate;
+    predicate_init(&predicate, statement->column, statement->match, statement->column_value);
+
+    if (statement->match == MATCH_EQUAL && table->index_root_page_numbers[statement->column] != 0) {
+        IndexEntry entry;
+        index_entry_make(&entry, statement->column_value, 0);
+        IndexCursor index_cursor;
+        index_seek(table, statement->column, &entry, &index_cursor);
+
+        while (!index_cursor.end_of_index && index_entry_matches(index_cursor_entry(&index_cursor), statement->column_value)) {
+            /* entries only hold a prefix of the value, the row has the whole value */
+            Cursor cursor;
+            table_find(table, index_cursor_entry(&index_cursor)->id, &cursor);
+            cursor_read_row(&cursor, &row);
+            cursor_close(&cursor);
 
-    free(cursor);
+            if (strcmp(index_row_value(&row, statement->column), statement->column_value) == 0 &&
+                !select_match(statement, &row, &matches, &printed))
+                break;
+            index_cursor_advance(&index_cursor);
+            pager_release(table->pager);
+        }
+
+        index_cursor_close(&index_cursor);
+    } else if (execute_select_column_parallel(statement, table, &predicate)) {
+        return EXECUTE_SUCCESS;
+    } else {
+        select_column_scan(statement, table, &predicate, 0, &matches, &printed);
+    }
+
+    if (statement->count)
+        output_count(matches);
+
+    return EXECUTE_SUCCESS;
+}
+
+/* scans the table for a column predicate from the given key on (serially), the matching rows are
+ * counted and printed with `select_match()` [void] */
+void select_column_scan(Statement* statement, Table* table, const Predicate* predicate, uint32_t key,
+                        uint64_t* matches, uint32_t* printed) {
+    Cursor cursor;
+    table_seek(table, key, &cursor);
+
+    /* the column of a leaf's rows is filtered in place, only matching rows are copied, the
+     * leaves that can't match are passed over by their zone maps */
+    Row row;
+    RowBatch batch;
+    uint16_t selection[ROW_BATCH_MAX_ROWS];
+    bool more = true;
+    while (more && cursor_read_batch_filtered(&cursor, &batch, &predicate->zone, UINT32_MAX) > 0) {
+        uint32_t selected = filter_batch(predicate, &batch, selection);
+        if (statement->count) {
+            *matches += selected;
+        } else {
+            for (uint32_t i = 0; i < selected && more; i++) {
+                row_batch_read_row(&batch, selection[i], &row);
+                more = select_match(statement, &row, matches, printed);
+            }
+        }
+        pager_release(table->pager);
+    }
+
+    cursor_close(&cursor);
+}
+
+/* scans the table for a column predicate on the table's threads (see `table_scan_parallel()`),
+ * every part collects its first matches, and they're merged in key order. The merge goes on with a
+ * serial scan after the last row of the first part that was cut off, so the rows the parts keep
+ * are bounded however many rows match. Returns false if the table isn't scanned in parallel [bool] */
+bool execute_select_column_parallel(Statement* statement, Table* table, const Predicate* predicate) {
+    if (!table_scans_in_parallel(table))
+        return false;
+
+    ColumnScanState* states = malloc(PARALLEL_SCAN_MAX_PARTS * sizeof(ColumnScanState));
+    for (uint32_t p = 0; p < PARALLEL_SCAN_MAX_PARTS; p++) {
+        states[p].statement = statement;
+        states[p].predicate = predicate;
+        states[p].matches = 0;
+        states[p].rows = NULL;
+        states[p].row_count = 0;
+        states[p].row_capacity = 0;
+        states[p].cut_off = false;
+    }
+
+    uint32_t part_count = table_scan_parallel(table, column_scan_batch, states, sizeof(ColumnScanState), &predicate->zone);
+
+    uint64_t matches = 0;
+    uint32_t printed = 0;
+    bool more = true;
+    bool cut_off = false;
+    uint32_t resume_key = 0;
+    for (uint32_t p = 0; p < part_count; p++) {
+        if (statement->count)
+            matches += states[p].matches;
+        for (uint32_t i = 0; i < states[p].row_count && more && !cut_off; i++)
+            more = select_match(statement, &states[p].rows[i], &matches, &printed);
+
+        if (states[p].cut_off && more && !cut_off) {
+            cut_off = true;
+            resume_key = states[p].rows[states[p].row_count - 1].id;
+        }
+        free(states[p].rows);
+    }
+    free(states);
+
+    /* the rest of the table after the part that was cut off (the later parts' rows were dropped) */
+    if (cut_off && resume_key < UINT32_MAX)
+        select_column_scan(statement, table, predicate, resume_key + 1, &matches, &printed);
+
+    if (part_count > 0 && statement->count)
+        output_count(matches);
+    return part_count > 0;
+}
+
+/* filters the rows of a batch by the predicate for a part of a parallel scan (`ColumnScanState`),
+ * returns false once the part has all the rows it can print, or all the rows it can keep [bool] */
+bool column_scan_batch(RowBatch* batch, void* state) {
+    ColumnScanState* scan = state;
+    Statement* statement = scan->statement;
+    uint64_t wanted = (uint64_t)statement->offset + statement->limit;
+    uint32_t kept = wanted < COLUMN_SCAN_PART_ROWS ? wanted : COLUMN_SCAN_PART_ROWS;
+
+    uint16_t selection[ROW_BATCH_MAX_ROWS];
+    uint32_t selected = filter_batch(scan->predicate, batch, selection);
+    scan->matches += selected;
+    if (statement->count)
+        return true;
+
+    for (uint32_t i = 0; i < selected; i++) {
+        if (scan->row_count == scan->row_capacity) {
+            scan->row_capacity = scan->row_capacity == 0 ? 16 : 2 * scan->row_capacity;
+            scan->rows = realloc(scan->rows, scan->row_capacity * sizeof(Row));
+        }
+        row_batch_read_row(batch, selection[i], &scan->rows[scan->row_count++]);
+        if (scan->row_count >= kept) {
+            scan->cut_off = kept < wanted;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* executing the 'select' statement with a list of ids, the ids are sorted and looked up
+ * `SELECT_BATCH_SIZE` at a time by `table_find_batch()`, so the rows are printed in id order
+ * (once, even if the id is in the list more than once) [ExecuteResult] */
+ExecuteResult execute_select_ids(Statement* statement, Table* table) {
+    uint32_t* ids = malloc(statement->id_count * sizeof(uint32_t));
+    parse_id_list(statement, ids);
+    uint32_t count = table_sort_keys(ids, statement->id_count);
+
+    Row* rows = malloc((count < SELECT_BATCH_SIZE ? count : SELECT_BATCH_SIZE) * sizeof(Row));
+    uint64_t matches = 0;
+    uint32_t printed = 0;
+    bool more = true;
+
+    for (uint32_t first = 0; first < count && more; first += SELECT_BATCH_SIZE) {
+        uint32_t batch = count - first < SELECT_BATCH_SIZE ? count - first : SELECT_BATCH_SIZE;
+        uint32_t found = table_find_batch(table, ids + first, batch, rows);
+
+        for (uint32_t i = 0; i < found && more; i++)
+            more = select_match(statement, &rows[i], &matches, &printed);
+        /* only the leaves of one batch are kept in the buffer pool */
+        pager_release(table->pager);
+    }
+
+    if (statement->count)
+        output_count(matches);
+
+    free(rows);
+    free(ids);
+    return EXECUTE_SUCCESS;
+}
+
+/* handles a row that matched a column predicate (or a list of ids), it's counted, skipped (`offset`) or printed,
+ * returns false when the limit is reached [bool] */
+bool select_match(Statement* statement, Row* row, uint64_t* matches, uint32_t* printed) {
+    if (*printed >= statement->limit)
+        return false;
+
+    (*matches)++;
+    if (statement->count || *matches <= statement->offset)
+        return true;
+
+    print_row(row);
+    (*printed)++;
+    return *printed < statement->limit;
+}
+
+/* executing the 'create index' statement, the index is built from the sorted entries of
+ * all rows (not by inserting them one by one), the hash index by adding every row to it [ExecuteResult] */
+ExecuteResult execute_create_index(Statement* statement, Table* table) {
+    if (statement->hash_index) {
+        if (table->hash_root_page_number != 0)
+            return EXECUTE_INDEX_EXISTS;
+
+        uint32_t count = hash_create(table);
+        printf("Created hash index on id (%u rows).\n", count);
+        return EXECUTE_SUCCESS;
+    }
+
+    if (table->index_root_page_numbers[statement->column] != 0)
+        return EXECUTE_INDEX_EXISTS;
+
+    uint32_t count = index_create(table, statement->column);
+    printf("Created index on %s (%u rows).\n", index_column_name(statement->column), count);
 
     return EXECUTE_SUCCESS;
 }
 
-/* helper function to print a row [void] */
+/* helper function to print a row (into the output buffer, see output.h) [void] */
 void print_row(Row* row) {
-    printf("(%d, %s, %s)\n", row->id, row->username, row->email);
+    output_row(row->id, row->username, strlen(row->username), row->email, strlen(row->email));
+}
+
+/* prints a row of a batch straight from its leaf, the same way as `print_row()` [void] */
+void print_batch_row(RowBatch* batch, uint32_t index) {
+    output_row(batch->ids[index], batch->usernames[index], batch->username_lengths[index],
+               batch->emails[index], batch->email_lengths[index]);
 }
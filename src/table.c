@@ -1,198 +1,606 @@
 #include "table.h"
 #include "btree.h"
-
-/* copy values from some 'Row' object to the block of memory (serialize the data) [void] */
-void serialize_row(Row* source, void* destination) {
-    memcpy(destination+ID_OFFSET, &(source->id), ID_SIZE);
-    memcpy(destination+USERNAME_OFFSET, &(source->username), USERNAME_SIZE);
-    memcpy(destination+EMAIL_OFFSET, &(source->email), EMAIL_SIZE);
+#include "search.h"
+
+/* copy values from some 'Row' object to the block of memory (serialize the data) as a variable
+ * length record (the id isn't part of the record, it's the key), returns the record size [uint32_t] */
+uint32_t serialize_row(Row* source, void* destination) {
+    uint8_t username_length = strlen(source->username);
+    uint8_t email_length = strlen(source->email);
+    uint8_t* record = destination;
+
+    record[0] = username_length;
+    memcpy(record + RECORD_LENGTH_SIZE, source->username, username_length);
+    record += RECORD_LENGTH_SIZE + username_length;
+    record[0] = email_length;
+    memcpy(record + RECORD_LENGTH_SIZE, source->email, email_length);
+
+    return 2 * RECORD_LENGTH_SIZE + username_length + email_length;
 }
 
-/* copy values from the memory block into a 'Row' object (deserialize the data) [void] */
+/* copy values from the record into a 'Row' object (deserialize the data), the id
+ * isn't part of the record [void] */
 void deserialize_row(void* source, Row* destination) {
-    // passing addresses to memcpy (destination, source, size_t n)
-    memcpy(&(destination->id), source+ID_OFFSET, ID_SIZE);
-    memcpy(&(destination->username), source+USERNAME_OFFSET, USERNAME_SIZE);
-    memcpy(&(destination->email), source+EMAIL_OFFSET, EMAIL_SIZE);
-}
-
-/* returns the address to the raw page data (bytes from memory) of a given page number [void*] */
-void* get_page(Pager* pager, uint32_t page_number) {
-    if (page_number > TABLE_MAX_PAGES) {
-        printf("Tried to fetch page number out of bounds. %d > %d\n", page_number, TABLE_MAX_PAGES);
-        exit(EXIT_FAILURE);
-    }
-
-    if (pager->pages[page_number] == NULL) {
-        // Cache miss. Allocate memory and load from file.
-        void* page = (void *) malloc(PAGE_SIZE);
-        uint32_t num_pages = pager->file_size / PAGE_SIZE;
-
-        // We might save a partial page at the end of the file
-        if (pager->file_size % PAGE_SIZE)
-            num_pages += 1;
-
-        if (page_number <= num_pages) {
-            lseek(pager->file_descriptor, page_number * PAGE_SIZE, SEEK_SET);
-            ssize_t bytes_read = read(pager->file_descriptor, page, PAGE_SIZE);
-            if (bytes_read == -1) {
-                printf("Error reading file: %d\n", errno);
-                exit(EXIT_FAILURE);
-            }
-        }
+    uint8_t* record = source;
 
-        pager->pages[page_number] = page;
+    uint8_t username_length = record[0];
+    memcpy(destination->username, record + RECORD_LENGTH_SIZE, username_length);
+    destination->username[username_length] = 0;
+    record += RECORD_LENGTH_SIZE + username_length;
 
-        if (page_number >= pager->page_count)
-            pager->page_count = page_number + 1;
-    }
-
-    return pager->pages[page_number];
+    uint8_t email_length = record[0];
+    memcpy(destination->email, record + RECORD_LENGTH_SIZE, email_length);
+    destination->email[email_length] = 0;
 }
 
-/* returns the index of the first unused page number [uint32_t] */
-uint32_t get_unused_page_number(Pager* pager) {
-    return pager->page_count;
+/* returns the size of a serialized row (record) [uint32_t] */
+uint32_t serialized_row_size(void* source) {
+    uint8_t* record = source;
+    uint32_t username_length = record[0];
+    uint32_t email_length = record[RECORD_LENGTH_SIZE + username_length];
+
+    return 2 * RECORD_LENGTH_SIZE + username_length + email_length;
 }
 
 /* immediately calls 'pager_open()' that reads data from the database file
 and fills the table with that cached data [Table*] */
-Table* db_open(const char* filename) {
-    Pager* pager = pager_open(filename);
+Table* db_open(const char* filename, DbOptions* options) {
+    Pager* pager = pager_open(filename, options->pager_mode, options->cache_pages, options->sync_level);
 
     Table* table = malloc(sizeof(Table));
     table->pager = pager;
+    table->root_page_number = 1;
     table->internal_node_layers = 0;
+    table->row_count = 0;
+    for (uint32_t c = 0; c < INDEX_COLUMNS; c++)
+        table->index_root_page_numbers[c] = 0;
+    table->hash_root_page_number = 0;
+    table->hint_page_number = 0;
+    table->thread_count = options->threads > 0 ? options->threads : pool_default_threads();
+    table->pool = NULL;
 
     if (pager->page_count == 0) {
-        // New database file. Initialize page 0 as leaf node.
-        void* root_node = get_page(pager, 0);
+        // New database file. Page 0 is the header, initialize page 1 as leaf node.
+        get_page(pager, 0);
+        void* root_node = get_page(pager, 1);
+        pager_mark_dirty(pager, 1);
         initialize_leaf_node(root_node);
         set_node_root(root_node, true);
+        db_commit(table);
+    } else {
+        header_read(table);
     }
 
     return table;
 }
 
+/* writes the table metadata into the header and commits the current statement [void] */
+void db_commit(Table* table) {
+    header_write(table);
+    pager_commit(table->pager);
+}
+
+/* commits the pages written so far by a build that isn't finished (a bulk import or an index build).
+ * The pages it took from the free list (or the end of the file) are in use, so the header gets the
+ * current free list head and page count, but it keeps its roots: an interrupted build leaves the
+ * table and its indexes as they were, and only loses the pages it wrote [void] */
+void db_commit_build(Table* table) {
+    Pager* pager = table->pager;
+    void* header = get_page(pager, 0);
+
+    if (*(uint32_t*)(header + HEADER_PAGE_COUNT_OFFSET) != pager->page_count ||
+        *(uint32_t*)(header + HEADER_FREE_LIST_OFFSET) != pager->free_list_head) {
+        pager_mark_dirty(pager, 0);
+        *(uint32_t*)(header + HEADER_PAGE_COUNT_OFFSET) = pager->page_count;
+        *(uint32_t*)(header + HEADER_FREE_LIST_OFFSET) = pager->free_list_head;
+    }
+    pager_commit(pager);
+}
+
 /* this function will flush (write) the cache to the file, 
 it will free the memory from the pager and table data structures,
 and close the database file at the end [void] */
 void db_close(Table* table) {
-    Pager* pager = table->pager;
+    if (table->pool != NULL)
+        pool_destroy(table->pool);
+    pager_close(table->pager);
+    free(table);
+}
 
-    for (uint32_t i = 0; i < pager->page_count; i++) {
-        if (pager->pages[i] == NULL) {
-          continue;
-        }
-        pager_flush(pager, i);
-        // free(pager->pages[i]);
-        // pager->pages[i] = NULL;
+
+/* Database header handling --------- */
+
+/* reads the table metadata from the header (page 0), files written before the header
+ * existed are converted [void] */
+void header_read(Table* table) {
+    void* header = get_page(table->pager, 0);
+
+    if (*(uint32_t*)(header + HEADER_MAGIC_OFFSET) != DB_HEADER_MAGIC) {
+        header_migrate(table);
+        return;
     }
 
-    // closing the database file
-    int result = close(pager->file_descriptor);
-    if (result == -1) {
-        printf("Error closing db file.\n");
+    uint32_t version = *(uint32_t*)(header + HEADER_VERSION_OFFSET);
+    uint32_t page_size = *(uint32_t*)(header + HEADER_PAGE_SIZE_OFFSET);
+    if (version > DB_FORMAT_VERSION || page_size != PAGE_SIZE) {
+        printf("Unsupported database file (format version %d, page size %d).\n", version, page_size);
         exit(EXIT_FAILURE);
     }
 
-    // Free memory
-    for (uint32_t i = 0; i < pager->page_count; i++) {
-        void* page = pager->pages[i];
-        if (page) {
-            free(page);
-            pager->pages[i] = NULL;
-        }
+    table->root_page_number = *(uint32_t*)(header + HEADER_ROOT_PAGE_OFFSET);
+    table->internal_node_layers = *(uint32_t*)(header + HEADER_TREE_DEPTH_OFFSET);
+    table->pager->free_list_head = *(uint32_t*)(header + HEADER_FREE_LIST_OFFSET);
+    table->row_count = *(uint64_t*)(header + HEADER_ROW_COUNT_OFFSET);
+    /* files before version 5 have no indexes (nothing was stored after the row count) */
+    for (uint32_t c = 0; c < INDEX_COLUMNS; c++)
+        table->index_root_page_numbers[c] = version < 5 ? 0 : ((uint32_t*)(header + HEADER_INDEX_ROOTS_OFFSET))[c];
+    table->hash_root_page_number = version < 6 ? 0 : *(uint32_t*)(header + HEADER_HASH_ROOT_OFFSET);
+
+    /* pages after the committed page count (the memory mapped file grows in bigger steps) aren't used */
+    uint32_t page_count = *(uint32_t*)(header + HEADER_PAGE_COUNT_OFFSET);
+    if (page_count < table->pager->page_count)
+        table->pager->page_count = page_count;
+
+    if (version < DB_FORMAT_VERSION) {
+        /* versions 5 and 6 only added index roots to the header, the tree is the same as in version 4 */
+        if (version < 4)
+            table->row_count = header_upgrade(table, version);
+        db_commit(table);
+        pager_release(table->pager);
     }
-    free(pager);
 }
 
+/* writes the table metadata into the header (page 0) if it changed [void] */
+void header_write(Table* table) {
+    Pager* pager = table->pager;
+    void* header = get_page(pager, 0);
+
+    if (*(uint32_t*)(header + HEADER_MAGIC_OFFSET) == DB_HEADER_MAGIC &&
+        *(uint32_t*)(header + HEADER_VERSION_OFFSET) == DB_FORMAT_VERSION &&
+        *(uint32_t*)(header + HEADER_PAGE_COUNT_OFFSET) == pager->page_count &&
+        *(uint32_t*)(header + HEADER_ROOT_PAGE_OFFSET) == table->root_page_number &&
+        *(uint32_t*)(header + HEADER_TREE_DEPTH_OFFSET) == table->internal_node_layers &&
+        *(uint32_t*)(header + HEADER_FREE_LIST_OFFSET) == table->pager->free_list_head &&
+        *(uint64_t*)(header + HEADER_ROW_COUNT_OFFSET) == table->row_count &&
+        memcmp(header + HEADER_INDEX_ROOTS_OFFSET, table->index_root_page_numbers, INDEX_COLUMNS * sizeof(uint32_t)) == 0 &&
+        *(uint32_t*)(header + HEADER_HASH_ROOT_OFFSET) == table->hash_root_page_number)
+        return;
+
+    pager_mark_dirty(pager, 0);
+    *(uint32_t*)(header + HEADER_MAGIC_OFFSET) = DB_HEADER_MAGIC;
+    *(uint32_t*)(header + HEADER_VERSION_OFFSET) = DB_FORMAT_VERSION;
+    *(uint32_t*)(header + HEADER_PAGE_SIZE_OFFSET) = PAGE_SIZE;
+    *(uint32_t*)(header + HEADER_PAGE_COUNT_OFFSET) = pager->page_count;
+    *(uint32_t*)(header + HEADER_ROOT_PAGE_OFFSET) = table->root_page_number;
+    *(uint32_t*)(header + HEADER_TREE_DEPTH_OFFSET) = table->internal_node_layers;
+    *(uint32_t*)(header + HEADER_FREE_LIST_OFFSET) = table->pager->free_list_head;
+    *(uint64_t*)(header + HEADER_ROW_COUNT_OFFSET) = table->row_count;
+    memcpy(header + HEADER_INDEX_ROOTS_OFFSET, table->index_root_page_numbers, INDEX_COLUMNS * sizeof(uint32_t));
+    *(uint32_t*)(header + HEADER_HASH_ROOT_OFFSET) = table->hash_root_page_number;
+}
 
-/* Pager handling --------- */
+/* converts a file without the header (the root used to be page 0): the root is moved
+ * to a new page and the tree depth and row count are counted once [void] */
+void header_migrate(Table* table) {
+    Pager* pager = table->pager;
 
-/* opens a file and assigns values to the Pager structure (file_descriptor, file_size, pages) [Pager*] */
-Pager* pager_open(const char* filename) {
-    int fd = open(filename,
-                  O_RDWR |    // Read/Write mode
-                  O_CREAT,    // Create file if it does not exist
-                  S_IWUSR |   // User write permission
-                  S_IRUSR);   // User read permission
+    uint32_t root_page_number = get_unused_page_number(pager);
+    void* old_root = get_page(pager, 0);
+    void* root = get_page(pager, root_page_number);
+    pager_mark_dirty(pager, root_page_number);
+    memcpy(root, old_root, PAGE_SIZE);
+    table->root_page_number = root_page_number;
+
+    /* everything happens in one statement (no `pager_release()` before the commit) */
+    table->row_count = header_upgrade(table, 1);
+
+    get_page(pager, 0);
+    pager_mark_dirty(pager, 0);
+    memset(get_page(pager, 0), 0, PAGE_SIZE);
+    db_commit(table);
+    pager_release(pager);
+}
 
-    if (fd == -1) {
-        printf("Unable to open file\n");
-        exit(EXIT_FAILURE);
-    }
+/* converts the tree of an older format `version` into the current node layout, returns the number of rows.
+ * The leaves are converted in place (a version 1 leaf holds at most 13 rows, so they always fit into the
+ * same page) and the internal levels are rebuilt above them (the internal nodes of version 3 had more
+ * children than the current ones can hold), the old internal pages go on the free list (and are reused).
+ * All nodes are converted in one statement (committed by the caller together with the new
+ * format version), so an interrupted upgrade leaves the file unchanged [uint64_t] */
+uint64_t header_upgrade(Table* table, uint32_t version) {
+    Pager* pager = table->pager;
+    void* root = get_page(pager, table->root_page_number);
 
-    // lseek() returns the length of a file from the beggining up till the given offset in 'off_t'
-    off_t file_size = lseek(fd, 0, SEEK_END);
+    table->internal_node_layers = 0;
+    if (get_node_type(root) == NODE_LEAF) {
+        pager_mark_dirty(pager, table->root_page_number);
+        header_upgrade_leaf(root, version);
+        return *leaf_node_num_cells(root);
+    }
 
+    /* the leaves in key order, there can't be more of them than pages */
+    UpgradeNode* nodes = malloc(pager->page_count * sizeof(UpgradeNode));
+    uint32_t count = 0;
+    header_upgrade_collect(table, table->root_page_number, version, nodes, &count);
+
+    uint64_t rows = 0;
+    for (uint32_t i = 0; i < count; i++)
+        rows += nodes[i].rows;
+
+    if (count == 1) {
+        /* a single leaf becomes the root */
+        pager_mark_dirty(pager, table->root_page_number);
+        memcpy(root, get_page(pager, nodes[0].page_number), PAGE_SIZE);
+        set_node_root(root, true);
+        pager_free_page(pager, nodes[0].page_number);
+        free(nodes);
+        return rows;
+    }
 
-    Pager* pager = malloc(sizeof(Pager));
-    pager->file_descriptor = fd;
-    pager->file_size = file_size;
-    pager->page_count = (file_size / PAGE_SIZE);
+    /* every level divides the nodes below it evenly between as few internal nodes as possible,
+     * the nodes of a level replace the nodes below them in the array, the last level is the root */
+    while (count > 1) {
+        uint32_t node_count = (count + INTERNAL_NODE_MAX_CELLS) / (INTERNAL_NODE_MAX_CELLS + 1);
+        uint32_t start = 0;
+
+        for (uint32_t n = 0; n < node_count; n++) {
+            uint32_t end = (uint64_t)count * (n + 1) / node_count;
+            uint32_t page_number = node_count == 1 ? table->root_page_number : get_unused_page_number(pager);
+            void* node = get_page(pager, page_number);
+            pager_mark_dirty(pager, page_number);
+            initialize_internal_node(node);
+            set_node_root(node, node_count == 1);
+
+            uint32_t num_keys = end - start - 1;
+            uint32_t node_rows = nodes[end - 1].rows;
+            *internal_node_num_keys(node) = num_keys;
+            for (uint32_t i = 0; i < num_keys; i++) {
+                internal_node_children(node)[i] = nodes[start + i].page_number;
+                internal_node_keys(node)[i] = nodes[start + i].max_key;
+                internal_node_rows(node)[i] = nodes[start + i].rows;
+                node_rows += nodes[start + i].rows;
+            }
+            *internal_node_right_child(node) = nodes[end - 1].page_number;
+            *internal_node_right_child_rows(node) = nodes[end - 1].rows;
 
-    // ! 'file_size' needs to be divisible with 'PAGE_SIZE', otherwise it means that there was trouble writing down the full pages
-    if (file_size % PAGE_SIZE != 0) {
-        printf("Db file is not a whole number of pages. Corrupt file.\n");
-        exit(EXIT_FAILURE);
-    }
+            /* `n` <= `start`, the children were read already */
+            nodes[n] = (UpgradeNode){ page_number, nodes[end - 1].max_key, node_rows };
+            start = end;
+        }
 
-    for (uint32_t i = 0; i < TABLE_MAX_PAGES; i++) {
-        pager->pages[i] = NULL;
+        count = node_count;
+        table->internal_node_layers++;
     }
 
-    return pager;
+    free(nodes);
+    return rows;
 }
 
-/* this function is called upon closing the database, it flushes (writes) database data onto the disk (file) [void] */
-void pager_flush(Pager* pager, uint32_t page_number) {
-    if (pager->pages[page_number] == NULL) {
-        printf("Tried to flush null page.\n");
-        exit(EXIT_FAILURE);
+/* converts the leaves under `page_number` (in key order) and appends them to `leaves`,
+ * the old internal nodes are freed, except the root (its page stays the root) [void] */
+void header_upgrade_collect(Table* table, uint32_t page_number, uint32_t version, UpgradeNode* leaves, uint32_t* leaf_count) {
+    Pager* pager = table->pager;
+    void* node = get_page(pager, page_number);
+
+    if (get_node_type(node) == NODE_LEAF) {
+        pager_mark_dirty(pager, page_number);
+        header_upgrade_leaf(node, version);
+
+        uint32_t num_cells = *leaf_node_num_cells(node);
+        if (num_cells == 0)
+            return; // only the root can be empty, the upgrade of a leaf root doesn't come here
+        leaves[(*leaf_count)++] = (UpgradeNode){ page_number, *leaf_node_key(node, num_cells - 1), num_cells };
+        return;
     }
 
-    off_t offset = lseek(pager->file_descriptor, page_number * PAGE_SIZE, SEEK_SET);
+    /* the number of keys and the right child are at the same place in every version */
+    uint32_t num_keys = *internal_node_num_keys(node);
+    for (uint32_t i = 0; i <= num_keys; i++)
+        header_upgrade_collect(table, header_upgrade_child(node, i, version), version, leaves, leaf_count);
 
-    if (offset == -1) {
-        printf("Error seeking: %d.\n", errno);
-        exit(EXIT_FAILURE);
+    if (page_number != table->root_page_number)
+        pager_free_page(pager, page_number);
+}
+
+/* returns the page number of a child of an internal node of an older format `version` [uint32_t] */
+uint32_t header_upgrade_child(void* node, uint32_t child_number, uint32_t version) {
+    if (child_number == *internal_node_num_keys(node))
+        return *internal_node_right_child(node);
+    if (version < 3)
+        return *(uint32_t*)(node + V2_INTERNAL_NODE_HEADER_SIZE + child_number * V2_INTERNAL_NODE_CELL_SIZE);
+    return *(uint32_t*)(node + V3_INTERNAL_NODE_CHILDREN_OFFSET + child_number * sizeof(uint32_t));
+}
+
+/* converts a leaf of an older format `version`: version 1 leaves (cells with fixed size rows) become
+ * slotted pages, version 2 leaves get their keys as one array, version 3 leaves are the same [void] */
+void header_upgrade_leaf(void* node, uint32_t version) {
+    if (version >= 3)
+        return;
+
+    uint8_t old_node[PAGE_SIZE];
+    memcpy(old_node, node, PAGE_SIZE);
+    uint32_t num_cells = *leaf_node_num_cells(old_node);
+
+    if (version == 2) {
+        /* the slots take the same space as the keys and the record directory, so the records stay where they are */
+        for (uint32_t i = 0; i < num_cells; i++) {
+            void* slot = old_node + V2_LEAF_NODE_HEADER_SIZE + i * V2_LEAF_NODE_SLOT_SIZE;
+            *leaf_node_key(node, i) = *(uint32_t*)slot;
+            *leaf_node_record_offset(node, i) = *(uint16_t*)(slot + sizeof(uint32_t));
+            *leaf_node_record_length(node, i) = *(uint16_t*)(slot + sizeof(uint32_t) + sizeof(uint16_t));
+        }
+        return;
     }
 
-    ssize_t bytes_written = write(pager->file_descriptor, pager->pages[page_number], PAGE_SIZE);
+    initialize_leaf_node(node);
+    set_node_root(node, is_node_root(old_node));
+    *leaf_node_next_leaf(node) = *leaf_node_next_leaf(old_node);
 
-    if (bytes_written == -1) {
-        printf("Error writing: %d.\n", errno);
-        exit(EXIT_FAILURE);
+    for (uint32_t i = 0; i < num_cells; i++) {
+        void* cell = old_node + V1_LEAF_NODE_HEADER_SIZE + i * V1_LEAF_NODE_CELL_SIZE;
+        Row row;
+        memcpy(&row.id, cell + sizeof(uint32_t) + ID_OFFSET, ID_SIZE);
+        memcpy(row.username, cell + sizeof(uint32_t) + USERNAME_OFFSET, USERNAME_SIZE);
+        memcpy(row.email, cell + sizeof(uint32_t) + EMAIL_OFFSET, EMAIL_SIZE);
+
+        uint8_t record[ROW_MAX_SIZE];
+        uint32_t length = serialize_row(&row, record);
+        leaf_node_place_cell(node, i, *(uint32_t*)cell, record, length);
     }
 }
 
+/* prints the table metadata stored in the header [void] */
+void print_header(Table* table) {
+    void* header = get_page(table->pager, 0);
+
+    printf("database header:\n");
+    printf("  - format version: %d\n", *(uint32_t*)(header + HEADER_VERSION_OFFSET));
+    printf("  - page size: %d\n", *(uint32_t*)(header + HEADER_PAGE_SIZE_OFFSET));
+    printf("  - page count: %d\n", *(uint32_t*)(header + HEADER_PAGE_COUNT_OFFSET));
+    printf("  - root page number: %d\n", *(uint32_t*)(header + HEADER_ROOT_PAGE_OFFSET));
+    printf("  - tree depth: %d\n", *(uint32_t*)(header + HEADER_TREE_DEPTH_OFFSET));
+    printf("  - free list head: %d\n", *(uint32_t*)(header + HEADER_FREE_LIST_OFFSET));
+    printf("  - row count: %lu\n", *(uint64_t*)(header + HEADER_ROW_COUNT_OFFSET));
+    printf("  - username index root: %d\n", ((uint32_t*)(header + HEADER_INDEX_ROOTS_OFFSET))[INDEX_USERNAME]);
+    printf("  - email index root: %d\n", ((uint32_t*)(header + HEADER_INDEX_ROOTS_OFFSET))[INDEX_EMAIL]);
+    printf("  - hash index root: %d\n", *(uint32_t*)(header + HEADER_HASH_ROOT_OFFSET));
+}
+
 
 /* Cursor handling --------- */
 
-/* creates a cursor object that points to the first row of node with the min key (0) [Cursor*] */
-Cursor* table_start(Table* table) {
-    Cursor* cursor = table_find(table, 0);
+/* positions the cursor (the caller's) at the first row of the table [void] */
+void table_start(Table* table, Cursor* cursor) {
+    table_seek(table, 0, cursor);
+}
+
+/* positions the cursor at the first row with a key that isn't smaller than the given key,
+ * it's at the end of the table if there is no such row [void] */
+void table_seek(Table* table, uint32_t key, Cursor* cursor) {
+    table_find(table, key, cursor);
 
     void* page = get_page(table->pager, cursor->page_number);
     uint32_t num_cells = *leaf_node_num_cells(page);
-    cursor->end_of_table = (num_cells == 0);
+    if (num_cells == 0)
+        cursor->end_of_table = true;
+    else if (cursor->cell_number == num_cells) {
+        /* every key of the leaf is smaller, the row is the first one of the next leaf */
+        cursor->cell_number = num_cells - 1;
+        cursor_advance(cursor);
+    }
+}
+
+/* returns the number of rows with a key smaller than the given key (the rank of the key), the row
+ * counts of the children before the searched child are added up on the way down [uint64_t] */
+uint64_t table_rank(Table* table, uint32_t key) {
+    uint64_t rank = 0;
+    void* node = get_page(table->pager, table->root_page_number);
+
+    while (get_node_type(node) == NODE_INTERNAL) {
+        uint32_t child_index = internal_node_find_child(node, key);
+        for (uint32_t i = 0; i < child_index; i++)
+            rank += internal_node_rows(node)[i];
+        node = get_page(table->pager, *internal_node_child(node, child_index));
+    }
+
+    return rank + key_search(leaf_node_keys(node), *leaf_node_num_cells(node), key);
+}
+
+/* positions the cursor at the row at the given rank (the first row is at 0), the children
+ * are skipped by their row counts on the way down, it's at the end of the table if the table
+ * has fewer rows [void] */
+void table_seek_rank(Table* table, uint64_t rank, Cursor* cursor) {
+    cursor->table = table;
+    cursor->end_of_table = false;
+    cursor->depth = 0;
+
+    uint32_t page_number = table->root_page_number;
+    uint32_t frame_index;
+    void* node = get_page_frame(table->pager, page_number, &frame_index);
+    while (get_node_type(node) == NODE_INTERNAL) {
+        if (cursor->depth == BTREE_MAX_DEPTH) {
+            printf("Tree is deeper than %d levels.\n", BTREE_MAX_DEPTH);
+            exit(EXIT_FAILURE);
+        }
+        cursor->path[cursor->depth++] = page_number;
+
+        uint32_t num_keys = *internal_node_num_keys(node);
+        uint32_t child_index = 0;
+        while (child_index < num_keys && rank >= internal_node_rows(node)[child_index])
+            rank -= internal_node_rows(node)[child_index++];
 
-    return cursor;
+        page_number = *internal_node_child(node, child_index);
+        node = get_page_frame(table->pager, page_number, &frame_index);
+    }
+
+    cursor->page_number = page_number;
+    pager_pin_frame(table->pager, frame_index);
+
+    /* a rank past the last row ends in the rightmost leaf */
+    uint32_t num_cells = *leaf_node_num_cells(node);
+    cursor->cell_number = rank < num_cells ? rank : num_cells;
+    cursor->end_of_table = rank >= num_cells;
 }
 
-/* creates a cursor object that points to the row with a given key [Cursor*] */
-Cursor* table_find(Table* table, uint32_t key) {
+/* positions the cursor (the caller's) at the row with a given key, or where it would be
+ * inserted, the cursor's leaf is pinned until `cursor_close()` [void] */
+void table_find(Table* table, uint32_t key, Cursor* cursor) {
+    if (table_find_hint(table, key, cursor))
+        return;
+
     uint32_t root_page_number = table->root_page_number;
     void* root_node = get_page(table->pager, root_page_number);
 
     if (get_node_type(root_node) == NODE_LEAF)
-        return leaf_node_find(table, root_page_number, key);
+        leaf_node_find(table, root_page_number, key, cursor);
     else {
         /* This means that there are 2 or more leaf nodes, so we start searching
          * the internal node */
-        return internal_node_find(table, root_page_number, key);
+        internal_node_find(table, root_page_number, key, cursor);
+    }
+
+    /* remembering the leaf (and its path) for the next search */
+    table->hint_page_number = cursor->page_number;
+    memcpy(table->hint_path, cursor->path, cursor->depth * sizeof(uint32_t));
+    table->hint_depth = cursor->depth;
+}
+
+/* positions the cursor in the leaf found by the previous search if the key belongs to it,
+ * that's when the key is between the leaf's first and last key, or after the last key of
+ * the rightmost leaf (sequential inserts), returns false when the tree has to be searched [bool] */
+bool table_find_hint(Table* table, uint32_t key, Cursor* cursor) {
+    if (table->hint_page_number == 0)
+        return false;
+
+    void* node = get_page(table->pager, table->hint_page_number);
+    uint32_t num_cells = *leaf_node_num_cells(node);
+    if (num_cells == 0 || key < *leaf_node_key(node, 0))
+        return false;
+    if (key > *leaf_node_key(node, num_cells - 1) && *leaf_node_next_leaf(node) != 0)
+        return false;
+
+    leaf_node_find(table, table->hint_page_number, key, cursor);
+    memcpy(cursor->path, table->hint_path, table->hint_depth * sizeof(uint32_t));
+    cursor->depth = table->hint_depth;
+    return true;
+}
+
+/* forgets the leaf of the previous search, the leaves and paths change when nodes split
+ * (or the tree is rebuilt) [void] */
+void table_clear_hint(Table* table) {
+    table->hint_page_number = 0;
+}
+
+/* `qsort()` comparator for keys [int] */
+int compare_keys(const void* a, const void* b) {
+    uint32_t key_a = *(const uint32_t*)a;
+    uint32_t key_b = *(const uint32_t*)b;
+
+    return (key_a > key_b) - (key_a < key_b);
+}
+
+/* sorts the keys and removes the duplicates, returns the number of distinct keys [uint32_t] */
+uint32_t table_sort_keys(uint32_t* keys, uint32_t count) {
+    if (count == 0)
+        return 0;
+
+    qsort(keys, count, sizeof(uint32_t), compare_keys);
+
+    uint32_t distinct = 1;
+    for (uint32_t i = 1; i < count; i++) {
+        if (keys[i] != keys[distinct - 1])
+            keys[distinct++] = keys[i];
     }
+    return distinct;
+}
+
+/* looks up a batch of keys and reads the rows that exist into `rows` (in key order), the keys
+ * are sorted and deduplicated in place first, returns the number of rows found.
+ * The keys share their searches: one search from the root finds the lowest internal node
+ * (the parent of the leaves) of the smallest remaining key, and the leaves of all keys in that
+ * node's range are found in it, in one pass over its keys. The leaves are then handled
+ * `BATCH_PREFETCH_LEAVES` at a time in stages, so the cache misses of a stage overlap instead of
+ * waiting for one another: the key arrays of all leaves are prefetched, then the keys are searched
+ * (every key of a leaf from the previous key's cell) and the records found are prefetched, then the
+ * records are read. The leaves stay in the buffer pool until the caller's `pager_release()` [uint32_t] */
+uint32_t table_find_batch(Table* table, uint32_t* keys, uint32_t count, Row* rows) {
+    Pager* pager = table->pager;
+    count = table_sort_keys(keys, count);
+
+    /* the records found in the current leaves */
+    void** records = malloc(count * sizeof(void*));
+
+    uint32_t found = 0;
+    uint32_t i = 0;
+    while (i < count) {
+        /* the parent of the leaf of `keys[i]` (none if the root is a leaf) and the largest key of its range */
+        void* parent = NULL;
+        uint32_t parent_high = UINT32_MAX;
+        uint32_t high = UINT32_MAX;
+        uint32_t page_number = table->root_page_number;
+        void* node = get_page(pager, page_number);
+        while (get_node_type(node) == NODE_INTERNAL) {
+            parent = node;
+            parent_high = high;
+
+            uint32_t child_index = internal_node_find_child(node, keys[i]);
+            if (child_index < *internal_node_num_keys(node))
+                high = *internal_node_key(node, child_index);
+            page_number = *internal_node_child(node, child_index);
+            node = get_page(pager, page_number);
+        }
+
+        uint32_t end = i;
+        while (end < count && keys[end] <= parent_high)
+            end++;
+
+        uint32_t num_keys = parent == NULL ? 0 : *internal_node_num_keys(parent);
+        uint32_t child_index = 0;
+        while (i < end) {
+            char* leaves[BATCH_PREFETCH_LEAVES];
+            uint32_t first_keys[BATCH_PREFETCH_LEAVES + 1]; // the keys of a leaf are `first_keys[l]` to `first_keys[l + 1]`
+            uint32_t leaf_count = 0;
+
+            while (i < end && leaf_count < BATCH_PREFETCH_LEAVES) {
+                if (parent != NULL) {
+                    child_index += key_search(internal_node_keys(parent) + child_index, num_keys - child_index, keys[i]);
+                    page_number = *internal_node_child(parent, child_index);
+                }
+                leaves[leaf_count] = get_page(pager, page_number);
+                first_keys[leaf_count] = i;
+                for (uint32_t offset = 0; offset < BATCH_PREFETCH_BYTES; offset += 64)
+                    __builtin_prefetch(leaves[leaf_count] + offset);
+                leaf_count++;
+
+                i++;
+                while (i < end && (parent == NULL || child_index == num_keys || keys[i] <= *internal_node_key(parent, child_index)))
+                    i++;
+            }
+            first_keys[leaf_count] = i;
+
+            uint32_t window_found = found;
+            for (uint32_t l = 0; l < leaf_count; l++) {
+                uint32_t num_cells = *leaf_node_num_cells(leaves[l]);
+                uint32_t cell_number = 0;
+
+                for (uint32_t k = first_keys[l]; k < first_keys[l + 1]; k++) {
+                    cell_number += key_search(leaf_node_keys(leaves[l]) + cell_number, num_cells - cell_number, keys[k]);
+                    if (cell_number < num_cells && *leaf_node_key(leaves[l], cell_number) == keys[k]) {
+                        rows[window_found].id = keys[k];
+                        records[window_found] = leaf_node_value(leaves[l], cell_number);
+                        __builtin_prefetch(records[window_found]);
+                        window_found++;
+                    }
+                }
+            }
+
+            for (; found < window_found; found++)
+                deserialize_row(records[found], &rows[found]);
+        }
+    }
+
+    free(records);
+    return found;
 }
 
 /* returns a pointer to an address in the memory where the row which the cursor is pointing to is [void*] */
@@ -203,6 +611,14 @@ void* cursor_position(Cursor* cursor) {
     return leaf_node_value(page, cursor->cell_number);
 }
 
+/* reads the row the cursor is pointing at [void] */
+void cursor_read_row(Cursor* cursor, Row* row) {
+    void* page = get_page(cursor->table->pager, cursor->page_number);
+
+    row->id = *leaf_node_key(page, cursor->cell_number);
+    deserialize_row(leaf_node_value(page, cursor->cell_number), row);
+}
+
 /* advances the cursor to the next row [void] */
 void cursor_advance(Cursor* cursor) {
     uint32_t page_number = cursor->page_number;
@@ -215,8 +631,273 @@ void cursor_advance(Cursor* cursor) {
         if (next_page_number == 0)
             cursor->end_of_table = true;
         else {
+            /* the cursor keeps only the leaf it's pointing at pinned */
+            pager_unpin(cursor->table->pager, page_number);
+            pager_pin(cursor->table->pager, next_page_number);
             cursor->page_number = next_page_number;
             cursor->cell_number = 0;
         }
     }
 }
+
+/* moves the cursor to the previous row (a cursor at the end of the table to the last row),
+ * returns false if it's at the first row (then it doesn't move). Leaves only link to the next
+ * leaf, the previous leaf is the last leaf of the subtree before the leaf's, under its lowest
+ * ancestor that wasn't entered through its first child [bool] */
+bool cursor_retreat(Cursor* cursor) {
+    Table* table = cursor->table;
+    void* node = get_page(table->pager, cursor->page_number);
+
+    if (cursor->cell_number > 0) {
+        cursor->cell_number--;
+        cursor->end_of_table = false;
+        return true;
+    }
+    if (*leaf_node_num_cells(node) == 0)
+        return false;
+
+    /* the path to the leaf, the cursor's path isn't kept up to date by `cursor_advance()` */
+    Cursor current;
+    table_find(table, *leaf_node_key(node, 0), &current);
+    cursor_close(&current);
+
+    int32_t level = current.depth - 1;
+    uint32_t child_page_number = current.page_number;
+    uint32_t child_index = 0;
+    for (; level >= 0; level--) {
+        child_index = internal_node_child_index(get_page(table->pager, current.path[level]), child_page_number);
+        if (child_index > 0)
+            break;
+        child_page_number = current.path[level];
+    }
+    if (level < 0)
+        return false; // the first leaf
+
+    uint32_t depth = level + 1;
+    uint32_t page_number = *internal_node_child(get_page(table->pager, current.path[level]), child_index - 1);
+    node = get_page(table->pager, page_number);
+    while (get_node_type(node) == NODE_INTERNAL) {
+        current.path[depth++] = page_number;
+        page_number = *internal_node_right_child(node);
+        node = get_page(table->pager, page_number);
+    }
+
+    pager_unpin(table->pager, cursor->page_number);
+    pager_pin(table->pager, page_number);
+    memcpy(cursor->path, current.path, depth * sizeof(uint32_t));
+    cursor->depth = depth;
+    cursor->page_number = page_number;
+    cursor->cell_number = *leaf_node_num_cells(node) - 1;
+    cursor->end_of_table = false;
+    return true;
+}
+
+/* unpins the cursor's page, the cursor can't be used anymore (it's the caller's, nothing is freed) [void] */
+void cursor_close(Cursor* cursor) {
+    pager_unpin(cursor->table->pager, cursor->page_number);
+}
+
+/* reads the rows from the cursor's position to the end of its leaf into the batch (the cursor
+ * moves to the next leaf first if it read its leaf's last row already), and returns the number
+ * of rows, 0 at the end of the table. The rows aren't copied, the batch points into the leaf,
+ * which stays pinned by the cursor until the next batch is read [uint32_t] */
+uint32_t cursor_read_batch(Cursor* cursor, RowBatch* batch) {
+    return cursor_read_batch_filtered(cursor, batch, NULL, UINT32_MAX);
+}
+
+/* reads the next batch like `cursor_read_batch()`, but passes over the leaves whose zone maps
+ * (see zone.h) show that none of their rows match the filter, without reading them. The zone map
+ * of a leaf that's read whole is recorded if its keys aren't larger than `high_key` (so a part of a
+ * parallel scan only records the leaves of its own part) [uint32_t] */
+uint32_t cursor_read_batch_filtered(Cursor* cursor, RowBatch* batch, const ZoneFilter* filter, uint32_t high_key) {
+    Pager* pager = cursor->table->pager;
+    batch->count = 0;
+    if (cursor->end_of_table)
+        return 0;
+
+    void* node = get_page(pager, cursor->page_number);
+    uint32_t num_cells = *leaf_node_num_cells(node);
+    if (filter != NULL && cursor->cell_number == 0 && table_skip_leaves(pager, cursor->page_number, filter) != cursor->page_number)
+        cursor->cell_number = num_cells;
+    while (cursor->cell_number >= num_cells) {
+        uint32_t next_page_number = *leaf_node_next_leaf(node);
+        if (filter != NULL)
+            next_page_number = table_skip_leaves(pager, next_page_number, filter);
+        if (next_page_number == 0) {
+            cursor->end_of_table = true;
+            return 0;
+        }
+
+        pager_unpin(pager, cursor->page_number);
+        pager_pin(pager, next_page_number);
+        cursor->page_number = next_page_number;
+        cursor->cell_number = 0;
+        node = get_page(pager, next_page_number);
+        num_cells = *leaf_node_num_cells(node);
+    }
+
+    uint32_t first = cursor->cell_number;
+    uint32_t count = num_cells - first;
+    memcpy(batch->ids, leaf_node_keys(node) + first, count * sizeof(uint32_t));
+
+    void* entries = leaf_node_record_entry(node, first);
+    for (uint32_t i = 0; i < count; i++) {
+        uint8_t* record = node + *(uint16_t*)(entries + i * LEAF_NODE_RECORD_ENTRY_SIZE + LEAF_NODE_RECORD_OFFSET_OFFSET);
+        batch->username_lengths[i] = record[0];
+        batch->usernames[i] = (const char*)record + RECORD_LENGTH_SIZE;
+        record += RECORD_LENGTH_SIZE + record[0];
+        batch->email_lengths[i] = record[0];
+        batch->emails[i] = (const char*)record + RECORD_LENGTH_SIZE;
+    }
+
+    if (filter != NULL && first == 0 && count > 0 && batch->ids[count - 1] <= high_key) {
+        ZoneMap* zone = pager_zone_map(pager, cursor->page_number);
+        if (zone != NULL && !zone_map_is_valid(zone)) {
+            zone_map_clear(zone);
+            for (uint32_t i = 0; i < count; i++)
+                zone_map_add(zone, batch->usernames[i], batch->username_lengths[i], batch->emails[i], batch->email_lengths[i]);
+            zone->next_leaf = *leaf_node_next_leaf(node);
+            zone_map_publish(zone);
+        }
+    }
+
+    /* the next batch starts at the next leaf */
+    cursor->cell_number = num_cells;
+    batch->count = count;
+    return count;
+}
+
+/* returns the first leaf from `page_number` on (following the next leaf references of the zone maps)
+ * that can have a row matching the filter, the first one without a valid zone map, or 0 at the end
+ * of the table [uint32_t] */
+uint32_t table_skip_leaves(Pager* pager, uint32_t page_number, const ZoneFilter* filter) {
+    ZoneMap* zone;
+    while (page_number != 0 && (zone = pager_valid_zone_map(pager, page_number)) != NULL && !zone_map_may_match(zone, filter))
+        page_number = zone->next_leaf;
+
+    return page_number;
+}
+
+/* copies a row of the batch into a row [void] */
+void row_batch_read_row(RowBatch* batch, uint32_t index, Row* row) {
+    row->id = batch->ids[index];
+    memcpy(row->username, batch->usernames[index], batch->username_lengths[index]);
+    row->username[batch->username_lengths[index]] = 0;
+    memcpy(row->email, batch->emails[index], batch->email_lengths[index]);
+    row->email[batch->email_lengths[index]] = 0;
+}
+
+
+/* Parallel scans --------- */
+
+/* collects the keys a parallel scan splits the table at into a new array (`bounds`): the root's
+ * keys, or the keys of the root's children and the root's keys between them if the root has fewer
+ * than `wanted` children, returns their number (0 if the root is a leaf) [uint32_t] */
+uint32_t table_scan_bounds(Table* table, uint32_t wanted, uint32_t** bounds) {
+    void* root = get_page(table->pager, table->root_page_number);
+    if (get_node_type(root) != NODE_INTERNAL) {
+        *bounds = NULL;
+        return 0;
+    }
+
+    uint32_t num_keys = *internal_node_num_keys(root);
+    *bounds = malloc((num_keys + 1) * (INTERNAL_NODE_MAX_CELLS + 1) * sizeof(uint32_t));
+    uint32_t count = 0;
+
+    void* child = get_page(table->pager, *internal_node_child(root, 0));
+    if (num_keys + 1 >= wanted || get_node_type(child) != NODE_INTERNAL) {
+        memcpy(*bounds, internal_node_keys(root), num_keys * sizeof(uint32_t));
+        return num_keys;
+    }
+
+    for (uint32_t i = 0; i <= num_keys; i++) {
+        child = get_page(table->pager, *internal_node_child(root, i));
+        uint32_t child_keys = *internal_node_num_keys(child);
+        memcpy(*bounds + count, internal_node_keys(child), child_keys * sizeof(uint32_t));
+        count += child_keys;
+        if (i < num_keys)
+            (*bounds)[count++] = *internal_node_key(root, i);
+    }
+
+    return count;
+}
+
+/* checks if the table is big enough (and has the threads) for a parallel scan [bool] */
+bool table_scans_in_parallel(Table* table) {
+    return table->thread_count > 1 && table->row_count >= PARALLEL_SCAN_MIN_ROWS;
+}
+
+/* scans the table on the table's thread pool, calling the function for the batches of every part
+ * with the part's state (the states are an array of `PARALLEL_SCAN_MAX_PARTS` states of `state_size`
+ * bytes, the parts are in key order), returns the number of parts, or 0 if the table is too small
+ * (or there is only one thread) and the caller should scan it itself. The parts' cursors are
+ * positioned before the threads start, so the threads only read the leaves they pinned. With a
+ * filter the parts pass over the leaves that can't match (see `cursor_read_batch_filtered()`) [uint32_t] */
+uint32_t table_scan_parallel(Table* table, ScanBatchFunction function, void* states, size_t state_size,
+                             const ZoneFilter* filter) {
+    if (!table_scans_in_parallel(table))
+        return 0;
+
+    uint32_t wanted = table->thread_count * PARALLEL_SCAN_PARTS_PER_THREAD;
+    if (wanted > PARALLEL_SCAN_MAX_PARTS)
+        wanted = PARALLEL_SCAN_MAX_PARTS;
+
+    uint32_t* bounds;
+    uint32_t bound_count = table_scan_bounds(table, wanted, &bounds);
+    if (bound_count == 0) {
+        free(bounds);
+        return 0;
+    }
+
+    /* the parts end at evenly spaced bounds */
+    uint32_t part_count = bound_count + 1 < wanted ? bound_count + 1 : wanted;
+    ScanPart* parts = malloc(part_count * sizeof(ScanPart));
+    uint32_t low_key = 0;
+    for (uint32_t p = 0; p < part_count; p++) {
+        ScanPart* part = &parts[p];
+        part->table = table;
+        part->high_key = p + 1 == part_count ? UINT32_MAX : bounds[(uint64_t)(p + 1) * (bound_count + 1) / part_count - 1];
+        part->filter = filter;
+        part->function = function;
+        part->state = (char*)states + p * state_size;
+        table_seek(table, low_key, &part->cursor);
+        low_key = part->high_key == UINT32_MAX ? UINT32_MAX : part->high_key + 1;
+    }
+    free(bounds);
+
+    if (table->pool == NULL)
+        table->pool = pool_create(table->thread_count);
+
+    /* the parts record zone maps, which can't be grown in shared mode */
+    if (filter != NULL)
+        pager_reserve_zone_maps(table->pager, table->pager->page_count);
+    pager_share(table->pager, true);
+    pool_run(table->pool, table_scan_part, parts, part_count);
+    pager_share(table->pager, false);
+
+    for (uint32_t p = 0; p < part_count; p++)
+        cursor_close(&parts[p].cursor);
+    free(parts);
+
+    return part_count;
+}
+
+/* scans a part of a parallel scan (a task of the thread pool), the rows after the part's high key
+ * are cut off its last batch [void] */
+void table_scan_part(void* parts, uint32_t part_number) {
+    ScanPart* part = (ScanPart*)parts + part_number;
+
+    RowBatch batch;
+    while (cursor_read_batch_filtered(&part->cursor, &batch, part->filter, part->high_key) > 0) {
+        bool last = batch.ids[batch.count - 1] >= part->high_key;
+        while (batch.count > 0 && batch.ids[batch.count - 1] > part->high_key)
+            batch.count--;
+
+        if (batch.count > 0 && !part->function(&batch, part->state))
+            break;
+        /* only the pinned leaves of the parts have to stay in the buffer pool */
+        pager_release(part->table->pager);
+        if (last)
+            break;
+    }
+}
@@ -0,0 +1,522 @@
+#include "wal.h"
+
+/* opens (creates) the `<db_filename>-wal` log, replaying the committed frames
+ * that are left in it into the database file [Wal*] */
+Wal* wal_open(Pager* pager, const char* db_filename, SyncLevel sync_level) {
+    Wal* wal = malloc(sizeof(Wal));
+    wal->filename = malloc(strlen(db_filename) + 5);
+    sprintf(wal->filename, "%s-wal", db_filename);
+
+    wal->file_descriptor = open(wal->filename, O_RDWR | O_CREAT, S_IWUSR | S_IRUSR);
+    if (wal->file_descriptor == -1) {
+        printf("Unable to open WAL file\n");
+        exit(EXIT_FAILURE);
+    }
+
+    wal->sync_level = sync_level;
+    wal->salt = 0;
+    wal->checksum = 0;
+    wal->size = 0;
+    wal->unsynced_commits = 0;
+
+    wal->pending_capacity = 16;
+    wal->pending_count = 0;
+    wal->pending_pages = malloc(wal->pending_capacity * sizeof(uint32_t));
+    wal->pending_images = malloc((size_t)wal->pending_capacity * PAGE_SIZE);
+    wal->pending_slots_size = 2 * wal->pending_capacity;
+    wal->pending_slots = calloc(wal->pending_slots_size, sizeof(uint32_t));
+    wal->pending_offsets = malloc(wal->pending_capacity * sizeof(uint32_t));
+    wal->pending_lengths = malloc(wal->pending_capacity * sizeof(uint32_t));
+    wal->commit_buffer_capacity = 4 * PAGE_SIZE;
+    wal->commit_buffer = malloc(wal->commit_buffer_capacity);
+
+    wal->spilled_count = 0;
+    wal->spilled_slots_size = 1024;
+    wal->spilled_pages = malloc(wal->spilled_slots_size * sizeof(uint32_t));
+    memset(wal->spilled_pages, 0xff, wal->spilled_slots_size * sizeof(uint32_t));
+    wal->spilled_offsets = malloc(wal->spilled_slots_size * sizeof(off_t));
+    wal->spilling = false;
+
+    pager->wal = wal;
+    wal_recover(pager);
+
+    return wal;
+}
+
+/* checkpoints the log and removes it, called when the database is closed [void] */
+void wal_close(Pager* pager) {
+    Wal* wal = pager->wal;
+
+    wal_checkpoint(pager);
+    close(wal->file_descriptor);
+    unlink(wal->filename);
+
+    free(wal->pending_pages);
+    free(wal->pending_images);
+    free(wal->pending_slots);
+    free(wal->pending_offsets);
+    free(wal->pending_lengths);
+    free(wal->commit_buffer);
+    free(wal->spilled_pages);
+    free(wal->spilled_offsets);
+    free(wal->filename);
+    free(wal);
+    pager->wal = NULL;
+}
+
+/* remembers that the given page is about to be modified by the current (uncommitted) statement,
+ * the first time this happens in a statement the page's image is saved [void] */
+void wal_add_page(Wal* wal, uint32_t page_number, void* page) {
+    /* looking the page up in the hash table (linear probing) */
+    uint32_t slot = (page_number * 2654435761u) & (wal->pending_slots_size - 1);
+    while (wal->pending_slots[slot] != 0) {
+        if (wal->pending_pages[wal->pending_slots[slot] - 1] == page_number)
+            return; // already saved in this statement
+        slot = (slot + 1) & (wal->pending_slots_size - 1);
+    }
+
+    if (wal->pending_count == wal->pending_capacity) {
+        wal->pending_capacity *= 2;
+        wal->pending_pages = realloc(wal->pending_pages, wal->pending_capacity * sizeof(uint32_t));
+        wal->pending_images = realloc(wal->pending_images, (size_t)wal->pending_capacity * PAGE_SIZE);
+        wal->pending_offsets = realloc(wal->pending_offsets, wal->pending_capacity * sizeof(uint32_t));
+        wal->pending_lengths = realloc(wal->pending_lengths, wal->pending_capacity * sizeof(uint32_t));
+
+        /* rebuilding the hash table with double the size */
+        free(wal->pending_slots);
+        wal->pending_slots_size = 2 * wal->pending_capacity;
+        wal->pending_slots = calloc(wal->pending_slots_size, sizeof(uint32_t));
+        for (uint32_t i = 0; i < wal->pending_count; i++) {
+            uint32_t j = (wal->pending_pages[i] * 2654435761u) & (wal->pending_slots_size - 1);
+            while (wal->pending_slots[j] != 0)
+                j = (j + 1) & (wal->pending_slots_size - 1);
+            wal->pending_slots[j] = i + 1;
+        }
+
+        slot = (page_number * 2654435761u) & (wal->pending_slots_size - 1);
+        while (wal->pending_slots[slot] != 0)
+            slot = (slot + 1) & (wal->pending_slots_size - 1);
+    }
+
+    uint32_t index = wal->pending_count++;
+    wal->pending_pages[index] = page_number;
+    memcpy(wal->pending_images + (size_t)index * PAGE_SIZE, page, PAGE_SIZE);
+    wal->pending_slots[slot] = index + 1;
+}
+
+/* finds the range of bytes that differ between the two page images,
+ * returns false if the images are the same [bool] */
+bool wal_page_delta(const void* before, const void* after, uint32_t* offset, uint32_t* length) {
+    const uint64_t* a = before;
+    const uint64_t* b = after;
+    uint32_t words = PAGE_SIZE / sizeof(uint64_t);
+
+    uint32_t first = 0;
+    while (first < words && a[first] == b[first])
+        first++;
+    if (first == words)
+        return false;
+
+    uint32_t last = words - 1;
+    while (a[last] == b[last])
+        last--;
+
+    *offset = first * sizeof(uint64_t);
+    *length = (last - first + 1) * sizeof(uint64_t);
+    return true;
+}
+
+/* returns the buffer for the frames of a commit (or spill), grown to at least `size` bytes [void*] */
+void* wal_commit_buffer(Wal* wal, size_t size) {
+    if (size > wal->commit_buffer_capacity) {
+        while (wal->commit_buffer_capacity < size)
+            wal->commit_buffer_capacity *= 2;
+        free(wal->commit_buffer);
+        wal->commit_buffer = malloc(wal->commit_buffer_capacity);
+    }
+    return wal->commit_buffer;
+}
+
+/* fills in the header of a frame and copies the page's range after it, the running checksum
+ * is continued with the frame (so frames have to be filled in the order they're written) [void] */
+void wal_fill_frame(Wal* wal, void* frame, uint32_t page_number, uint32_t commit, uint32_t offset, uint32_t length, const void* page) {
+    *(uint32_t*)(frame + WAL_FRAME_PAGE_NUMBER_OFFSET) = page_number;
+    *(uint32_t*)(frame + WAL_FRAME_COMMIT_OFFSET) = commit;
+    *(uint32_t*)(frame + WAL_FRAME_SALT_OFFSET) = wal->salt;
+    *(uint16_t*)(frame + WAL_FRAME_RANGE_OFFSET) = offset;
+    *(uint16_t*)(frame + WAL_FRAME_RANGE_OFFSET + sizeof(uint16_t)) = length;
+    memcpy(frame + WAL_FRAME_HEADER_SIZE, page + offset, length);
+
+    wal->checksum = wal_checksum(wal->checksum, frame, WAL_FRAME_CHECKSUM_OFFSET);
+    wal->checksum = wal_checksum(wal->checksum, frame + WAL_FRAME_HEADER_SIZE, length);
+    *(uint32_t*)(frame + WAL_FRAME_CHECKSUM_OFFSET) = wal->checksum;
+}
+
+/* appends the deltas of all pages modified by the statement to the log with a single `write()`,
+ * the last frame carries the commit mark; the log is synced according to the sync level [void] */
+void wal_commit(Pager* pager) {
+    Wal* wal = pager->wal;
+    if (wal->pending_count == 0 && !wal->spilling)
+        return;
+
+    /* computing the deltas, pages that ended up unchanged aren't logged */
+    uint32_t* offsets = wal->pending_offsets;
+    uint32_t* lengths = wal->pending_lengths;
+    size_t log_bytes = 0;
+    int32_t last_frame = -1;
+    for (uint32_t i = 0; i < wal->pending_count; i++) {
+        void* before = wal->pending_images + (size_t)i * PAGE_SIZE;
+        if (wal_page_delta(before, get_page(pager, wal->pending_pages[i]), &offsets[i], &lengths[i])) {
+            log_bytes += WAL_FRAME_HEADER_SIZE + lengths[i];
+            last_frame = i;
+        } else {
+            lengths[i] = 0;
+        }
+    }
+
+    /* the statement's spilled frames are only committed by a commit mark after them, if all of its
+     * changes were spilled already an empty frame carries it */
+    bool empty_commit = last_frame == -1 && wal->spilling;
+    if (empty_commit)
+        log_bytes = WAL_FRAME_HEADER_SIZE;
+    wal->spilling = false;
+
+    void* buffer = wal_commit_buffer(wal, log_bytes);
+    void* frame = buffer;
+    for (int32_t i = 0; i <= last_frame; i++) {
+        if (lengths[i] == 0)
+            continue;
+
+        uint32_t page_number = wal->pending_pages[i];
+        wal_fill_frame(wal, frame, page_number, (i == last_frame) ? pager->page_count : 0,
+                       offsets[i], lengths[i], get_page(pager, page_number));
+        frame += WAL_FRAME_HEADER_SIZE + lengths[i];
+    }
+    if (empty_commit)
+        wal_fill_frame(wal, frame, 0, pager->page_count, 0, 0, get_page(pager, 0));
+
+    if (log_bytes > 0) {
+        ssize_t bytes_written = pwrite(wal->file_descriptor, buffer, log_bytes, WAL_HEADER_SIZE + wal->size);
+        if (bytes_written != (ssize_t)log_bytes) {
+            printf("Error writing WAL: %d.\n", errno);
+            exit(EXIT_FAILURE);
+        }
+        wal->size += log_bytes;
+    }
+
+    /* starting the next statement with an empty set of pending pages */
+    wal->pending_count = 0;
+    memset(wal->pending_slots, 0, wal->pending_slots_size * sizeof(uint32_t));
+    if (log_bytes == 0)
+        return;
+
+    /* group commit */
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (wal->unsynced_commits == 0)
+        wal->group_start = now;
+    wal->unsynced_commits++;
+
+    if (wal->sync_level == SYNC_FULL) {
+        wal_sync(wal);
+    } else if (wal->sync_level == SYNC_NORMAL) {
+        uint64_t group_ms = (now.tv_sec - wal->group_start.tv_sec) * 1000 +
+                            (now.tv_nsec - wal->group_start.tv_nsec) / 1000000;
+        if (wal->unsynced_commits >= WAL_GROUP_COMMIT_STATEMENTS || group_ms >= WAL_GROUP_COMMIT_MS)
+            wal_sync(wal);
+    }
+
+    /* the memory mapped pager keeps the modified pages until a checkpoint writes them, like
+     * the dirty frames of the buffer pool they're limited by the frame budget */
+    if (wal->size >= WAL_CHECKPOINT_SIZE || pager->map_dirty_count >= pager->max_frames)
+        wal_checkpoint(pager);
+}
+
+/* writes the pages modified so far by the current (uncommitted) statement into the log as whole
+ * page images without a commit mark, and starts over with an empty set of pending pages. A big
+ * statement spills now and then, so it doesn't keep every page it modified (and their images
+ * from before the statement) in memory until it commits: the buffer pool can drop the spilled
+ * pages (they're read from the log again) and the statement still commits once, recovery discards
+ * its frames unless its commit mark follows them [void] */
+void wal_spill(Pager* pager) {
+    Wal* wal = pager->wal;
+
+    uint32_t i = 0;
+    while (i < wal->pending_count) {
+        void* buffer = wal_commit_buffer(wal, (size_t)WAL_SPILL_BATCH_PAGES * (WAL_FRAME_HEADER_SIZE + PAGE_SIZE));
+        void* frame = buffer;
+        for (uint32_t batch = 0; batch < WAL_SPILL_BATCH_PAGES && i < wal->pending_count; i++) {
+            uint32_t page_number = wal->pending_pages[i];
+            void* page = get_page(pager, page_number);
+            uint32_t offset;
+            uint32_t length;
+            if (!wal_page_delta(wal->pending_images + (size_t)i * PAGE_SIZE, page, &offset, &length))
+                continue; // unchanged
+
+            wal_fill_frame(wal, frame, page_number, 0, 0, PAGE_SIZE, page);
+            if (pager->mode == PAGER_BUFFERED) {
+                wal_add_spilled(wal, page_number, WAL_HEADER_SIZE + wal->size + (frame - buffer) + WAL_FRAME_HEADER_SIZE);
+                pager->frames[pager->page_frames[page_number] - 1].spilled = true;
+            }
+            frame += WAL_FRAME_HEADER_SIZE + PAGE_SIZE;
+            batch++;
+        }
+
+        size_t log_bytes = frame - buffer;
+        if (log_bytes == 0)
+            continue;
+        if (pwrite(wal->file_descriptor, buffer, log_bytes, WAL_HEADER_SIZE + wal->size) != (ssize_t)log_bytes) {
+            printf("Error writing WAL: %d.\n", errno);
+            exit(EXIT_FAILURE);
+        }
+        wal->size += log_bytes;
+        wal->spilling = true;
+    }
+
+    wal->pending_count = 0;
+    memset(wal->pending_slots, 0, wal->pending_slots_size * sizeof(uint32_t));
+}
+
+/* returns the slot of the page in the hash table of the spilled pages, or the empty slot
+ * where it belongs [uint32_t] */
+uint32_t wal_spilled_slot(Wal* wal, uint32_t page_number) {
+    uint32_t slot = (page_number * 2654435761u) & (wal->spilled_slots_size - 1);
+    while (wal->spilled_pages[slot] != UINT32_MAX && wal->spilled_pages[slot] != page_number)
+        slot = (slot + 1) & (wal->spilled_slots_size - 1);
+    return slot;
+}
+
+/* remembers where the newest image of a spilled page is in the log [void] */
+void wal_add_spilled(Wal* wal, uint32_t page_number, off_t offset) {
+    if (2 * (wal->spilled_count + 1) > wal->spilled_slots_size) {
+        /* rebuilding the hash table with double the size */
+        uint32_t* pages = wal->spilled_pages;
+        off_t* offsets = wal->spilled_offsets;
+        uint32_t slots_size = wal->spilled_slots_size;
+
+        wal->spilled_slots_size *= 2;
+        wal->spilled_pages = malloc(wal->spilled_slots_size * sizeof(uint32_t));
+        memset(wal->spilled_pages, 0xff, wal->spilled_slots_size * sizeof(uint32_t));
+        wal->spilled_offsets = malloc(wal->spilled_slots_size * sizeof(off_t));
+        for (uint32_t i = 0; i < slots_size; i++) {
+            if (pages[i] == UINT32_MAX)
+                continue;
+            uint32_t slot = wal_spilled_slot(wal, pages[i]);
+            wal->spilled_pages[slot] = pages[i];
+            wal->spilled_offsets[slot] = offsets[i];
+        }
+        free(pages);
+        free(offsets);
+    }
+
+    uint32_t slot = wal_spilled_slot(wal, page_number);
+    if (wal->spilled_pages[slot] == UINT32_MAX) {
+        wal->spilled_pages[slot] = page_number;
+        wal->spilled_count++;
+    }
+    wal->spilled_offsets[slot] = offset;
+}
+
+/* reads the newest image of a spilled page from the log,
+ * returns false if the database file has the newest image [bool] */
+bool wal_read_spilled(Wal* wal, uint32_t page_number, void* page) {
+    if (wal->spilled_count == 0)
+        return false;
+
+    uint32_t slot = wal_spilled_slot(wal, page_number);
+    if (wal->spilled_pages[slot] == UINT32_MAX || wal->spilled_offsets[slot] == 0)
+        return false;
+
+    if (pread(wal->file_descriptor, page, PAGE_SIZE, wal->spilled_offsets[slot]) != PAGE_SIZE) {
+        printf("Error reading WAL: %d.\n", errno);
+        exit(EXIT_FAILURE);
+    }
+    return true;
+}
+
+/* the database file has a newer image of the page than the log (it was written back) [void] */
+void wal_forget_spilled(Wal* wal, uint32_t page_number) {
+    if (wal->spilled_count == 0)
+        return;
+
+    uint32_t slot = wal_spilled_slot(wal, page_number);
+    if (wal->spilled_pages[slot] != UINT32_MAX)
+        wal->spilled_offsets[slot] = 0;
+}
+
+/* writes the spilled pages that only the log has (the buffer pool dropped them) into the database
+ * file, the ones in the buffer pool are dirty and written with the other dirty pages [void] */
+void wal_write_spilled(Pager* pager) {
+    Wal* wal = pager->wal;
+    if (wal->spilled_count == 0)
+        return;
+
+    void* page = wal_commit_buffer(wal, PAGE_SIZE);
+    for (uint32_t slot = 0; slot < wal->spilled_slots_size; slot++) {
+        uint32_t page_number = wal->spilled_pages[slot];
+        if (page_number == UINT32_MAX || wal->spilled_offsets[slot] == 0 ||
+            (page_number < pager->page_frames_capacity && pager->page_frames[page_number] != 0))
+            continue;
+
+        wal_read_spilled(wal, page_number, page);
+        if (pwrite(pager->file_descriptor, page, PAGE_SIZE, (off_t)page_number * PAGE_SIZE) != PAGE_SIZE) {
+            printf("Error writing: %d.\n", errno);
+            exit(EXIT_FAILURE);
+        }
+        if ((off_t)(page_number + 1) * PAGE_SIZE > pager->file_size)
+            pager->file_size = (off_t)(page_number + 1) * PAGE_SIZE;
+    }
+}
+
+/* makes the commits written to the log durable (`fdatasync()`), does nothing with `SYNC_OFF` [void] */
+void wal_sync(Wal* wal) {
+    if (wal->unsynced_commits == 0 || wal->sync_level == SYNC_OFF)
+        return;
+
+    if (fdatasync(wal->file_descriptor) == -1) {
+        printf("Error syncing WAL: %d.\n", errno);
+        exit(EXIT_FAILURE);
+    }
+    wal->unsynced_commits = 0;
+}
+
+/* writes every dirty page into the database file and empties the log [void] */
+void wal_checkpoint(Pager* pager) {
+    Wal* wal = pager->wal;
+
+    wal_sync(wal);
+    wal_write_spilled(pager);
+    pager_flush_all(pager);
+    if (wal->sync_level != SYNC_OFF && fdatasync(pager->file_descriptor) == -1) {
+        printf("Error syncing db file: %d.\n", errno);
+        exit(EXIT_FAILURE);
+    }
+
+    wal_reset(wal);
+}
+
+/* replays the committed frames of the log into the database file,
+ * frames after the last valid commit (torn or uncommitted writes) are discarded.
+ * Deltas hold the whole modified range, so replaying them over a page that already
+ * contains some of the changes gives the same result [void] */
+void wal_recover(Pager* pager) {
+    Wal* wal = pager->wal;
+
+    uint32_t header[4];
+    if (pread(wal->file_descriptor, header, WAL_HEADER_SIZE, 0) != WAL_HEADER_SIZE ||
+        header[0] != WAL_MAGIC || header[1] != PAGE_SIZE) {
+        /* empty (or unusable) log */
+        wal_reset(wal);
+        return;
+    }
+    wal->salt = header[2];
+
+    /* the whole log is at most a bit over `WAL_CHECKPOINT_SIZE`, reading it at once */
+    off_t log_size = lseek(wal->file_descriptor, 0, SEEK_END) - WAL_HEADER_SIZE;
+    void* log = malloc(log_size > 0 ? log_size : 1);
+    if (log_size > 0 && pread(wal->file_descriptor, log, log_size, WAL_HEADER_SIZE) != log_size)
+        log_size = 0;
+
+    uint32_t checksum = 0;
+    uint32_t committed_pages = 0;
+    off_t txn_start = 0; // first frame of the transaction that is being read
+    off_t offset = 0;
+    bool recovered = false;
+
+    while (offset + WAL_FRAME_HEADER_SIZE <= log_size) {
+        void* frame = log + offset;
+        uint32_t length = *(uint16_t*)(frame + WAL_FRAME_RANGE_OFFSET + sizeof(uint16_t));
+        if (offset + WAL_FRAME_HEADER_SIZE + length > log_size)
+            break;
+
+        checksum = wal_checksum(checksum, frame, WAL_FRAME_CHECKSUM_OFFSET);
+        checksum = wal_checksum(checksum, frame + WAL_FRAME_HEADER_SIZE, length);
+        if (*(uint32_t*)(frame + WAL_FRAME_SALT_OFFSET) != wal->salt ||
+            *(uint32_t*)(frame + WAL_FRAME_CHECKSUM_OFFSET) != checksum)
+            break;
+
+        offset += WAL_FRAME_HEADER_SIZE + length;
+
+        uint32_t commit = *(uint32_t*)(frame + WAL_FRAME_COMMIT_OFFSET);
+        if (commit == 0)
+            continue;
+
+        /* commit frame, applying the whole transaction */
+        for (off_t txn_offset = txn_start; txn_offset < offset;) {
+            void* txn_frame = log + txn_offset;
+            uint32_t page_number = *(uint32_t*)(txn_frame + WAL_FRAME_PAGE_NUMBER_OFFSET);
+            uint32_t range_offset = *(uint16_t*)(txn_frame + WAL_FRAME_RANGE_OFFSET);
+            uint32_t range_length = *(uint16_t*)(txn_frame + WAL_FRAME_RANGE_OFFSET + sizeof(uint16_t));
+
+            if (pwrite(pager->file_descriptor, txn_frame + WAL_FRAME_HEADER_SIZE, range_length,
+                       (off_t)page_number * PAGE_SIZE + range_offset) != range_length) {
+                printf("Error writing: %d.\n", errno);
+                exit(EXIT_FAILURE);
+            }
+            txn_offset += WAL_FRAME_HEADER_SIZE + range_length;
+        }
+        txn_start = offset;
+        if (commit > committed_pages)
+            committed_pages = commit;
+        recovered = true;
+    }
+
+    free(log);
+
+    if (recovered) {
+        /* deltas of new pages don't always reach the end of the page */
+        off_t file_size = lseek(pager->file_descriptor, 0, SEEK_END);
+        off_t whole_pages = ((file_size + PAGE_SIZE - 1) / PAGE_SIZE) * PAGE_SIZE;
+        if ((off_t)committed_pages * PAGE_SIZE > whole_pages)
+            whole_pages = (off_t)committed_pages * PAGE_SIZE;
+
+        if (ftruncate(pager->file_descriptor, whole_pages) == -1 || fdatasync(pager->file_descriptor) == -1) {
+            printf("Error syncing db file: %d.\n", errno);
+            exit(EXIT_FAILURE);
+        }
+
+        pager->file_size = whole_pages;
+        pager->page_count = whole_pages / PAGE_SIZE;
+    }
+
+    wal_reset(wal);
+}
+
+/* empties the log and starts it over with a new salt [void] */
+void wal_reset(Wal* wal) {
+    wal->salt++;
+    wal->checksum = 0;
+    wal->size = 0;
+    wal->unsynced_commits = 0;
+
+    /* the database file has every page */
+    if (wal->spilled_count > 0) {
+        memset(wal->spilled_pages, 0xff, wal->spilled_slots_size * sizeof(uint32_t));
+        wal->spilled_count = 0;
+    }
+
+    uint32_t header[4] = { WAL_MAGIC, PAGE_SIZE, wal->salt, 0 };
+    if (ftruncate(wal->file_descriptor, 0) == -1 ||
+        pwrite(wal->file_descriptor, header, WAL_HEADER_SIZE, 0) != WAL_HEADER_SIZE) {
+        printf("Error resetting WAL: %d.\n", errno);
+        exit(EXIT_FAILURE);
+    }
+
+    if (wal->sync_level != SYNC_OFF)
+        fdatasync(wal->file_descriptor);
+}
+
+/* checksum of the data (its size has to be a multiple of 8), continuing from the given `checksum`.
+ * Same idea as the sqlite WAL checksum, two running sums over pairs of 32-bit words [uint32_t] */
+uint32_t wal_checksum(uint32_t checksum, const void* data, uint32_t size) {
+    const uint32_t* words = data;
+    uint32_t s0 = checksum;
+    uint32_t s1 = checksum ^ 0x5bd1e995;
+
+    for (uint32_t i = 0; i < size / sizeof(uint32_t); i += 2) {
+        s0 += words[i] + s1;
+        s1 += words[i + 1] + s0;
+    }
+
+    return s0 ^ (s1 << 7) ^ (s1 >> 25);
+}
@@ -0,0 +1,87 @@
+#include "zone.h"
+
+#include <string.h>
+
+/* empties an invalid zone map (no prefix range, no domain), it stays invalid until it's published [void] */
+void zone_map_clear(ZoneMap* zone) {
+    zone->username_min = UINT64_MAX;
+    zone->username_max = 0;
+    zone->email_min = UINT64_MAX;
+    zone->email_max = 0;
+    zone->email_domains = 0;
+    zone->next_leaf = 0;
+}
+
+/* widens a zone map by the values of a row [void] */
+void zone_map_add(ZoneMap* zone, const char* username, uint32_t username_length, const char* email, uint32_t email_length) {
+    uint64_t prefix = zone_prefix(username, username_length, 0);
+    if (prefix < zone->username_min)
+        zone->username_min = prefix;
+    if (prefix > zone->username_max)
+        zone->username_max = prefix;
+
+    prefix = zone_prefix(email, email_length, 0);
+    if (prefix < zone->email_min)
+        zone->email_min = prefix;
+    if (prefix > zone->email_max)
+        zone->email_max = prefix;
+
+    zone->email_domains |= zone_domain_bits(email, email_length);
+}
+
+/* makes a zone map valid after all of its fields were set, a scan on another thread sees the
+ * whole zone map once it sees it valid [void] */
+void zone_map_publish(ZoneMap* zone) {
+    __atomic_store_n(&zone->valid, true, __ATOMIC_RELEASE);
+}
+
+/* checks if a zone map is valid (and its fields can be read) [bool] */
+bool zone_map_is_valid(ZoneMap* zone) {
+    return __atomic_load_n(&zone->valid, __ATOMIC_ACQUIRE);
+}
+
+/* checks if a leaf with this zone map can have a row that matches the filter [bool] */
+bool zone_map_may_match(const ZoneMap* zone, const ZoneFilter* filter) {
+    if (filter->ranged) {
+        uint64_t min = filter->email ? zone->email_min : zone->username_min;
+        uint64_t max = filter->email ? zone->email_max : zone->username_max;
+        if (filter->high < min || filter->low > max)
+            return false;
+    }
+
+    return (zone->email_domains & filter->domain_bits) == filter->domain_bits;
+}
+
+/* returns the first `ZONE_PREFIX_SIZE` bytes of a value as a big endian number, a shorter value is
+ * padded with `padding` bytes (0 for the values of the rows) [uint64_t] */
+uint64_t zone_prefix(const char* value, uint32_t length, uint8_t padding) {
+    uint64_t prefix = 0;
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    if (length >= ZONE_PREFIX_SIZE) {
+        memcpy(&prefix, value, ZONE_PREFIX_SIZE);
+        return __builtin_bswap64(prefix);
+    }
+#endif
+    for (uint32_t i = 0; i < ZONE_PREFIX_SIZE; i++)
+        prefix = (prefix << 8) | (i < length ? (uint8_t)value[i] : padding);
+
+    return prefix;
+}
+
+/* returns the two bloom filter bits of the email's domain (FNV-1a hash of the part after the last
+ * '@'), 0 if the email has no '@' [uint64_t] */
+uint64_t zone_domain_bits(const char* email, uint32_t length) {
+    uint32_t start = length;
+    while (start > 0 && email[start - 1] != '@')
+        start--;
+    if (start == 0)
+        return 0;
+
+    uint32_t hash = 2166136261u;
+    for (uint32_t i = start; i < length; i++) {
+        hash ^= (uint8_t)email[i];
+        hash *= 16777619u;
+    }
+
+    return ((uint64_t)1 << (hash & 63)) | ((uint64_t)1 << ((hash >> 6) & 63));
+}
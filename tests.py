@@ -97,12 +97,12 @@ _expect = []
 _input.append('.constants')
 
 _expect.append('Constants:')
-constants = '''ROW_SIZE: 293
+constants = '''ROW_MAX_SIZE: 289
 COMMON_NODE_HEADER_SIZE: 6
-LEAF_NODE_HEADER_SIZE: 14
-LEAF_NODE_CELL_SIZE: 297
-LEAF_NODE_SPACE_FOR_CELLS: 4082
-LEAF_NODE_MAX_CELLS: 13'''.split('\n')
+LEAF_NODE_HEADER_SIZE: 18
+LEAF_NODE_SLOT_SIZE: 8
+LEAF_NODE_SPACE_FOR_CELLS: 4078
+LEAF_NODE_MAX_CELLS: 339'''.split('\n')
 
 for line in constants:
     _expect.append(line)
@@ -118,16 +118,18 @@ test_name = '`.btree` of a 3-node tree'
 _input = []
 _expect = []
 
+# rows with the longest username and email, so only 13 fit in a leaf,
+# ids are sequential, so the full leaf isn't split in half
 n = 21
 for i in range(1, n+1):
-    _input.append(f"insert {i} user{i} email{i}@gmail.com")
+    _input.append(f"insert {i} {'u'*32} {'e'*255}")
 _input.append('.btree')
 
 _expect = ['Inserted.' for x in range(n)]
      
 _expect.append('Btree:')
-btree_output = '''- internal (size 2)
-  - leaf (size 7)
+btree_output = '''- internal (size 1)
+  - leaf (size 13)
     - 1
     - 2
     - 3
@@ -135,17 +137,15 @@ btree_output = '''- internal (size 2)
     - 5
     - 6
     - 7
-  - key 7
-  - leaf (size 7)
     - 8
     - 9
     - 10
     - 11
     - 12
     - 13
+  - key 13
+  - leaf (size 8)
     - 14
-  - key 14
-  - leaf (size 7)
     - 15
     - 16
     - 17
@@ -233,4 +233,597 @@ for i in range(start, n+1, 14):
 
 _input.append('.exit')
 
-TESTS.append({'name': test_name, 'inputs': [_input], 'expectations': [_expect]})
\ No newline at end of file
+TESTS.append({'name': test_name, 'inputs': [_input], 'expectations': [_expect]})
+
+
+#--------------------------------------------------------------------------
+# TEST 10 (table bigger than the buffer pool, pages get evicted and reread)|
+#--------------------------------------------------------------------------
+test_name = 'buffer pool smaller than the table'
+_input = []
+_expect = []
+
+n = 3000
+ids = list(range(1, n+1))
+random.Random(10).shuffle(ids)
+for i in ids:
+    _input.append(f'insert {i} user{i} email{i}@gmail.com')
+_input.append('select')
+_input.append('.exit')
+
+_expect = ['Inserted.' for x in range(n)]
+for i in range(1, n+1):
+    _expect.append(f'({i}, user{i}, email{i}@gmail.com)')
+
+_input1 = ['select']
+_expect1 = [f'({i}, user{i}, email{i}@gmail.com)' for i in range(1, n+1)]
+
+# 1MB buffer pool (256 pages), the table has over 400 leaf nodes
+TESTS.append({'name': test_name, 'inputs': [_input, _input1], 'expectations': [_expect, _expect1], 'args': ['--cache-size', '1']})
+
+
+
+#----------------------------------------------------------
+# TEST 11 (memory mapped pager, file is readable by both)|
+#----------------------------------------------------------
+test_name = 'memory mapped pager'
+_input = []
+_expect = []
+
+n = 500
+for i in range(n, 0, -1):
+    _input.append(f'insert {i} user{i} email{i}@gmail.com')
+_input.append('.exit')
+_expect = ['Inserted.' for x in range(n)]
+
+_input1 = ['select', '.exit']
+_expect1 = [f'({i}, user{i}, email{i}@gmail.com)' for i in range(1, n+1)]
+
+TESTS.append({'name': test_name, 'inputs': [_input, _input1], 'expectations': [_expect, _expect1], 'args': ['--mmap']})
+
+
+
+#------------------------------------------------------------------------------
+# TEST 12 (statements are recovered from the write-ahead log without `.exit`)|
+#------------------------------------------------------------------------------
+test_name = 'write-ahead log recovery'
+_input = []
+_expect = []
+
+n = 100
+for i in range(1, n+1):
+    _input.append(f'insert {i} user{i} email{i}@gmail.com')
+_expect = ['Inserted.' for x in range(n)]
+
+# the first run ends without `.exit`, so the database file is never flushed
+_input1 = ['select']
+_expect1 = [f'({i}, user{i}, email{i}@gmail.com)' for i in range(1, n+1)]
+
+TESTS.append({'name': test_name, 'inputs': [_input, _input1], 'expectations': [_expect, _expect1], 'args': ['--sync', 'full']})
+
+
+
+#--------------------------------------------------------------------
+# TEST 13 (database header keeps the table metadata between opens)|
+#--------------------------------------------------------------------
+test_name = 'database header'
+_input = []
+_expect = []
+
+n = 21
+for i in range(1, n+1):
+    _input.append(f"insert {i} {'u'*32} {'e'*255}")
+_input.append('.exit')
+_expect = ['Inserted.' for x in range(n)]
+
+_input1 = ['.pageinfo 0']
+_expect1 = '''database header:
+  - format version: 6
+  - page size: 4096
+  - page count: 4
+  - root page number: 1
+  - tree depth: 1
+  - free list head: 0
+  - row count: 21
+  - username index root: 0
+  - email index root: 0
+  - hash index root: 0'''.split('\n')
+
+TESTS.append({'name': test_name, 'inputs': [_input, _input1], 'expectations': [_expect, _expect1]})
+
+
+#-----------------------------------------------------------------------------
+# TEST 14 (tree with 3 internal node layers, the root split at the 2nd layer)|
+#-----------------------------------------------------------------------------
+test_name = '3 internal node layers'
+_input = []
+_expect = []
+
+# longest rows (13 per leaf), short ones would need a lot more rows for the 3rd layer,
+# descending ids, so the nodes are split in half (sequential ids would fill them)
+n = 1000000
+for i in range(n, 0, -1):
+    _input.append(f"insert {i} {'u'*32} {'e'*255}")
+_input.append('.exit')
+_expect = ['Inserted.' for x in range(n)]
+
+_input1 = ['insert 915000 u e', 'insert 1 u e', 'insert 1000001 u1000001 e1000001', '.pageinfo 0', '.exit']
+_expect1 = '''Error: Inserted id already exists in the table.
+Error: Inserted id already exists in the table.
+Inserted.
+database header:
+  - format version: 6
+  - page size: 4096
+  - page count: 143698
+  - root page number: 1
+  - tree depth: 3
+  - free list head: 0
+  - row count: 1000001
+  - username index root: 0
+  - email index root: 0
+  - hash index root: 0'''.split('\n')
+
+TESTS.append({'name': test_name, 'inputs': [_input, _input1], 'expectations': [_expect, _expect1], 'args': ['--sync', 'off']})
+
+
+#------------------------------------------------------------------------
+# TEST 15 (bulk loading an unsorted CSV file with `.import` into the table)|
+#------------------------------------------------------------------------
+test_name = 'bulk import from a csv file'
+
+n = 2000
+ids = list(range(1, n+1))
+random.Random(15).shuffle(ids)
+with open('test_import.csv', 'w') as f:
+    f.write('id,username,email\n')
+    for i in ids + [5]:
+        f.write(f'{i},user{i},email{i}@gmail.com\n')
+
+_input = ['.import test_import.csv', 'select', '.exit']
+_expect = ['Imported 2000 rows.', 'Skipped 1 rows with an id that already exists.']
+for i in range(1, n+1):
+    _expect.append(f'({i}, user{i}, email{i}@gmail.com)')
+
+_input1 = ['insert 2001 user2001 email2001@gmail.com', '.pageinfo 0', '.exit']
+_expect1 = '''Inserted.
+database header:
+  - format version: 6
+  - page size: 4096
+  - page count: 20
+  - root page number: 1
+  - tree depth: 1
+  - free list head: 0
+  - row count: 2001
+  - username index root: 0
+  - email index root: 0
+  - hash index root: 0'''.split('\n')
+
+TESTS.append({'name': test_name, 'inputs': [_input, _input1], 'expectations': [_expect, _expect1]})
+
+
+#-----------------------------------------------------------------------------
+# TEST 16 (rows of different lengths share the slotted leaf pages correctly)|
+#-----------------------------------------------------------------------------
+test_name = 'variable length rows'
+
+n = 1500
+ids = list(range(1, n+1))
+random.Random(16).shuffle(ids)
+rows = {i: ('u'*(i%32+1), 'e'*(i*7%255+1)) for i in ids}
+
+_input = [f'insert {i} {rows[i][0]} {rows[i][1]}' for i in ids]
+_input.append('.exit')
+_expect = ['Inserted.' for x in range(n)]
+
+_input1 = ['select', '.exit']
+_expect1 = [f'({i}, {rows[i][0]}, {rows[i][1]})' for i in range(1, n+1)]
+
+TESTS.append({'name': test_name, 'inputs': [_input, _input1], 'expectations': [_expect, _expect1], 'args': ['--cache-size', '1']})
+
+
+#------------------------------------------------------------------------------
+# TEST 17 (deleting rows, emptied pages are reused by the following inserts)|
+#------------------------------------------------------------------------------
+test_name = 'delete'
+
+n = 300
+_input = [f"insert {i} {'u'*32} {'e'*255}" for i in range(1, n+1)]
+_input += ['delete 5', 'delete 5', 'delete where id between 20 and 250', 'select', '.exit']
+_expect = ['Inserted.' for x in range(n)]
+_expect += ['Deleted 1 rows.', 'Deleted 0 rows.', 'Deleted 231 rows.']
+_expect += [f"({i}, {'u'*32}, {'e'*255})" for i in range(1, n+1) if i != 5 and not 20 <= i <= 250]
+
+_input1 = [f"insert {i} {'u'*32} {'e'*255}" for i in range(20, 101)]
+_input1 += ['.pageinfo 0', '.exit']
+_expect1 = ['Inserted.' for x in range(20, 101)]
+_expect1 += '''database header:
+  - format version: 6
+  - page size: 4096
+  - page count: 26
+  - root page number: 1
+  - tree depth: 1
+  - free list head: 10
+  - row count: 149
+  - username index root: 0
+  - email index root: 0
+  - hash index root: 0'''.split('\n')
+
+TESTS.append({'name': test_name, 'inputs': [_input, _input1], 'expectations': [_expect, _expect1]})
+
+
+#-------------------------------------------------------------------------------
+# TEST 18 (updating rows in place, a row that outgrows its leaf splits the leaf)|
+#-------------------------------------------------------------------------------
+test_name = 'update'
+
+n = 14
+rows = {i: ['u'*32, 'e'*255] for i in range(1, n+1)}
+rows[7] = ['short', 'short@mail.com']
+_input = [f'insert {i} {rows[i][0]} {rows[i][1]}' for i in range(1, n+1)]
+_expect = ['Inserted.' for x in range(n)]
+
+# the page doesn't have room for the longer record
+_input += [f"update 7 set username={'U'*32}, email={'E'*255}", '.btree']
+_expect += ['Updated 1 rows.', 'Btree:', '- internal (size 1)', '  - leaf (size 7)']
+_expect += [f'    - {i}' for i in range(1, 8)]
+_expect += ['  - key 7', '  - leaf (size 7)']
+_expect += [f'    - {i}' for i in range(8, 15)]
+rows[7] = ['U'*32, 'E'*255]
+
+# shorter records are written over the old ones
+_input += ['update 3 set username=user3, email=user3@mail.com', 'update 4 set email=user4@mail.com', 'update 15 set username=x']
+_expect += ['Updated 1 rows.', 'Updated 1 rows.', 'Updated 0 rows.']
+rows[3] = ['user3', 'user3@mail.com']
+rows[4][1] = 'user4@mail.com'
+_input += ['select']
+_expect += [f'({i}, {rows[i][0]}, {rows[i][1]})' for i in range(1, n+1)]
+
+_input += ['update 1 set', 'update 1 set id=5', '.exit']
+_expect += ["Syntax error. Couldn't parse the statement.", "Syntax error. Couldn't parse the statement."]
+
+TESTS.append({'name': test_name, 'inputs': [_input], 'expectations': [_expect]})
+
+
+#---------------------------------------------------------------------------
+# TEST 19 (select with a predicate on the id and a limit, seeks in the tree)|
+#---------------------------------------------------------------------------
+test_name = 'select where id, limit'
+
+n = 1000
+ids = list(range(2, 2*n+1, 2))
+random.Random(19).shuffle(ids)
+_input = [f'insert {i} user{i} email{i}@gmail.com' for i in ids]
+_expect = ['Inserted.' for x in range(n)]
+
+queries = [
+    ('select where id = 500', [500]),
+    ('select where id = 501', []),
+    ('select where id > 1990', [1992, 1994, 1996, 1998, 2000]),
+    ('select where id >= 1990 limit 2', [1990, 1992]),
+    ('select where id < 7', [2, 4, 6]),
+    ('select where id <= 6 limit 0', []),
+    ('select where id between 999 and 1011', [1000, 1002, 1004, 1006, 1008, 1010]),
+    ('select where id between 20 and 10', []),
+    ('select limit 3', [2, 4, 6]),
+    ('delete where id > 10', []),
+    ('select', [2, 4, 6, 8, 10]),
+]
+for query, result in queries:
+    _input.append(query)
+    _expect += [f'({i}, user{i}, email{i}@gmail.com)' for i in result]
+_expect.insert(len(_expect) - 5, 'Deleted 995 rows.')
+
+_input += ['select where name = x', 'select limit -1', '.exit']
+_expect += ["Syntax error. Couldn't parse the statement.", "Syntax error. Couldn't parse the statement."]
+
+TESTS.append({'name': test_name, 'inputs': [_input], 'expectations': [_expect]})
+
+
+#------------------------------------------------------------------------------
+# TEST 20 (count(*) and offset from the row counts in the internal nodes)|
+#------------------------------------------------------------------------------
+test_name = 'count and offset'
+
+# long rows (13 per leaf), so the tree has 2 internal node layers
+n = 6000
+ids = list(range(1, n+1))
+random.Random(20).shuffle(ids)
+_input = [f"insert {i} {'u'*32} {'e'*255}" for i in ids]
+_expect = ['Inserted.' for x in range(n)]
+_input += ['delete where id between 1001 and 2000', 'select count(*) where id <= 3000', '.exit']
+_expect += ['Deleted 1000 rows.', '(2000)']
+
+row = lambda i: f"({i}, {'u'*32}, {'e'*255})"
+_input1 = [
+    'select count(*)',
+    'select count(*) where id between 500 and 2500',
+    'select count(*) where id > 5999',
+    'select count(*) where id < 0',
+    'select limit 2 offset 999',
+    'select where id > 4000 limit 1 offset 1500',
+    'select offset 4999',
+    'select offset 5000',
+    'select count(*) limit 1',
+    '.exit'
+]
+_expect1 = ['(5000)', '(1001)', '(1)', '(0)', row(1000), row(2001), row(5501), row(6000),
+            "Syntax error. Couldn't parse the statement."]
+
+TESTS.append({'name': test_name, 'inputs': [_input, _input1], 'expectations': [_expect, _expect1]})
+
+
+#------------------------------------------------------------------------------
+# TEST 21 (secondary indexes on the username and email)|
+#------------------------------------------------------------------------------
+test_name = 'secondary indexes'
+
+# usernames repeat every 50 rows, the two long usernames only differ after the index prefix (28 bytes)
+n = 4000
+name = lambda i: f'user{i % 50}' if i % 50 != 7 else 'u' * 30 + ('a' if i % 100 == 7 else 'b')
+row = lambda i: f'({i}, {name(i)}, mail{i}@x.com)'
+ids = list(range(1, n+1))
+random.Random(21).shuffle(ids)
+_input = [f'insert {i} {name(i)} mail{i}@x.com' for i in ids[:2000]]
+_expect = ['Inserted.' for x in range(2000)]
+# the index is built from the first half of the rows and the second half is inserted into it
+_input += ['create index on username', 'create index on username']
+_expect += ['Created index on username (2000 rows).', 'Error: Index already exists.']
+_input += [f'insert {i} {name(i)} mail{i}@x.com' for i in ids[2000:]]
+_expect += ['Inserted.' for x in range(2000)]
+_input += ['select count(*) where username = user3', 'select where username = user3 limit 2 offset 10',
+           f"select where username = '{'u' * 30}a' limit 3", 'select where username = nobody', '.exit']
+_expect += ['(80)', row(503), row(553), row(7), row(107), row(207)]
+
+_input1 = [
+    'update 3 set username=nobody',
+    'delete where id between 1 and 1000',
+    'select count(*) where username = user3',
+    'select where username = nobody',
+    'select count(*) where email = mail3500@x.com',
+    'create index on email',
+    "select where email = 'mail3500@x.com'",
+    'delete 3500',
+    'select where email = mail3500@x.com',
+    'select where email = ' + 'm' * 256,
+    'create index on id',
+    '.exit'
+]
+_expect1 = ['Updated 1 rows.', 'Deleted 1000 rows.', '(60)', '(1)', 'Created index on email (3000 rows).', row(3500),
+            'Deleted 1 rows.', 'String inserted is too long.', "Syntax error. Couldn't parse the statement."]
+
+TESTS.append({'name': test_name, 'inputs': [_input, _input1], 'expectations': [_expect, _expect1]})
+
+
+#------------------------------------------------------------------------------
+# TEST 22 (hash index on the id)|
+#------------------------------------------------------------------------------
+test_name = 'hash index'
+
+# the index is built from the first half of the rows, the second half is inserted into it (splitting its buckets)
+n = 4000
+row = lambda i: f'({i}, user{i}, mail{i}@x.com)'
+ids = list(range(1, n+1))
+random.Random(22).shuffle(ids)
+_input = [f'insert {i} user{i} mail{i}@x.com' for i in ids[:2000]]
+_expect = ['Inserted.' for x in range(2000)]
+_input += ['create hash index on id', 'create hash index on id', 'create hash index on email']
+_expect += ['Created hash index on id (2000 rows).', 'Error: Index already exists.', "Syntax error. Couldn't parse the statement."]
+_input += [f'insert {i} user{i} mail{i}@x.com' for i in ids[2000:]]
+_expect += ['Inserted.' for x in range(2000)]
+_input += ['select where id = 1234', 'select where id = 4001', 'select where id = 77 limit 0', '.exit']
+_expect += [row(1234)]
+
+_input1 = [
+    'update 1234 set email=' + 'e' * 255,
+    'select where id = 1234',
+    'delete where id between 1000 and 3000',
+    'select where id = 1234',
+    'select where id = 999',
+    'select where id = 3001',
+    'select count(*) where id = 3001',
+    '.exit'
+]
+_expect1 = ['Updated 1 rows.', f"(1234, user1234, {'e' * 255})", 'Deleted 2001 rows.', row(999), row(3001), '(1)']
+
+TESTS.append({'name': test_name, 'inputs': [_input, _input1], 'expectations': [_expect, _expect1]})
+
+
+#------------------------------------------------------------------------------
+# TEST 23 (lists of ids)|
+#------------------------------------------------------------------------------
+test_name = 'select where id in'
+
+# every other id, so half of the listed ids don't exist, the list is in random order with duplicates
+n = 3000
+row = lambda i: f'({i}, user{i}, mail{i}@x.com)'
+ids = list(range(2, 2*n+1, 2))
+random.Random(23).shuffle(ids)
+listed = [random.Random(i).randrange(1, 2*n+10) for i in range(1500)] + ids[:500] + ids[:10]
+random.Random(24).shuffle(listed)
+found = sorted(set(i for i in listed if i % 2 == 0 and i <= 2*n))
+
+_input = [f'insert {i} user{i} mail{i}@x.com' for i in ids]
+_expect = ['Inserted.' for x in range(n)]
+_input += [
+    'select where id in (' + ', '.join(map(str, listed)) + ')',
+    f'select count(*) where id in ({",".join(map(str, listed))})',
+    'select where id in (6000, 4, 3, 2) limit 2 offset 1',
+    'select where id in (7)',
+    'select where id in ()',
+    'select where id in (1, 2,)',
+    'select where id in (1, -2)',
+    'select where id in (1 2)',
+    'delete where id in (2)',
+    '.exit'
+]
+_expect += [row(i) for i in found] + [f'({len(found)})', row(4), row(6000)]
+_expect += ["Syntax error. Couldn't parse the statement.", "Syntax error. Couldn't parse the statement.",
+            'Negative ID inserted. ID must be a positive integer.', "Syntax error. Couldn't parse the statement.",
+            "Syntax error. Couldn't parse the statement."]
+
+TESTS.append({'name': test_name, 'inputs': [_input], 'expectations': [_expect]})
+
+
+#------------------------------------------------------------------------------
+# TEST 24 (statements that don't allocate)|
+#------------------------------------------------------------------------------
+test_name = 'allocation-free inserts and lookups'
+
+# cursors are on the stack and the log's buffers are reused, so once the buffer pool holds the
+# pages (and the log's buffers have grown) inserts, lookups, updates and deletes don't allocate
+n = 2000
+row = lambda i: f'({i}, user{i}, mail{i}@x.com)'
+_input = [f'insert {i} user{i} mail{i}@x.com' for i in range(2, 2*n+1, 2)]
+_expect = ['Inserted.' for x in range(n)]
+# (sequential inserts leave the leaves full, the delete makes room for the insert so it doesn't split)
+checks = [
+    ('delete 1000', ['Deleted 1 rows.']),
+    ('insert 1001 a a@x.com', ['Inserted.']),
+    ('select where id = 1001', ['(1001, a, a@x.com)']),
+    ('select where id = 1003', []),
+    ('select where id between 20 and 24', [row(20), row(22), row(24)]),
+    ('select limit 1 offset 100', [row(202)]),
+    ('select count(*) where id > 3000', ['(500)']),
+    ('update 1001 set username=b', ['Updated 1 rows.']),
+    ('delete 1001', ['Deleted 1 rows.']),
+    ('insert 1001 a a@x.com', ['Inserted.']),
+]
+for statement, output in checks:
+    _input += [statement, '.allocations']
+    _expect += output + ['Heap allocations of the last statement: 0']
+
+TESTS.append({'name': test_name, 'inputs': [_input], 'expectations': [_expect]})
+
+
+#------------------------------------------------------------------------------
+# TEST 25 (output modes)|
+#------------------------------------------------------------------------------
+test_name = 'csv and binary output modes'
+
+# csv quotes values with a comma or a double quote, binary rows are the id (4 bytes) and the record
+# (length bytes before the values) without separators and counts are 8 bytes, there is no prompt
+_input = ['insert 65 ab a@b', 'insert 66 c,d e"f', '.mode csv', 'select', 'select count(*)',
+          '.mode binary', 'select', 'select count(*) where id > 65', '.mode text', 'select where id = 66', '.exit']
+binary_rows = 'A\x00\x00\x00\x02ab\x03a@b' + 'B\x00\x00\x00\x03c,d\x03e"f'
+binary_count = '\x01' + '\x00' * 7
+_expect = [
+    'Inserted.',
+    'Inserted.',
+    '65,ab,a@b',
+    '66,"c,d","e""f"',
+    '2',
+    binary_rows + binary_count + '(66, c,d, e"f)',
+]
+
+TESTS.append({'name': test_name, 'inputs': [_input], 'expectations': [_expect]})
+
+
+#------------------------------------------------------------------------------
+# TEST 26 (parallel scans)|
+#------------------------------------------------------------------------------
+test_name = 'parallel scan for a column predicate'
+
+# the table is big enough to be scanned on the threads, the parts' matches are merged in id order
+n = 20000
+_input = [f'insert {i} user{i % 10} mail{i % 3}@x.com' for i in range(1, n + 1)]
+_expect = ['Inserted.' for x in range(n)]
+row = lambda i: f'({i}, user{i % 10}, mail{i % 3}@x.com)'
+mail1 = [i for i in range(1, n + 1) if i % 3 == 1]
+_input += ['select count(*) where username = user3', 'select where email = mail1@x.com limit 3 offset 5000',
+           'select where username = user7 limit 2', 'delete where id between 1 and 10000',
+           'select count(*) where email = mail1@x.com', 'select where username = nobody', '.exit']
+_expect += [f'({n // 10})', row(mail1[5000]), row(mail1[5001]), row(mail1[5002]), row(7), row(17),
+            'Deleted 10000 rows.', f'({len([i for i in mail1 if i > 10000])})']
+
+TESTS.append({'name': test_name, 'inputs': [_input], 'expectations': [_expect], 'args': ['--threads', '4']})
+
+
+#------------------------------------------------------------------------------
+# TEST 27 (like patterns)|
+#------------------------------------------------------------------------------
+test_name = 'like patterns on the username and email'
+
+# a `%` at the start and/or end is a suffix, prefix or substring pattern, without one it's an equality,
+# the value of the pattern can be as long as the column (the rows are filtered a leaf at a time)
+long_email = 'x' * 200 + '@example.org'
+_input = ['insert 1 alice alice@example.com', 'insert 2 bob bob@mail.example.org', 'insert 3 alicia al@example.com',
+          f'insert 4 bobby {long_email}', "select where email like '%@example.com'", 'select where username like ali%',
+          'select where email like %example%', "select count(*) where email like '%example.org'",
+          f'select where email like %{long_email[150:]}', 'select where username like bob', 'select where username like %',
+          'select where email like a%b', '.exit']
+_expect = [
+    'Inserted.',
+    'Inserted.',
+    'Inserted.',
+    'Inserted.',
+    '(1, alice, alice@example.com)',
+    '(3, alicia, al@example.com)',
+    '(1, alice, alice@example.com)',
+    '(3, alicia, al@example.com)',
+    '(1, alice, alice@example.com)',
+    '(2, bob, bob@mail.example.org)',
+    '(3, alicia, al@example.com)',
+    f'(4, bobby, {long_email})',
+    '(2)',
+    f'(4, bobby, {long_email})',
+    '(2, bob, bob@mail.example.org)',
+    '(1, alice, alice@example.com)',
+    '(2, bob, bob@mail.example.org)',
+    '(3, alicia, al@example.com)',
+    f'(4, bobby, {long_email})',
+    "Syntax error. Couldn't parse the statement.",
+]
+
+TESTS.append({'name': test_name, 'inputs': [_input], 'expectations': [_expect]})
+
+
+#------------------------------------------------------------------------------
+# TEST 28 (zone maps)|
+#------------------------------------------------------------------------------
+test_name = 'zone maps of the leaves stay valid after changes'
+
+# the first scans record the zone maps of the leaves (the domain changes every 500 ids), the rows
+# inserted, updated and deleted later are found by the next scans
+n = 3000
+_input = [f'insert {i} user{i} mail{i}@d{i // 500}.com' for i in range(1, n + 1)]
+_expect = ['Inserted.' for x in range(n)]
+_input += ['select count(*) where email like %@d3.com', 'select count(*) where username like user25%',
+           'update 10 set email=moved@d3.com', 'insert 5000 late@x.org late@d3.com', 'delete 1600',
+           'select count(*) where email like %@d3.com', 'select where email like %@d3.com limit 2',
+           'select where username = late@x.org', 'update 1700 set username=user25x',
+           'select count(*) where username like user25%', '.exit']
+_expect += ['(500)', '(111)', 'Updated 1 rows.', 'Inserted.', 'Deleted 1 rows.', '(501)',
+            '(10, user10, moved@d3.com)', '(1500, user1500, mail1500@d3.com)', '(5000, late@x.org, late@d3.com)',
+            'Updated 1 rows.', '(112)']
+
+TESTS.append({'name': test_name, 'inputs': [_input], 'expectations': [_expect]})
+
+
+#------------------------------------------------------------------------------------
+# TEST 29 (the memory mapped file survives a crash in the middle of a statement)|
+#------------------------------------------------------------------------------------
+test_name = 'crash during a multi-page statement with the memory mapped pager'
+
+# the range delete (with two indexes) changes thousands of pages and commits every
+# `DELETE_COMMIT_INTERVAL` leaves, the program is killed while it runs. After the log is
+# recovered the table and the indexes have to agree: deleting the rest of the range leaves one row
+n = 500000
+with open('test_crash.csv', 'w') as f:
+    f.write('id,username,email\n')
+    for i in range(1, n+1):
+        f.write(f'{i},user{i},email{i}@gmail.com\n')
+
+_input = ['.import test_crash.csv', 'create index on username', 'create index on email', '.exit']
+_expect = [f'Imported {n} rows.', f'Created index on username ({n} rows).', f'Created index on email ({n} rows).']
+
+_input1 = [f'delete where id between 1 and {n-1}']
+
+# the number of rows the second delete finds depends on when the first one was killed
+_input2 = [f'delete where id between 1 and {n-1}', '.exit']
+
+_input3 = ['select', f'select where username = user{n}', f'select where email = email{n}@gmail.com',
+           'select where username = user7', 'select count(*)', '.exit']
+_expect3 = [f'({n}, user{n}, email{n}@gmail.com)' for x in range(3)] + ['(1)']
+
+TESTS.append({'name': test_name, 'inputs': [_input, _input1, _input2, _input3], 'expectations': [_expect, None, None, _expect3],
+              'args': ['--mmap'], 'kill_after': [None, 0.3, None, None]})